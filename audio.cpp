@@ -0,0 +1,451 @@
+#include "audio.h"
+#include "audio_capture.h"
+#include "tempo.h"
+#include "latency.h"
+
+// Audio system variables (from working v2.6 implementation)
+float soundMin = 1.0f;
+float soundMax = 0.0f;
+float musicLevel = 0.0f;
+float audioLevel = 0.0f;
+bool beatDetected = false;
+bool prevAbove = false;
+uint32_t beatTimes[50];             // Ring buffer - order doesn't matter for window counting
+uint8_t beatCount = 0;
+static uint8_t beatTimesHead = 0;
+IntervalStats<50> beatIntervalStats;  // Last 50 intervals between beats, median/IQR kept incrementally
+uint32_t lastBeatTime = 0;          // NEW: Timestamp of last detected beat
+uint32_t lastBpmMillis = 0;
+bool audioDetected = true;
+uint8_t musicBrightness = BRIGHTNESS;
+unsigned long lastMusicDetectedTime = 0;  // Timestamp of last music detection for sticky behavior
+float currentBPM = 0.0f;                   // Smoothed BPM value for display
+bool beatReactive = false;                 // NEW: Whether patterns should respond to beats
+
+// Brightness decay envelope for smoother audio response
+float brightnessEnvelope = BRIGHTNESS;  // Current decaying brightness level
+unsigned long lastBrightnessUpdate = 0;  // For calculating decay time delta
+unsigned long lastBeatDetectedTime = 0;  // Track when last beat occurred
+
+// Speed envelope for moderate beat-reactive speed changes
+float speedEnvelope = 0.3f;              // Current speed multiplier (0.3 = slower base, 1.3 = boosted)
+unsigned long lastSpeedUpdate = 0;       // For calculating decay time delta
+
+// Adaptive audio scaling - Ultra-fast response for immediate contrast
+float noiseFloor = 0.01f;          // Moving average of quiet ambient sound
+float peakLevel = 0.1f;            // Moving average of loud sound peaks
+float noiseFloorSmooth = 0.7f;     // Ultra-fast adaptation (30% new value per frame)
+float peakLevelSmooth = 0.5f;      // Ultra-fast decay (50% new value per frame)
+
+// ===== BEAT-REACTIVE HELPER FUNCTIONS =====
+// Current beat period: the streaming tempo tracker once it has locked,
+// otherwise the median of recent onset intervals (0 = no beat yet)
+static uint32_t getBeatIntervalMs() {
+  if (tempoLocked()) return (uint32_t)(60000.0f / tempoBPM());
+  return getMedianInterval();
+}
+
+// Calculate speed multiplier from beat interval (0.5x to 3.0x)
+// Faster BPM = higher speed multiplier for pattern animations
+float getBeatSpeed() {
+  uint32_t interval = getBeatIntervalMs();
+  if (interval == 0) return 1.0f;  // No beat detected, use default speed
+
+  // Calculate BPM from interval: BPM = 60000 / intervalMs
+  // Then scale to 0.5-3.0 range:
+  //   60 BPM (1000ms) -> 1.0x (normal speed)
+  //   120 BPM (500ms) -> 2.0x (double speed)
+  //   180 BPM (333ms) -> 3.0x (triple speed)
+  //   30 BPM (2000ms) -> 0.5x (half speed)
+  float speed = 1000.0f / (float)interval;
+  return constrain(speed, 0.5f, 3.0f);
+}
+
+// Adjust animation increment based on beat speed
+// Example: getBeatAdjustedInc(2) returns 2 at 60BPM, 4 at 120BPM, 1 at 30BPM
+int getBeatAdjustedInc(int baseInc) {
+  return (int)(baseInc * getBeatSpeed());
+}
+
+// Get SUBTLE beat-reactive speed multiplier for patterns (0.8x to 1.2x)
+// More subtle than before for smoother, more predictable motion
+float getBeatSpeedMultiplier() {
+  if (!audioDetected) return 1.0f;  // No music, use base speed
+
+  uint32_t interval = getBeatIntervalMs();
+  if (interval == 0) return 1.0f;  // No beat detected
+
+  // Calculate speed from BPM, but keep it subtle (0.8x to 1.2x range)
+  // 60 BPM = 1.0x, 120 BPM = 1.2x, 30 BPM = 0.8x
+  float speed = 1000.0f / (float)interval;  // BPM-based speed
+  speed = 0.8f + (speed - 0.5f) * 0.2f;  // Map to 0.8-1.2 range
+  return constrain(speed, 0.8f, 1.2f);
+}
+
+// Get speed multiplier from envelope for dramatic beat-reactive speed changes
+// Returns 1.0x (normal) to 3.5x (boosted) with smooth decay
+// Once the tempo tracker locks, the whole envelope also scales with the
+// song's tempo (0.75x at 90 BPM, 1.0x at 120, 1.5x at 180+)
+float getSpeedMultiplier() {
+  if (!audioDetected) return 1.0f;  // No music, use normal speed
+  if (!tempoLocked()) return speedEnvelope;
+  return speedEnvelope * constrain(tempoBPM() / 120.0f, TEMPO_SPEED_MIN, TEMPO_SPEED_MAX);
+}
+
+// Get beat-reactive brightness scale for music mode patterns (0.1 to 1.0)
+// Applied BEFORE gamma correction (in applyOutputStage) to preserve dark gaps
+// Only affects music mode - normal mode always returns 1.0
+float getMusicBeatBrightnessScale() {
+  if (currentMode != MODE_MUSIC && currentMode != MODE_MUSIC_LEADER) {
+    return 1.0f;  // Normal mode - no scaling
+  }
+
+  // Always use brightnessEnvelope - it handles idle brightness restoration
+  // Map brightnessEnvelope (8-80) to VERY dramatic range (0.02-1.0)
+  // Idle/no beats: 50 → ~0.6, Min during beats: 8 → 0.02 (very dark!), Max on beats: 80 → 1.0 (full bright!)
+  float normalized = (brightnessEnvelope - (float)BRIGHTNESS_MIN) / (float)(BRIGHTNESS_MAX - BRIGHTNESS_MIN);
+  float scale = BEAT_BRIGHTNESS_SCALE_MIN + normalized * (BEAT_BRIGHTNESS_SCALE_MAX - BEAT_BRIGHTNESS_SCALE_MIN);
+  return constrain(scale, BEAT_BRIGHTNESS_SCALE_MIN, BEAT_BRIGHTNESS_SCALE_MAX);
+}
+
+// Audio system (working implementation from v2.6)
+void initAudio() {
+  M5.Mic.begin(); 
+  M5.Mic.setSampleRate(MIC_SR);
+  lastBpmMillis = millis();
+  startAudioCapture(MIC_SR);
+  tempoInit((float)MIC_SR / AUDIO_BLOCK_LEN);
+  Serial.println("Audio initialized");
+}
+
+void detectAudioFrame() {
+  // Drain every block captured since the last frame - the whole ~16ms of
+  // audio is analysed, not just one 5ms snapshot
+  AudioFeature feature;
+  float levelSum = 0.0f;
+  int blocks = 0;
+  uint32_t onsetTime = 0;
+  uint32_t captureMs = latencyStageMicros(LAT_CAPTURE) / 1000;
+  while (popAudioFeature(feature)) {
+    levelSum += feature.level;
+    blocks++;
+    latencyRecord(LAT_QUEUE, (millis() - feature.timestampMs) * 1000);
+#if AUDIO_SPECTRAL_ONSETS
+    float strength = feature.flux;
+#else
+    float strength = feature.level * 1000.0f;
+#endif
+    if (feature.onset) {
+      if (onsetTime == 0) onsetTime = feature.timestampMs;
+      tempoAddOnset(feature.timestampMs - captureMs, strength);  // When the hit actually happened
+    }
+    tempoAddOnsetStrength(strength);
+  }
+  if (blocks == 0) return;
+  float raw = levelSum / blocks;
+
+  // Asymmetric smoothing: slow rise, fast fall for soundMax to prevent tap spikes from lingering
+  soundMin = min(raw, SMOOTH * soundMin + (1 - SMOOTH) * raw);
+
+  if (raw > soundMax) {
+    // Rising: use slow smoothing (SMOOTH = 0.985)
+    soundMax = max(raw, SMOOTH * soundMax + (1 - SMOOTH) * raw);
+  } else {
+    // Falling: use fast decay (0.95 = 5% new value per frame, ~13x faster than rising)
+    const float FAST_DECAY = 0.95f;
+    soundMax = max(raw, FAST_DECAY * soundMax + (1 - FAST_DECAY) * raw);
+  }
+  
+  // Adaptive sensitivity with aggressive AGC for noisy environments
+  float dynamicRange = soundMax - soundMin;
+  const float MIN_DYNAMIC_RANGE = 0.25f;  // Increased from 0.15 for more aggressive AGC
+  const float HIGH_VOLUME_THRESHOLD = 0.3f;  // Lower threshold to trigger AGC earlier
+
+  float adaptedMin = soundMin;
+  float adaptedMax = soundMax;
+  float beatThreshold = 0.25f;  // Default threshold - lowered for sensitivity
+
+  bool highVolumeEnvironment = (soundMin > HIGH_VOLUME_THRESHOLD) || (dynamicRange < MIN_DYNAMIC_RANGE);
+
+  if (highVolumeEnvironment) {
+    if (dynamicRange < MIN_DYNAMIC_RANGE) {
+      // More aggressive expansion for better dynamic range in noisy environments
+      float expansion = (MIN_DYNAMIC_RANGE - dynamicRange) * 1.5f;  // Increased from 1.0 to 1.5
+      adaptedMin = max(0.0f, soundMin - expansion);
+      adaptedMax = min(1.0f, soundMax + expansion);
+    }
+    beatThreshold = 0.12f;  // Very low threshold for better beat detection
+  }
+
+  // Debug output every 60 frames (~1 second) when in music mode
+  static int debugCounter = 0;
+  if ((currentMode == MODE_MUSIC || currentMode == MODE_MUSIC_LEADER) && ++debugCounter >= 60) {
+    debugCounter = 0;
+    Serial.print("Audio: raw=");
+    Serial.print(raw, 3);
+    Serial.print(" min=");
+    Serial.print(soundMin, 3);
+    Serial.print(" max=");
+    Serial.print(soundMax, 3);
+    Serial.print(" range=");
+    Serial.print(dynamicRange, 3);
+    Serial.print(" level=");
+    Serial.print(musicLevel, 3);
+    Serial.print(" thresh=");
+    Serial.print(beatThreshold, 2);
+    Serial.print(" AGC=");
+    Serial.print(highVolumeEnvironment ? "ON" : "OFF");
+    Serial.print(" beat=");
+    Serial.println(beatDetected ? "YES" : "NO");
+  }
+  
+  musicLevel = constrain((raw - adaptedMin) / (adaptedMax - adaptedMin + 1e-6f), 0.0f, 1.0f);
+  audioLevel = musicLevel;
+  
+#if AUDIO_SPECTRAL_ONSETS
+  // Spectral flux onsets are already one-shot events (with a refractory
+  // period), so a beat is simply an onset in any block of this frame
+  bool above = (onsetTime != 0);
+#else
+  bool above = (musicLevel > beatThreshold);
+#endif
+  if (above && !prevAbove) {
+    // Timestamp from the block that carried the transient, not from when loop() got to it
+    uint32_t t = onsetTime ? onsetTime : millis();
+
+    // Track beat times (for legacy BPM calculation)
+    beatTimes[beatTimesHead] = t;
+    beatTimesHead = (beatTimesHead + 1) % 50;
+    if (beatCount < 50) beatCount++;
+
+    // NEW: Track beat intervals for improved BPM calculation
+    if (lastBeatTime > 0) {
+      uint32_t interval = t - lastBeatTime;
+      // Only track reasonable intervals (150ms to 2000ms = 30-400 BPM)
+      if (interval >= 150 && interval <= 2000) {
+        beatIntervalStats.add(interval);
+      }
+    }
+    lastBeatTime = t;
+    lastBeatDetectedTime = t;  // Track for brightness restoration
+
+    beatDetected = true;
+  } else if (!above) {
+    beatDetected = false;
+  }
+  prevAbove = above;
+}
+
+// Median beat interval (for stable BPM calculation) - maintained on insert, O(1)
+uint32_t getMedianInterval() {
+  return beatIntervalStats.median();
+}
+
+void updateBPM() {
+  uint32_t now = millis();
+
+  // CONTINUOUS TEMPO: once the autocorrelation tracker locks, follow it every
+  // frame - a song change is picked up within a few beats, not 5s windows
+  if (tempoLocked()) {
+    currentBPM = tempoBPM();
+    lastMusicDetectedTime = now;
+    audioDetected = true;
+  }
+
+  if (now - lastBpmMillis >= BPM_WINDOW) {
+    // Count beats in window (for music detection)
+    int cnt = 0;
+    uint32_t cutoff = now - BPM_WINDOW;
+    for (int i = 0; i < beatCount; i++) {
+      if (beatTimes[i] >= cutoff) cnt++;
+    }
+
+    // NEW: INTERVAL-BASED BPM CALCULATION
+    // Instead of just counting beats, find the most common interval
+    // This locks onto the actual tempo instead of fluctuating
+    float bpm = 0.0f;
+    if (beatIntervalStats.count() >= 3) {  // Need at least 3 intervals for median
+      uint32_t medianInterval = getMedianInterval();
+      if (medianInterval > 0) {
+        bpm = 60000.0f / float(medianInterval);  // Convert interval to BPM
+      }
+    } else if (cnt >= 2) {
+      // Fallback to count-based if not enough intervals yet
+      bpm = cnt * (60000.0f / float(BPM_WINDOW));
+    }
+
+    // VERY AGGRESSIVE SMOOTHING - 90% old + 10% new for rock-solid display
+    // This prevents BPM from jumping around on the display
+    // (Fallback only - a locked tempo tracker already set currentBPM)
+    if (!tempoLocked()) {
+      if (currentBPM == 0.0f || currentBPM < 10.0f) {
+        currentBPM = bpm;  // First reading or reset, no smoothing
+      } else if (bpm > 0.0f) {
+        currentBPM = currentBPM * 0.9f + bpm * 0.1f;
+      }
+    }
+
+    // DEBUG: Print beat info to help diagnose detection issues
+    Serial.print("BPM Check: beats=");
+    Serial.print(cnt);
+    Serial.print(", intervals=");
+    Serial.print(beatIntervalStats.count());
+    Serial.print(", IQR=");
+    Serial.print(beatIntervalStats.iqr());
+    Serial.print(", rawBPM=");
+    Serial.print(bpm);
+    Serial.print(", smoothed=");
+    Serial.print(currentBPM);
+    Serial.print(", tempo=");
+    Serial.print(tempoBPM());
+    Serial.print("@");
+    Serial.print(tempoConfidence());
+#if AUDIO_SPECTRAL_ONSETS
+    uint32_t fftAvg, fftPeak;
+    getSpectralCpuMicros(fftAvg, fftPeak);
+    Serial.print(", fft=");
+    Serial.print(fftAvg);
+    Serial.print("/");
+    Serial.print(fftPeak);
+    Serial.print("us");
+#endif
+    Serial.print(", audioDetected=");
+    Serial.println(audioDetected ? "YES" : "NO");
+
+    // ULTRA-STICKY HYSTERESIS DETECTION - very sensitive and stable
+    // Enter music mode: 2+ beats (very low threshold - highly sensitive)
+    // Stay in music mode: 1+ beat OR within 20 second timeout (ultra sticky)
+    // Exit music mode: 0 beats AND timeout expired (strong momentum)
+
+    bool beatsDetected = (cnt >= 2 && currentBPM >= 30.0f && currentBPM <= 300.0f);  // Enter threshold
+    bool sustainBeats = (cnt >= 1 && currentBPM >= 30.0f && currentBPM <= 300.0f);   // Stay threshold
+
+    if (beatsDetected || sustainBeats) {
+      lastMusicDetectedTime = now;  // Update timestamp on any beat activity
+      audioDetected = true;
+    } else {
+      // Only exit music mode if no beats for 20 seconds (ultra-sticky timeout)
+      if (now - lastMusicDetectedTime > 20000) {
+        audioDetected = false;
+        currentBPM = 0.0f;  // Reset BPM when exiting music mode
+      }
+      // Otherwise stay in music mode (strong momentum)
+    }
+
+    lastBpmMillis += BPM_WINDOW;
+    beatCount = 0;
+    beatTimesHead = 0;
+  }
+}
+
+// PREDICTED BEATS: once the tempo is locked, raise beatDetected on the frame
+// whose light will be visible when the next beat lands - i.e. early by the
+// measured pipeline latency - instead of one pipeline latency after it
+static void predictBeat() {
+  static uint32_t lastCheck = 0;
+  uint32_t now = millis();
+  if (lastCheck == 0) lastCheck = now;
+  uint32_t lead = latencyTotalMicros(currentMode == MODE_MUSIC_LEADER) / 1000;
+  uint32_t windowStart = lastCheck + lead;
+  lastCheck = now;
+  if (!tempoLocked()) return;
+
+  // Fire if a beat's display time fell into (previous check, now]
+  uint32_t beat = tempoNextBeatMs(windowStart);
+  beatDetected = (beat != 0 && (int32_t)(now + lead - beat) >= 0);
+  if (beatDetected) lastBeatDetectedTime = now;
+}
+
+void updateAudioLevel() {
+  detectAudioFrame();
+  predictBeat();
+  updateBPM();
+  
+  // Always adapt BOTH noiseFloor and peakLevel to track current audio range
+  // This ensures brightness always scales from min to max based on recent audio
+  noiseFloor = noiseFloor * noiseFloorSmooth + audioLevel * (1.0f - noiseFloorSmooth);
+  peakLevel = peakLevel * peakLevelSmooth + audioLevel * (1.0f - peakLevelSmooth);
+
+  // Simple direct mapping: loud voice = bright (25), quiet voice = dark (1)
+  // Fast-adapting noiseFloor and peakLevel keep the range appropriate
+  float range = peakLevel - noiseFloor;
+  if (range < 0.01f) range = 0.01f;  // Prevent division by zero
+
+  float normalizedLevel = (audioLevel - noiseFloor) / range;
+  normalizedLevel = constrain(normalizedLevel, 0.0f, 1.0f);
+
+  // THRESHOLD AND POWER CURVE - pronounced beats boost brightness dramatically
+  // Quieter sounds below threshold stay at base brightness
+  // Above threshold, apply power curve for dramatic response
+  float targetBrightness;
+  if (normalizedLevel < BRIGHTNESS_THRESHOLD) {
+    targetBrightness = (float)BRIGHTNESS_MIN;  // Minimum brightness for quiet sounds
+  } else {
+    // Scale from threshold to 1.0 into 0.0 to 1.0 range
+    float scaledLevel = (normalizedLevel - BRIGHTNESS_THRESHOLD) / (1.0f - BRIGHTNESS_THRESHOLD);
+    // Apply power curve for dramatic response
+    float curved = pow(scaledLevel, BRIGHTNESS_POWER_CURVE);
+    // Map to WIDE brightness range (30-200) for VERY visible pulsing!
+    targetBrightness = (float)BRIGHTNESS_MIN + (curved * (float)(BRIGHTNESS_MAX - BRIGHTNESS_MIN));
+  }
+
+  // SMOOTH DECAY ENVELOPE - requested by Max!
+  // Fast attack (instant response to peaks), exponential decay (0.5s time constant)
+  unsigned long now = millis();
+  float timeDelta = (now - lastBrightnessUpdate) / 1000.0f;  // Convert to seconds
+  lastBrightnessUpdate = now;
+
+  if (targetBrightness > brightnessEnvelope) {
+    // ATTACK: New peak is higher - instantly jump to it
+    brightnessEnvelope = targetBrightness;
+  } else {
+    // GAUSSIAN/EXPONENTIAL DECAY: Natural smooth falloff
+    // Uses time constant tau (BRIGHTNESS_DECAY_SECONDS)
+    // Formula: envelope = target + (envelope - target) * exp(-timeDelta / tau)
+    float tau = BRIGHTNESS_DECAY_SECONDS;
+    float decayFactor = exp(-timeDelta / tau);
+    brightnessEnvelope = targetBrightness + (brightnessEnvelope - targetBrightness) * decayFactor;
+
+    // Don't go below minimum brightness
+    if (brightnessEnvelope < (float)BRIGHTNESS_MIN) {
+      brightnessEnvelope = (float)BRIGHTNESS_MIN;
+    }
+  }
+
+  // Check if no beats detected for a while - restore to idle brightness
+  // Also check if current audio level is low (just background noise, not music)
+  bool noBeatsTimeout = (now - lastBeatDetectedTime) > NO_BEAT_TIMEOUT;
+  bool lowAudioLevel = (normalizedLevel < BRIGHTNESS_THRESHOLD);
+
+  if (noBeatsTimeout || (lowAudioLevel && brightnessEnvelope < (float)BRIGHTNESS_IDLE * 0.7f)) {
+    // No beats for a while OR very low audio - restore to idle brightness for visibility
+    brightnessEnvelope = (float)BRIGHTNESS_IDLE;
+  }
+
+  // SPEED ENVELOPE - dramatic speed boost on beat with smooth decay
+  // Same attack/decay behavior as brightness for consistent feel
+  float targetSpeed = beatDetected ? SPEED_BOOST_MULTIPLIER : SPEED_BASE;
+
+  float speedTimeDelta = (now - lastSpeedUpdate) / 1000.0f;
+  lastSpeedUpdate = now;
+
+  if (targetSpeed > speedEnvelope) {
+    // ATTACK: Instantly boost speed on beat
+    speedEnvelope = targetSpeed;
+  } else {
+    // DECAY: Smooth falloff back to normal speed (same tau as brightness)
+    float tau = BRIGHTNESS_DECAY_SECONDS;
+    float decayFactor = exp(-speedTimeDelta / tau);
+    speedEnvelope = targetSpeed + (speedEnvelope - targetSpeed) * decayFactor;
+
+    // Don't go below base speed
+    if (speedEnvelope < SPEED_BASE) {
+      speedEnvelope = SPEED_BASE;
+    }
+  }
+
+  musicBrightness = (uint8_t)brightnessEnvelope;
+  // NOTE: We don't set FastLED.setBrightness() here anymore!
+  // Instead, the output stage applies brightness scaling BEFORE gamma in music mode
+  // This keeps global brightness constant and preserves dark gaps
+}
@@ -0,0 +1,66 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include "config.h"
+#include "interval_stats.h"
+
+// Audio configuration
+static constexpr int MIC_SR = 44100;
+static constexpr float SMOOTH = 0.985f;  // Faster adaptation (was 0.995) for better beat detection
+static constexpr uint32_t BPM_WINDOW = 5000;
+
+// Brightness decay envelope for smoother audio response
+#define BRIGHTNESS_DECAY_SECONDS 1.0f    // Time constant for exponential decay (63% falloff) - slower = less jarring
+#define BRIGHTNESS_THRESHOLD 0.35f       // Audio must exceed this level to boost brightness (0.0-1.0)
+#define BRIGHTNESS_POWER_CURVE 2.0f      // Power curve exponent (1.0=linear, 2.0=square, 3.0=cube)
+#define BRIGHTNESS_MIN 8                 // Minimum brightness during active music (very dark for contrast)
+#define BRIGHTNESS_MAX 80                // Maximum brightness - very bright for dramatic beats
+#define BRIGHTNESS_IDLE 50               // Brightness when no beats detected
+#define NO_BEAT_TIMEOUT 3000             // Restore full brightness after 3 seconds of silence
+
+// Speed envelope for moderate beat-reactive speed changes
+#define SPEED_BOOST_MULTIPLIER 1.3f      // How much to boost speed on beat (1.3x on beat)
+#define SPEED_BASE 0.3f                  // Minimum speed between beats (slower for contrast)
+#define TEMPO_SPEED_MIN 0.75f            // Locked tempo scales the envelope: 90 BPM and below
+#define TEMPO_SPEED_MAX 1.5f             // 180 BPM and above
+
+// Ranges getSpeedMultiplier() and getMusicBeatBrightnessScale() produce:
+// followers clamp a leader's values to them (renderFromState)
+#define SPEED_MULTIPLIER_MIN (SPEED_BASE * TEMPO_SPEED_MIN)
+#define SPEED_MULTIPLIER_MAX (SPEED_BOOST_MULTIPLIER * TEMPO_SPEED_MAX)
+#define BEAT_BRIGHTNESS_SCALE_MIN 0.02f
+#define BEAT_BRIGHTNESS_SCALE_MAX 1.0f
+
+// Audio system variables (defined in audio.cpp)
+extern float soundMin, soundMax, musicLevel, audioLevel;
+extern bool beatDetected, prevAbove;
+extern uint32_t beatTimes[50];
+extern uint8_t beatCount;
+extern IntervalStats<50> beatIntervalStats;
+extern uint32_t lastBeatTime, lastBpmMillis;
+extern bool audioDetected;
+extern uint8_t musicBrightness;
+extern unsigned long lastMusicDetectedTime;
+extern float currentBPM;
+extern bool beatReactive;
+extern float brightnessEnvelope;
+extern unsigned long lastBrightnessUpdate, lastBeatDetectedTime;
+extern float speedEnvelope;
+extern unsigned long lastSpeedUpdate;
+extern float noiseFloor, peakLevel, noiseFloorSmooth, peakLevelSmooth;
+
+// ===== BEAT-REACTIVE HELPER FUNCTIONS =====
+float getBeatSpeed();
+int getBeatAdjustedInc(int baseInc);
+float getBeatSpeedMultiplier();
+float getSpeedMultiplier();
+float getMusicBeatBrightnessScale();
+
+// ===== AUDIO PROCESSING =====
+void initAudio();
+void detectAudioFrame();
+uint32_t getMedianInterval();
+void updateBPM();
+void updateAudioLevel();
+
+#endif
@@ -0,0 +1,158 @@
+#include "audio_capture.h"
+#include "audio.h"
+#include "spsc_queue.h"
+#include "spectral.h"
+#include "latency.h"
+
+#include <atomic>
+
+// Onset detection on block level
+#define ONSET_RATIO 1.5f      // Block level must exceed this multiple of the recent average
+#define ONSET_MIN_JUMP 0.02f  // ...and rise by at least this much (ignores quiet-room flicker)
+#define ONSET_AVG_SMOOTH 0.9f // Recent average: 10% new block per block (~60ms)
+
+static SpscQueue<AudioFeature, AUDIO_FEATURE_QUEUE_LEN> featureQueue;
+
+static int16_t sampleRing[AUDIO_RING_LEN];
+static std::atomic<uint32_t> ringWritePos{0};  // Total samples written (wraps)
+
+static uint32_t halfBlockMicros = 0;
+
+static float onsetAverage = 0.0f;
+static bool prevOnset = false;
+
+#if AUDIO_SPECTRAL_ONSETS
+static int16_t fftInput[SPECTRAL_FFT_SIZE];
+static uint32_t spectralMicrosAvg = 0;  // EMA, 1/8 per block
+static uint32_t spectralMicrosPeak = 0;
+#endif
+
+// ===== PRODUCER SIDE =====
+static void analyseBlock(const int16_t* buf, size_t len, uint32_t timestamp) {
+  // Append to ring buffer, then publish the new write position
+  uint32_t pos = ringWritePos.load(std::memory_order_relaxed);
+  long sum = 0;
+  for (size_t i = 0; i < len; i++) {
+    sampleRing[(pos + i) & (AUDIO_RING_LEN - 1)] = buf[i];
+    sum += abs(buf[i]);
+  }
+  ringWritePos.store(pos + len, std::memory_order_release);
+
+  AudioFeature f;
+  f.timestampMs = timestamp;
+  f.level = float(sum) / len / 32767.0f;
+
+  // Rising edge of a level jump - one onset per transient
+  bool jump = f.level > onsetAverage * ONSET_RATIO && f.level - onsetAverage > ONSET_MIN_JUMP;
+  f.onset = jump && !prevOnset;
+  f.flux = 0;
+  prevOnset = jump;
+  onsetAverage = ONSET_AVG_SMOOTH * onsetAverage + (1 - ONSET_AVG_SMOOTH) * f.level;
+
+#if AUDIO_SPECTRAL_ONSETS
+  // We are the ring's only writer, so the newest window can be read directly
+  uint32_t start = pos + len - SPECTRAL_FFT_SIZE;
+  for (int i = 0; i < SPECTRAL_FFT_SIZE; i++) {
+    fftInput[i] = sampleRing[(start + i) & (AUDIO_RING_LEN - 1)];
+  }
+  unsigned long t0 = micros();
+  SpectralFrame spectral = spectralAnalyse(fftInput);
+  uint32_t elapsed = micros() - t0;
+  spectralMicrosAvg = spectralMicrosAvg - (spectralMicrosAvg >> 3) + elapsed;  // Holds 8x average
+  if (elapsed > spectralMicrosPeak) spectralMicrosPeak = elapsed;
+
+  f.onset = spectral.onset;
+  f.flux = spectral.flux;
+#else
+  uint32_t elapsed = 0;
+#endif
+
+  // A transient lands on average mid-block, then waits for the block to fill
+  latencyRecord(LAT_CAPTURE, halfBlockMicros + elapsed);
+
+  featureQueue.push(f);
+}
+
+#ifdef ARDUINO
+// M5.Mic.record() only queues a buffer for the I2S driver, so keep the next
+// buffer queued while the previous one is analysed - no gaps between blocks
+static int16_t captureBufs[2][AUDIO_BLOCK_LEN];
+static uint8_t captureIdx = 0;
+static bool capturePrimed = false;
+
+bool captureAudioBlock() {
+  if (!capturePrimed) {
+    if (!M5.Mic.record(captureBufs[captureIdx], AUDIO_BLOCK_LEN)) return false;
+    capturePrimed = true;
+  }
+  uint8_t next = captureIdx ^ 1;
+  if (!M5.Mic.record(captureBufs[next], AUDIO_BLOCK_LEN)) return false;
+
+  // isRecording() == 2 means the queue is still full, i.e. our block is in progress
+  while (M5.Mic.isRecording() > 1) vTaskDelay(1);
+
+  analyseBlock(captureBufs[captureIdx], AUDIO_BLOCK_LEN, millis());
+  captureIdx = next;
+  return true;
+}
+
+static void audioCaptureTask(void* param) {
+  for (;;) {
+    if (!captureAudioBlock()) vTaskDelay(1);
+  }
+}
+
+void startAudioCapture(uint32_t sampleRate) {
+  halfBlockMicros = (uint32_t)((uint64_t)AUDIO_BLOCK_LEN * 500000 / sampleRate);
+#if AUDIO_SPECTRAL_ONSETS
+  spectralInit(sampleRate);
+#endif
+  xTaskCreatePinnedToCore(audioCaptureTask, "audioCapture", 4096, NULL, 3, NULL, AUDIO_CAPTURE_CORE);
+}
+#else
+// Host: record() returns filled samples synchronously (silence or WAV data)
+bool captureAudioBlock() {
+  static int16_t buf[AUDIO_BLOCK_LEN];
+  if (!M5.Mic.record(buf, AUDIO_BLOCK_LEN)) return false;
+  analyseBlock(buf, AUDIO_BLOCK_LEN, millis());
+  return true;
+}
+
+void startAudioCapture(uint32_t sampleRate) {
+  halfBlockMicros = (uint32_t)((uint64_t)AUDIO_BLOCK_LEN * 500000 / sampleRate);
+#if AUDIO_SPECTRAL_ONSETS
+  spectralInit(sampleRate);
+#endif
+}
+#endif
+
+// ===== CONSUMER SIDE =====
+bool popAudioFeature(AudioFeature& feature) {
+  return featureQueue.pop(feature);
+}
+
+size_t copyRecentSamples(int16_t* out, size_t n) {
+  if (n > AUDIO_RING_LEN) n = AUDIO_RING_LEN;
+  uint32_t end = ringWritePos.load(std::memory_order_acquire);
+  uint32_t start = end - n;
+  for (size_t i = 0; i < n; i++) {
+    out[i] = sampleRing[(start + i) & (AUDIO_RING_LEN - 1)];
+  }
+  // Writer lapped us while copying - the oldest samples may be torn
+  if (ringWritePos.load(std::memory_order_acquire) - start > AUDIO_RING_LEN) return 0;
+  return n;
+}
+
+uint32_t audioFeaturesDropped() {
+  return featureQueue.dropped();
+}
+
+void getSpectralCpuMicros(uint32_t& average, uint32_t& peak) {
+#if AUDIO_SPECTRAL_ONSETS
+  average = spectralMicrosAvg >> 3;
+  peak = spectralMicrosPeak;
+  spectralMicrosPeak = 0;  // Peak since last query
+#else
+  average = peak = 0;
+#endif
+}
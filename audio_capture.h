@@ -0,0 +1,37 @@
+#ifndef AUDIO_CAPTURE_H
+#define AUDIO_CAPTURE_H
+
+#include "config.h"
+
+// ===== BACKGROUND AUDIO CAPTURE =====
+// A capture task streams mic samples back-to-back into a ring buffer and
+// publishes one AudioFeature per block through a lock-free SPSC queue.
+// loop() drains the queue each frame, so every sample is analysed and the
+// render path never waits on the mic.
+//
+// On the host there is no task: tools call captureAudioBlock() themselves
+// (with M5.Mic fed from a WAV file, see host/wav_source.h).
+
+#define AUDIO_BLOCK_LEN 256        // Samples per analysed block (~5.8ms at 44.1kHz)
+#define AUDIO_RING_LEN 4096        // Raw sample history (~93ms), power of two
+#define AUDIO_FEATURE_QUEUE_LEN 32 // ~185ms of blocks before the producer drops
+#define AUDIO_CAPTURE_CORE 0       // loop() runs on core 1
+#ifndef AUDIO_SPECTRAL_ONSETS
+#define AUDIO_SPECTRAL_ONSETS 1    // FFT + spectral flux onsets (spectral.h); 0 = level jumps only
+#endif
+
+struct AudioFeature {
+  uint32_t timestampMs;  // millis() when the block finished recording
+  float level;           // Mean absolute amplitude, 0.0-1.0
+  bool onset;            // Spectral flux onset (or level jump without the FFT engine)
+  uint16_t flux;         // Kick-weighted spectral flux, 0 without the FFT engine
+};
+
+void startAudioCapture(uint32_t sampleRate);
+bool captureAudioBlock();                          // Record + analyse one block
+bool popAudioFeature(AudioFeature& feature);       // Non-blocking, consumer side
+size_t copyRecentSamples(int16_t* out, size_t n);  // Newest n samples, 0 if overrun
+uint32_t audioFeaturesDropped();
+void getSpectralCpuMicros(uint32_t& average, uint32_t& peak);  // Per-block FFT cost
+
+#endif
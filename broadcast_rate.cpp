@@ -0,0 +1,113 @@
+#include "broadcast_rate.h"
+#include "tx_queue.h"
+
+static CRGB reference[NUM_LEDS];  // Last frame sent: what followers show
+static uint32_t lastSentAt = 0;
+static bool sentAny = false;
+static uint16_t intervalMs = RATE_INTERVAL_CHANGED_MS;
+static uint16_t floorMs = RATE_INTERVAL_MIN_MS;
+
+// Current window, and the TX counters at its start
+static uint32_t windowStart = 0, windowRequested = 0, windowSent = 0;
+static TxStats windowTx;
+
+// Written per frame, read racily for printing
+static RateStats stats = {0, 0, 1000.0f / RATE_INTERVAL_MIN_MS, 0, 0, 0, 0, 0, 0};
+
+// Share of pixels visibly off from what followers show; *changed if any differ
+static float motionFromReference(const CRGB* frame, int count, bool* changed) {
+  int visible = 0;
+  *changed = false;
+  for (int i = 0; i < count; i++) {
+    uint8_t step = 0;
+    for (int c = 0; c < 3; c++) {
+      uint8_t d = frame[i].raw[c] > reference[i].raw[c] ? frame[i].raw[c] - reference[i].raw[c]
+                                                        : reference[i].raw[c] - frame[i].raw[c];
+      if (d > step) step = d;
+    }
+    if (step > 0) *changed = true;
+    if (step >= RATE_VISIBLE_STEP) visible++;
+  }
+  return count ? (float)visible / count : 0;
+}
+
+// Close a window: rates for the report, and the congestion floor from its losses
+static void updateWindow(uint32_t nowMs) {
+  uint32_t elapsed = nowMs - windowStart;
+  if (elapsed < RATE_WINDOW_MS) return;
+
+  TxStats tx = txQueueStats();
+  if (tx.sent < windowTx.sent || tx.failed < windowTx.failed || tx.dropped < windowTx.dropped) {
+    windowTx = TxStats();  // txQueueResetStats() ran ('T' report)
+  }
+  uint32_t sent = tx.sent - windowTx.sent;
+  uint32_t lost = (tx.failed - windowTx.failed) + (tx.dropped - windowTx.dropped);
+  float loss = sent + lost ? (float)lost / (sent + lost) : 0;
+
+  if (loss > RATE_LOSS_BACKOFF) {
+    floorMs = floorMs * 2 < RATE_INTERVAL_FLOOR_MAX_MS ? floorMs * 2 : RATE_INTERVAL_FLOOR_MAX_MS;
+  } else if (loss < RATE_LOSS_RECOVER) {
+    floorMs = floorMs - RATE_INTERVAL_STEP_MS > RATE_INTERVAL_MIN_MS ? floorMs - RATE_INTERVAL_STEP_MS
+                                                                     : RATE_INTERVAL_MIN_MS;
+  }
+
+  stats.targetFps = windowRequested * 1000.0f / elapsed;
+  stats.actualFps = windowSent * 1000.0f / elapsed;
+  stats.ceilingFps = 1000.0f / floorMs;
+  stats.lossPercent = 100.0f * loss;
+  stats.packetsPerSecond = sent * 1000.0f / elapsed;
+  windowStart = nowMs;
+  windowRequested = windowSent = 0;
+  windowTx = tx;
+}
+
+bool broadcastRateShouldSend(const CRGB* frame, int count, bool beat, uint32_t nowMs) {
+  updateWindow(nowMs);
+
+  bool changed = true;
+  float motion = sentAny ? motionFromReference(frame, count, &changed) : 1;
+  uint16_t content;
+  if (motion >= RATE_MOTION_FULL) content = RATE_INTERVAL_MIN_MS;
+  else if (changed) content = RATE_INTERVAL_CHANGED_MS;
+  else content = RATE_INTERVAL_IDLE_MS;
+  if (content < floorMs) content = floorMs;
+  intervalMs = beat ? floorMs : content;
+
+  uint32_t since = nowMs - lastSentAt + RATE_FRAME_SLACK_MS;
+  if (since < content) {
+    if (beat && changed && since >= floorMs) {
+      stats.beats++;  // Would have waited without it
+    } else {
+      if (changed) stats.held++;
+      else stats.unchanged++;
+      return false;
+    }
+  }
+  windowRequested++;
+  return true;
+}
+
+void broadcastRateNoteSent(const CRGB* frame, int count, uint32_t nowMs) {
+  memcpy(reference, frame, (count < NUM_LEDS ? count : NUM_LEDS) * sizeof(CRGB));
+  lastSentAt = nowMs;
+  sentAny = true;
+  windowSent++;
+  stats.frames++;
+}
+
+uint16_t broadcastRateIntervalMs() {
+  return intervalMs;
+}
+
+RateStats broadcastRateStats() {
+  return stats;
+}
+
+void broadcastRatePrintReport() {
+  RateStats s = stats;
+  Serial.printf("[RATE] target %.1ffps, actual %.1ffps, congestion ceiling %.1ffps (interval %ums)\n", s.targetFps,
+                s.actualFps, s.ceilingFps, (unsigned)intervalMs);
+  Serial.printf("[RATE] channel %.0f packets/s, %.1f%% failed or dropped\n", s.packetsPerSecond, s.lossPercent);
+  Serial.printf("[RATE] %lu frames sent, %lu early for a beat; skipped %lu unchanged, %lu held back (little change)\n",
+                (unsigned long)s.frames, (unsigned long)s.beats, (unsigned long)s.unchanged, (unsigned long)s.held);
+}
@@ -0,0 +1,53 @@
+#ifndef BROADCAST_RATE_H
+#define BROADCAST_RATE_H
+
+#include "config.h"
+
+// ===== ADAPTIVE BROADCAST RATE (leader) =====
+// Decides, per rendered frame, whether the leader broadcasts it, by how far
+// the followers' picture - the last frame sent - is behind it. Visible
+// motion (RATE_MOTION_FULL of the pixels off by RATE_VISIBLE_STEP or more)
+// or a beat goes out every frame; changes too small to see yet wait up to
+// RATE_INTERVAL_CHANGED_MS, so a slow fade is sent as fast as it visibly
+// moves; an unchanged picture only goes out as a keepalive.
+//
+// Congestion: every RATE_WINDOW_MS the share of packets that failed in the
+// send callback or were dropped by the TX queue sets a floor under the
+// interval - doubled above RATE_LOSS_BACKOFF, narrowed by
+// RATE_INTERVAL_STEP_MS below RATE_LOSS_RECOVER - so a busy channel gets
+// fewer, complete frames instead of a queue of stale ones.
+
+#define RATE_INTERVAL_MIN_MS 16       // Every rendered frame (60fps)
+#define RATE_INTERVAL_CHANGED_MS 50   // Longest wait for a changed frame (the old fixed rate)
+#define RATE_INTERVAL_IDLE_MS 250     // Keepalive for an unchanged picture, well inside LEADER_TIMEOUT_MS
+#define RATE_INTERVAL_FLOOR_MAX_MS 200
+#define RATE_INTERVAL_STEP_MS 4
+#define RATE_FRAME_SLACK_MS 8         // Frames arrive every ~16ms: 48ms counts as 50
+#define RATE_VISIBLE_STEP 4           // Levels in any channel that count a pixel as changed
+#define RATE_MOTION_FULL 0.02f        // Share of changed pixels that can't wait
+#define RATE_BEAT_HOLD_MS 100         // Every frame goes out this long after a beat
+#define RATE_WINDOW_MS 500
+#define RATE_LOSS_BACKOFF 0.10f
+#define RATE_LOSS_RECOVER 0.02f
+
+struct RateStats {
+  float targetFps;        // Frames the controller asked to send, last window
+  float actualFps;        // Frames that went out (the encoder can still skip on back-pressure)
+  float ceilingFps;       // 1000 / congestion floor
+  float lossPercent;      // Packets failed or dropped, last window
+  float packetsPerSecond; // Packets the channel carried, last window
+  uint32_t frames;        // Frames sent
+  uint32_t unchanged;     // Skipped: identical to the last frame sent
+  uint32_t held;          // Skipped: changed too little to send yet
+  uint32_t beats;         // Sent early for a beat
+};
+
+// Output task (or loop() without one), per leader frame
+bool broadcastRateShouldSend(const CRGB* frame, int count, bool beat, uint32_t nowMs);
+void broadcastRateNoteSent(const CRGB* frame, int count, uint32_t nowMs);
+uint16_t broadcastRateIntervalMs();  // Current target interval
+
+RateStats broadcastRateStats();
+void broadcastRatePrintReport();
+
+#endif
@@ -0,0 +1,256 @@
+#include "clock_sync.h"
+#include "config.h"
+#include "triple_buffer.h"
+#include <atomic>
+#include <math.h>
+
+#define CLOCK_SYNC_DELAY_SLACK_US 300   // Always fit samples this close to the fastest
+#define CLOCK_SYNC_MAX_DRIFT 200e-6f    // Crystals are within +-50ppm; anything beyond is a bad fit
+#define PRESENT_DELAY_SHRINK_MS 5000    // Shrink window: only shrink after this long with spare margin
+#define PRESENT_DELAY_GROW_HOLD_MS 500  // Reports stamped before a grow still show the old delay
+#define PRESENT_LATE_US 1000            // Presentation error that counts as visibly out of step
+
+bool isClockSyncPacket(const uint8_t* data, int len) {
+  return len == (int)sizeof(ClockSyncPacket) && data[0] == CLOCK_SYNC_MAGIC;
+}
+
+// ===== FOLLOWER: OFFSET / DRIFT ESTIMATE =====
+struct ClockSample {
+  uint32_t local;   // Local micros() at the exchange midpoint
+  uint32_t offset;  // Leader - local (mod 2^32)
+  int32_t delay;    // Round trip minus leader turnaround
+};
+
+// Published model: offset(local) = refOffset + drift * (local - refLocal)
+struct ClockModel {
+  bool valid;
+  uint32_t refLocal;
+  uint32_t refOffset;
+  float drift;
+};
+
+// Samples and the fit are written by the ESP-NOW receive callback only
+static ClockSample samples[CLOCK_SYNC_WINDOW];
+static uint8_t sampleCount = 0, sampleHead = 0;
+static uint8_t requestSeq = 0;
+static TripleBuffer<ClockModel> modelHandoff;
+static ClockModel fitted;  // The receive callback's own copy
+
+// Report-only figures (written by one task each, read racily for printing)
+static float fitRmsUs = 0, fitDriftPpm = 0;
+static int32_t fitOffsetUs = 0, rttMinUs = 0, rttAvgUs = 0;
+static uint8_t fitUsed = 0;
+static std::atomic<int32_t> worstMargin{INT32_MAX};
+
+struct PresentStats {
+  uint32_t count, late;
+  int32_t min, max;
+  int64_t sum;
+};
+static PresentStats present;
+static int32_t reportMarginMin = INT32_MAX;
+
+void clockSyncReset() {
+  sampleCount = sampleHead = 0;
+  fitted.valid = false;
+  ClockModel& m = modelHandoff.back();
+  m.valid = false;
+  modelHandoff.publish();
+}
+
+void clockSyncMakeRequest(ClockSyncPacket& out, const uint8_t self[6]) {
+  memset(&out, 0, sizeof(out));
+  out.magic = CLOCK_SYNC_MAGIC;
+  out.type = CLOCK_REQUEST;
+  memcpy(out.requester, self, 6);
+  out.seq = requestSeq++;
+  out.marginUs = worstMargin.exchange(INT32_MAX);
+  if (out.marginUs < reportMarginMin) reportMarginMin = out.marginUs;
+  out.t1 = micros();
+}
+
+static void fitModel() {
+  // Low round trips carry little asymmetry: fit the faster half of the
+  // window, plus anything within the slack of the fastest
+  int32_t sorted[CLOCK_SYNC_WINDOW];
+  int64_t delaySum = 0;
+  for (int i = 0; i < sampleCount; i++) {
+    int32_t d = samples[i].delay;
+    int j = i;
+    for (; j > 0 && sorted[j - 1] > d; j--) sorted[j] = sorted[j - 1];
+    sorted[j] = d;
+    delaySum += d;
+  }
+  int32_t minDelay = sorted[0];
+  int32_t cutoff = sorted[(sampleCount - 1) / 2];
+  if (cutoff < minDelay + CLOCK_SYNC_DELAY_SLACK_US) cutoff = minDelay + CLOCK_SYNC_DELAY_SLACK_US;
+
+  // Regress against the newest sample so all terms stay small
+  const ClockSample& ref = samples[(sampleHead + CLOCK_SYNC_WINDOW - 1) % CLOCK_SYNC_WINDOW];
+  double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for (int i = 0; i < sampleCount; i++) {
+    const ClockSample& s = samples[i];
+    if (s.delay > cutoff) continue;
+    double x = (int32_t)(s.local - ref.local);
+    double y = (int32_t)(s.offset - ref.offset);
+    n++, sx += x, sy += y, sxx += x * x, sxy += x * y;
+  }
+
+  double slope = 0;
+  double den = n * sxx - sx * sx;
+  if (n >= 3 && den > 1e12) slope = (n * sxy - sx * sy) / den;  // Needs ~1s of spread
+  if (slope > CLOCK_SYNC_MAX_DRIFT) slope = CLOCK_SYNC_MAX_DRIFT;
+  if (slope < -CLOCK_SYNC_MAX_DRIFT) slope = -CLOCK_SYNC_MAX_DRIFT;
+  double intercept = (sy - slope * sx) / n;
+
+  double sq = 0;
+  for (int i = 0; i < sampleCount; i++) {
+    const ClockSample& s = samples[i];
+    if (s.delay > cutoff) continue;
+    double x = (int32_t)(s.local - ref.local);
+    double r = (int32_t)(s.offset - ref.offset) - (intercept + slope * x);
+    sq += r * r;
+  }
+
+  ClockModel& m = modelHandoff.back();
+  m.valid = sampleCount >= CLOCK_SYNC_MIN_SAMPLES;
+  m.refLocal = ref.local;
+  m.refOffset = ref.offset + (int32_t)lround(intercept);
+  m.drift = (float)slope;
+  fitted = m;
+  modelHandoff.publish();
+
+  fitRmsUs = (float)sqrt(sq / n);
+  fitDriftPpm = (float)(slope * 1e6);
+  fitOffsetUs = (int32_t)m.refOffset;
+  fitUsed = (uint8_t)n;
+  rttMinUs = minDelay;
+  rttAvgUs = (int32_t)(delaySum / sampleCount);
+}
+
+void clockSyncOnReply(const ClockSyncPacket& reply, uint32_t t4) {
+  // Offset = ((t2 - t1) + (t3 - t4)) / 2, kept modular: the two clocks are unrelated
+  uint32_t forward = reply.t2 - reply.t1;
+  int32_t asymmetry = (int32_t)((reply.t3 - t4) - forward);
+  int32_t delay = (int32_t)((t4 - reply.t1) - (reply.t3 - reply.t2));
+  if (delay < 0) return;  // Stale or mangled reply
+
+  ClockSample& s = samples[sampleHead];
+  s.local = reply.t1 + (uint32_t)(t4 - reply.t1) / 2;
+  s.offset = forward + asymmetry / 2;
+  s.delay = delay;
+  sampleHead = (sampleHead + 1) % CLOCK_SYNC_WINDOW;
+  if (sampleCount < CLOCK_SYNC_WINDOW) sampleCount++;
+  fitModel();
+}
+
+static ClockModel model;
+
+bool clockSyncLocked() {
+  if (modelHandoff.acquire()) model = modelHandoff.front();
+  return model.valid;
+}
+
+uint32_t clockSyncLeaderToLocal(uint32_t leaderMicros) {
+  if (!clockSyncLocked()) return leaderMicros;
+  // local = leader - offset(local); one refinement step is plenty at ppm drift
+  uint32_t local = leaderMicros - model.refOffset;
+  float correction = model.drift * (float)(int32_t)(local - model.refLocal);
+  return local - (int32_t)lroundf(correction);
+}
+
+bool clockSyncLocalToLeader(uint32_t localMicros, uint32_t* leaderMicros) {
+  if (!fitted.valid) return false;
+  float correction = fitted.drift * (float)(int32_t)(localMicros - fitted.refLocal);
+  *leaderMicros = localMicros + fitted.refOffset + (int32_t)lroundf(correction);
+  return true;
+}
+
+void clockSyncNoteMargin(int32_t marginUs) {
+  int32_t prev = worstMargin.load(std::memory_order_relaxed);
+  while (marginUs < prev && !worstMargin.compare_exchange_weak(prev, marginUs)) {
+  }
+}
+
+void clockSyncRecordPresent(int32_t errorUs) {
+  PresentStats& p = present;
+  if (p.count == 0 || errorUs < p.min) p.min = errorUs;
+  if (p.count == 0 || errorUs > p.max) p.max = errorUs;
+  p.sum += errorUs;
+  p.count++;
+  if (errorUs > PRESENT_LATE_US) p.late++;
+}
+
+// ===== LEADER: ADAPTIVE PRESENTATION DELAY =====
+static uint32_t presentDelay = PRESENT_DELAY_INITIAL_US;
+static int32_t shrinkWindowMin = INT32_MAX;
+static unsigned long shrinkWindowStart = 0, lastGrow = 0;
+
+// Grow at once when any follower ran short (it is visibly out of step),
+// shrink slowly once every follower had spare margin for a whole window
+static void adaptPresentDelay(int32_t margin) {
+  if (margin == INT32_MAX) return;  // Follower showed no timed frames since its last request
+  unsigned long now = millis();
+
+  if (margin < PRESENT_MARGIN_TARGET_US && now - lastGrow >= PRESENT_DELAY_GROW_HOLD_MS) {
+    uint32_t grown = presentDelay + (PRESENT_MARGIN_TARGET_US - margin);
+    presentDelay = grown > PRESENT_DELAY_MAX_US ? PRESENT_DELAY_MAX_US : grown;
+    lastGrow = now;
+    shrinkWindowMin = INT32_MAX;
+    shrinkWindowStart = now;
+    return;
+  }
+
+  if (margin < shrinkWindowMin) shrinkWindowMin = margin;
+  if (now - shrinkWindowStart >= PRESENT_DELAY_SHRINK_MS) {
+    if (shrinkWindowMin != INT32_MAX && shrinkWindowMin > 2 * PRESENT_MARGIN_TARGET_US) {
+      uint32_t spare = (uint32_t)(shrinkWindowMin - PRESENT_MARGIN_TARGET_US) / 2;
+      presentDelay = presentDelay > PRESENT_DELAY_MIN_US + spare ? presentDelay - spare : PRESENT_DELAY_MIN_US;
+    }
+    shrinkWindowMin = INT32_MAX;
+    shrinkWindowStart = now;
+  }
+}
+
+void clockSyncMakeReply(const ClockSyncPacket& request, uint32_t t2, ClockSyncPacket& out) {
+  adaptPresentDelay(request.marginUs);
+  out = request;
+  out.type = CLOCK_REPLY;
+  out.t2 = t2;
+  out.t3 = micros();
+}
+
+void clockSyncMakeRelayReply(const ClockSyncPacket& request, uint32_t t2, uint32_t t2Leader, ClockSyncPacket& out) {
+  clockSyncNoteMargin(request.marginUs);
+  out = request;
+  out.type = CLOCK_REPLY;
+  out.t2 = t2Leader;
+  out.t3 = t2Leader + (micros() - t2);  // Drift over the turnaround is well under 1us
+}
+
+uint32_t presentDelayMicros() {
+  return presentDelay;
+}
+
+// ===== REPORT =====
+void clockSyncPrintReport() {
+  if (sampleCount > 0) {
+    Serial.printf("[CLOCK] offset %ldus, drift %+.1fppm, rtt min/avg %ld/%ldus, fit rms %.0fus (%u/%u samples)%s\n",
+                  (long)fitOffsetUs, fitDriftPpm, (long)rttMinUs, (long)rttAvgUs, fitRmsUs,
+                  (unsigned)fitUsed, (unsigned)sampleCount, model.valid ? "" : " - not locked");
+  } else {
+    Serial.printf("[CLOCK] no follower samples, leader presentation delay %uus\n", (unsigned)presentDelay);
+  }
+
+  PresentStats p = present;
+  if (p.count > 0) {
+    Serial.printf("[CLOCK] present error min/avg/max %ld/%ld/%ldus over %u frames, %u late (>%dus)\n",
+                  (long)p.min, (long)(p.sum / p.count), (long)p.max, (unsigned)p.count, (unsigned)p.late, PRESENT_LATE_US);
+  }
+  if (reportMarginMin != INT32_MAX) {
+    Serial.printf("[CLOCK] worst ready margin %ldus (leader adapts its delay to keep this >= %dus)\n",
+                  (long)reportMarginMin, PRESENT_MARGIN_TARGET_US);
+  }
+  memset(&present, 0, sizeof(present));
+  reportMarginMin = INT32_MAX;
+}
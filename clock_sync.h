@@ -0,0 +1,78 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <stdint.h>
+
+// ===== NETWORK CLOCK SYNC =====
+// NTP-style two-way exchange over ESP-NOW. A follower stamps a request with
+// its micros() (t1), the leader stamps receive (t2) and reply (t3), and the
+// follower stamps the reply's arrival (t4). Each exchange gives one offset
+// sample; a least-squares line through the low-delay samples of the last
+// few seconds gives offset and drift, so leader timestamps convert to local
+// time between exchanges.
+//
+// Leaders stamp frames with a presentation time (their clock) a few ms in
+// the future. Every node holds the frame in its jitter buffer and shows it
+// at that instant. Followers report how early their frames were ready, and
+// the leader adapts the presentation delay to the slowest follower.
+
+#define CLOCK_SYNC_MAGIC 0xE7
+#ifndef CLOCK_SYNC_INTERVAL_MS
+#define CLOCK_SYNC_INTERVAL_MS 125    // Follower request rate (25-byte packets)
+#endif
+#ifndef CLOCK_SYNC_WINDOW
+#define CLOCK_SYNC_WINDOW 64          // Samples in the offset/drift fit (8s)
+#endif
+#define CLOCK_SYNC_MIN_SAMPLES 4      // Before leader times are trusted
+
+#define PRESENT_DELAY_INITIAL_US 20000
+#define PRESENT_DELAY_MIN_US 4000
+#define PRESENT_DELAY_MAX_US 60000
+#define PRESENT_MARGIN_TARGET_US 1500  // Frames should be ready this early
+
+enum ClockSyncType : uint8_t {
+  CLOCK_REQUEST = 1,
+  CLOCK_REPLY = 2
+};
+
+struct __attribute__((packed)) ClockSyncPacket {
+  uint8_t magic;         // CLOCK_SYNC_MAGIC
+  uint8_t type;          // ClockSyncType
+  uint8_t requester[6];  // Follower MAC - replies are broadcast
+  uint8_t seq;
+  uint32_t t1;           // Follower send (follower micros)
+  uint32_t t2;           // Leader receive (leader micros)
+  uint32_t t3;           // Leader send (leader micros)
+  int32_t marginUs;      // Request: worst presentation margin since the last one
+};
+
+bool isClockSyncPacket(const uint8_t* data, int len);
+
+// ----- Follower -----
+void clockSyncReset();  // New leader: drop all samples
+void clockSyncMakeRequest(ClockSyncPacket& out, const uint8_t self[6]);  // Stamps t1 last
+void clockSyncOnReply(const ClockSyncPacket& reply, uint32_t t4);
+bool clockSyncLocked();
+// Leader micros() -> local micros(). Call from one task only (the output task).
+uint32_t clockSyncLeaderToLocal(uint32_t leaderMicros);
+
+// Local micros() -> leader micros(); false until locked. Call from the
+// receive callback only: it reads the fit where the fit is made.
+bool clockSyncLocalToLeader(uint32_t localMicros, uint32_t* leaderMicros);
+
+void clockSyncNoteMargin(int32_t marginUs);    // Frame ready this long before its time (negative = late)
+void clockSyncRecordPresent(int32_t errorUs);  // Show started this long after its time
+
+// ----- Leader -----
+void clockSyncMakeReply(const ClockSyncPacket& request, uint32_t t2, ClockSyncPacket& out);  // Stamps t3 last
+uint32_t presentDelayMicros();  // Current adaptive presentation delay
+
+// ----- Relay (mesh.h) -----
+// Answer for the leader, on the leader's clock as our fit has it: t2Leader
+// is t2 converted in the receive callback. The requester's margin joins
+// ours, so the leader hears about nodes it can't reach.
+void clockSyncMakeRelayReply(const ClockSyncPacket& request, uint32_t t2, uint32_t t2Leader, ClockSyncPacket& out);
+
+void clockSyncPrintReport();
+
+#endif
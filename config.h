@@ -0,0 +1,66 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <M5StickCPlus2.h>
+#include <FastLED.h>
+
+FASTLED_USING_NAMESPACE
+
+// Hardware config
+#define LED_PIN 32
+#ifndef NUM_LEDS
+#define NUM_LEDS 200  // Overridable from the host build (-DNUM_LEDS=...)
+#endif
+#define BRIGHTNESS 25  // Adjusted for M5Stick power stability
+#define COLOR_ORDER GRB
+#define CHIPSET WS2811
+#define COLOR_CORRECTION TypicalLEDStrip  // White balance, applied by FastLED at show time (never on the wire)
+
+// ESP-NOW payload limit. ESP-NOW v2 (ESP-IDF 5.4+, arduino-esp32 3.2+)
+// carries up to 1470 bytes; v1 receivers drop anything over 250, so set
+// ESPNOW_LARGE_PACKETS 0 when older builds share the channel.
+#ifdef ARDUINO
+#include <esp_now.h>
+#endif
+#ifndef ESPNOW_LARGE_PACKETS
+#define ESPNOW_LARGE_PACKETS 1
+#endif
+#ifndef ESPNOW_MAX_PACKET
+#if ESPNOW_LARGE_PACKETS && defined(ESP_NOW_MAX_DATA_LEN_V2)
+#define ESPNOW_MAX_PACKET ESP_NOW_MAX_DATA_LEN_V2
+#else
+#define ESPNOW_MAX_PACKET 250
+#endif
+#endif
+
+// Followers relay sync packets to nodes out of the leader's range (mesh.h)
+// behind a MESH_RELAY_OVERHEAD-byte header; leaders leave that much room
+// in every packet so any of them can be relayed
+#ifndef MESH_RELAY
+#define MESH_RELAY 1
+#endif
+#define MESH_RELAY_OVERHEAD (MESH_RELAY ? 10 : 0)
+
+// A follower takes over when its leader goes quiet (election.h); 0 leaves
+// leadership to the long press alone
+#ifndef ELECTION_AUTO
+#define ELECTION_AUTO 1
+#endif
+
+#define ARRAY_SIZE(A) (sizeof(A) / sizeof((A)[0]))
+
+// Ultra-Simple Mode System  
+enum NodeMode {
+  MODE_NORMAL,        // Standalone normal patterns, no sync
+  MODE_MUSIC,         // Standalone music-reactive patterns, no sync
+  MODE_NORMAL_LEADER, // Normal patterns + broadcast LED data
+  MODE_MUSIC_LEADER,  // Music patterns + broadcast LED data
+  MODE_FLUFFY         // E1.31/sACN WiFi receiver mode
+};
+
+// Shared globals (defined in m5lights_v1.ino / patterns.cpp)
+extern NodeMode currentMode;
+extern CRGB leds[NUM_LEDS];
+extern CRGB ledsNext[NUM_LEDS];
+
+#endif
@@ -0,0 +1,255 @@
+#include "election.h"
+#include "mesh.h"
+#include "spsc_queue.h"
+#include "tx_queue.h"
+#include <atomic>
+
+bool isElectionHeartbeat(const uint8_t* data, int len) {
+  return len == (int)sizeof(ElectionHeartbeat) && data[0] == ELECTION_MAGIC;
+}
+
+static uint8_t selfMac[6];
+
+void electionBegin(const uint8_t self[6]) {
+  memcpy(selfMac, self, 6);
+}
+
+// ===== RECEIVE SIDE (WiFi task) =====
+struct RivalRx {
+  uint8_t mac[6];
+  bool pinned;
+};
+static SpscQueue<RivalRx, 8> rivals;  // Receive callback -> loop()
+static std::atomic<bool> leaderPinned{false};
+static uint8_t preferred[6];               // Written by loop() only while seeking is false
+static std::atomic<bool> seeking{false};
+
+// Written by the WiFi task (and loop() on takeover), read racily for printing
+static uint32_t failovers = 0, failoverLastMs = 0, failoverMaxMs = 0;
+static uint32_t failoverSince = 0;  // Old leader's last packet; 0 = no failover pending
+
+static void recordFailover(uint32_t ms) {
+  failovers++;
+  failoverLastMs = ms;
+  if (ms > failoverMaxMs) failoverMaxMs = ms;
+}
+
+void electionOnHeartbeat(const uint8_t* data) {
+  leaderPinned.store(((const ElectionHeartbeat*)data)->flags & ELECTION_FLAG_PINNED, std::memory_order_relaxed);
+}
+
+void electionOnRival(const uint8_t leader[6], bool pinned) {
+  if (memcmp(leader, selfMac, 6) == 0) return;  // A follower of ours
+  RivalRx rx;
+  memcpy(rx.mac, leader, 6);
+  rx.pinned = pinned;
+  rivals.push(rx);  // Full: it heartbeats again in 50ms
+}
+
+void electionNoteLeaderChange(uint32_t silentSinceMs) {
+  leaderPinned.store(false, std::memory_order_relaxed);  // Until its first heartbeat
+  failoverSince = silentSinceMs ? silentSinceMs : 1;
+}
+
+bool electionPreferred(const uint8_t mac[6]) {
+  return seeking.load(std::memory_order_acquire) && memcmp(mac, preferred, 6) == 0;
+}
+
+void electionNoteFrame() {
+  if (!failoverSince) return;
+  recordFailover(millis() - failoverSince);
+  failoverSince = 0;
+}
+
+// ===== STATE MACHINE (loop) =====
+static ElectionState state = ELECTION_FOLLOWER;
+static bool pinnedSelf = false;
+static bool wasEligible = false;
+static uint32_t listenSince = 0, electStart = 0, electDelay = 0, lastHeartbeat = 0;
+static std::atomic<uint32_t> lastFrameSent{0};
+static uint32_t lastUpdate = 0;
+static uint8_t heartbeatSeq = 0;
+static uint32_t elections = 0, won = 0, stepDowns = 0;
+
+// Leader we follow, and the last one we lost: neighbors' beacons and relayed
+// heartbeats still name it for a while, and it mustn't outrank anyone then
+static uint8_t knownLeader[6], lostLeader[6];
+static bool haveKnown = false, haveLost = false;
+static uint32_t lostAt = 0;
+
+static void noteLost(const uint8_t leader[6], uint32_t now) {
+  memcpy(lostLeader, leader, 6);
+  haveLost = true;
+  lostAt = now;
+}
+
+static const uint8_t* recentlyLost(uint32_t now) {
+  if (haveLost && now - lostAt > ELECTION_LOST_MEMORY_MS) haveLost = false;
+  return haveLost ? lostLeader : nullptr;
+}
+
+static void noteLeader(const uint8_t* leader, uint32_t now) {
+  if (!leader) return;
+  if (haveKnown && memcmp(leader, knownLeader, 6) != 0) noteLost(knownLeader, now);  // Switched
+  memcpy(knownLeader, leader, 6);
+  haveKnown = true;
+}
+
+static bool outranksUs(const RivalRx& rival, uint32_t now) {
+  const uint8_t* lost = recentlyLost(now);
+  if (lost && memcmp(rival.mac, lost, 6) == 0) return false;
+  return electionOutranks(rival.mac, rival.pinned, selfMac, pinnedSelf);
+}
+
+// Following: seek a higher leader a neighbor follows, until we switch or it's gone
+static void updateSeeking(const uint8_t* leader, uint32_t now) {
+  uint8_t above[6];
+  bool seek = leader && meshNeighborFollowsAbove(leader, electionLeaderPinned(), recentlyLost(now), above);
+  if (seek == seeking.load(std::memory_order_relaxed)) return;
+  if (seek) {
+    memcpy(preferred, above, 6);
+    Serial.printf("[ELECT] Neighbor follows %02X:%02X:%02X:%02X:%02X:%02X, above our leader: seeking it\n",
+                  above[0], above[1], above[2], above[3], above[4], above[5]);
+  }
+  seeking.store(seek, std::memory_order_release);
+}
+
+static void sendHeartbeat(uint32_t now) {
+  ElectionHeartbeat hb;
+  hb.magic = ELECTION_MAGIC;
+  hb.seq = heartbeatSeq++;
+  hb.flags = pinnedSelf ? ELECTION_FLAG_PINNED : 0;
+  txQueueSend((uint8_t*)&hb, sizeof(hb));
+  lastHeartbeat = now;
+}
+
+void electionNoteSent(uint32_t nowMs) {
+  lastFrameSent.store(nowMs, std::memory_order_relaxed);
+}
+
+static ElectionAction lead(uint32_t now) {
+  bool outranked = false;
+  RivalRx rx, higher = RivalRx();
+  while (rivals.pop(rx)) {
+    if (outranksUs(rx, now)) {
+      higher = rx;
+      outranked = true;
+    }
+  }
+  if (state != ELECTION_LEADER) {
+    state = ELECTION_LEADER;
+    sendHeartbeat(now);  // Ends other candidates' elections now
+  } else if ((now - lastHeartbeat >= ELECTION_HEARTBEAT_MS &&
+              now - lastFrameSent.load(std::memory_order_relaxed) >= ELECTION_HEARTBEAT_MS) ||
+             now - lastHeartbeat >= ELECTION_HEARTBEAT_MAX_MS) {
+    sendHeartbeat(now);
+  }
+  if (!outranked || pinnedSelf) return ELECTION_STAY;
+
+  stepDowns++;
+  Serial.printf("[ELECT] Stepping down: %02X:%02X:%02X:%02X:%02X:%02X outranks us\n", higher.mac[0], higher.mac[1],
+                higher.mac[2], higher.mac[3], higher.mac[4], higher.mac[5]);
+  state = ELECTION_FOLLOWER;
+  wasEligible = false;  // Listen for it before electing again
+  return ELECTION_STEP_DOWN;
+}
+
+ElectionAction electionUpdate(bool leading, bool eligible, const uint8_t* leader, uint32_t lastHeardMs) {
+  uint32_t now = millis();
+  if (now - lastUpdate > ELECTION_LISTEN_MS) wasEligible = false;  // Fluffy mode doesn't call us
+  lastUpdate = now;
+  if (leading) return lead(now);
+
+  RivalRx rx;
+  while (rivals.pop(rx)) {
+  }
+  if (!eligible || !ELECTION_AUTO) {
+    seeking.store(false, std::memory_order_relaxed);
+    state = ELECTION_FOLLOWER;
+    wasEligible = false;
+    return ELECTION_STAY;
+  }
+  if (!wasEligible) {  // Boot, back from Fluffy, or just stepped down
+    wasEligible = true;
+    listenSince = now;
+  }
+
+  if (leader && now - lastHeardMs < ELECTION_LEADER_LOSS_MS) {
+    if (state == ELECTION_ELECT) Serial.println("[ELECT] A leader took over, following it");
+    state = ELECTION_FOLLOWER;
+    noteLeader(leader, now);
+    updateSeeking(leader, now);
+    return ELECTION_STAY;
+  }
+  seeking.store(false, std::memory_order_relaxed);
+  // A neighbor follows a leader we aren't hearing: relays will bring it to us
+  if (meshNeighborFollowsOther(leader ? leader : recentlyLost(now))) return ELECTION_STAY;
+  if (!leader && now - listenSince < ELECTION_LISTEN_MS) return ELECTION_STAY;
+
+  if (state != ELECTION_ELECT) {
+    uint8_t hops = meshStats().hops;
+    uint8_t ahead = meshNeighborsAhead();
+    if (hops > MESH_MAX_HOPS) hops = 0;  // Not following: nobody is closer
+    if (leader) noteLost(leader, now);
+    state = ELECTION_ELECT;
+    elections++;
+    electStart = now;
+    electDelay = hops * ELECTION_HOP_STEP_MS + ahead * ELECTION_RANK_STEP_MS + random(ELECTION_JITTER_MS);
+    Serial.printf("[ELECT] %s, candidate in %lums (hop %u, %u neighbors ahead)\n",
+                  leader ? "Leader lost" : "No leader", (unsigned long)electDelay, (unsigned)hops,
+                  (unsigned)ahead);
+  }
+  if (now - electStart < electDelay) return ELECTION_STAY;
+
+  won++;
+  if (leader) recordFailover(now - lastHeardMs);
+  failoverSince = 0;
+  Serial.printf("[ELECT] Taking over after %lums\n", (unsigned long)(now - electStart));
+  return ELECTION_TAKE_OVER;  // lead() takes the state on our first pass as leader
+}
+
+void electionSetPinned(bool pinned) {
+  pinnedSelf = pinned;
+}
+
+bool electionPinned() {
+  return pinnedSelf;
+}
+
+bool electionLeaderPinned() {
+  return leaderPinned.load(std::memory_order_relaxed);
+}
+
+bool electionSeeking() {
+  return seeking.load(std::memory_order_relaxed);
+}
+
+// ===== REPORT =====
+ElectionStats electionStats() {
+  ElectionStats s;
+  s.state = state;
+  s.pinned = pinnedSelf;
+  s.leaderPinned = electionLeaderPinned();
+  s.elections = elections;
+  s.won = won;
+  s.stepDowns = stepDowns;
+  s.failovers = failovers;
+  s.failoverLastMs = failoverLastMs;
+  s.failoverMaxMs = failoverMaxMs;
+  return s;
+}
+
+void electionPrintReport() {
+  static const char* const names[] = {"?", "follower", "electing", "leader"};
+  ElectionStats s = electionStats();
+  Serial.printf("[ELECT] %s%s, auto election %s\n", names[s.state],
+                s.state == ELECTION_LEADER ? (s.pinned ? " (pinned)" : " (elected)")
+                                           : (s.leaderPinned ? ", leader pinned" : ""),
+                ELECTION_AUTO ? "on" : "off");
+  Serial.printf("[ELECT] %lu elections started, %lu won, %lu step-downs\n", (unsigned long)s.elections,
+                (unsigned long)s.won, (unsigned long)s.stepDowns);
+  if (s.failovers > 0) {
+    Serial.printf("[ELECT] %lu failovers, last %lums, max %lums (old leader's last packet to new frames)\n",
+                  (unsigned long)s.failovers, (unsigned long)s.failoverLastMs, (unsigned long)s.failoverMaxMs);
+  }
+}
@@ -0,0 +1,107 @@
+#ifndef ELECTION_H
+#define ELECTION_H
+
+#include "config.h"
+
+// ===== LEADER ELECTION =====
+// Any node can lead; the token is its MAC. A leader's frames double as its
+// heartbeat; when none went out for ELECTION_HEARTBEAT_MS (broadcast_rate.h
+// holds an unchanged picture up to 250ms) it sends an ElectionHeartbeat, so
+// followers tell a quiet picture from a dead leader: ELECTION_LEADER_LOSS_MS
+// without a packet and they start an election, showing the last frame
+// meanwhile.
+//
+// Each candidate waits a delay weighted by how badly placed it is - hops
+// from the old leader times ELECTION_HOP_STEP_MS, plus ELECTION_RANK_STEP_MS
+// for each neighbor closer to it or as close with a higher MAC (mesh.h) -
+// and takes over when it expires. The first to take over usually ends the
+// election: its heartbeat reaches the others before their delay runs out,
+// and they follow it. Two that take over together settle it by token: a
+// leader hearing a higher one, straight or relayed, or a follower's beacon
+// naming it, steps down.
+//
+// Merging: parts of a mesh that elected leaders apart (nodes out of every
+// relay's reach at boot) join up once they touch. A follower whose
+// neighbor follows a leader above ours beacons as lost, so relays bring
+// that leader to it, and switches as soon as its packets arrive - showing
+// its old leader's frames until then. Node by node that reaches the lower
+// leader, which steps down.
+//
+// Leaders pinned by long press outrank elected ones and never step down;
+// heartbeats carry the flag, and long press won't pin a second leader on
+// top of a pinned one. ELECTION_AUTO 0 keeps leadership manual only.
+
+#define ELECTION_MAGIC 0xE9
+#define ELECTION_HEARTBEAT_MS 50
+#define ELECTION_HEARTBEAT_MAX_MS 500 // Heartbeats carry the pinned flag: at least this often
+#define ELECTION_LEADER_LOSS_MS 150   // Three heartbeats missed
+#define ELECTION_LISTEN_MS 1000       // Listen for a running leader before the first election
+#define ELECTION_HOP_STEP_MS 100      // Per hop from the old leader: relays' copies take a frame or two
+#define ELECTION_RANK_STEP_MS 30      // Per neighbor ahead of us: its heartbeat reaches us first
+#define ELECTION_JITTER_MS 10
+#define ELECTION_LOST_MEMORY_MS 3000  // A lost leader is ignored this long: stale beacons name it
+#define ELECTION_FLAG_PINNED 0x01
+
+enum ElectionState : uint8_t {
+  ELECTION_FOLLOWER = 1,  // Following, or listening for a leader
+  ELECTION_ELECT,         // Leader lost: candidate, waiting out our delay
+  ELECTION_LEADER
+};
+
+enum ElectionAction : uint8_t {
+  ELECTION_STAY,
+  ELECTION_TAKE_OVER,  // Become an elected leader
+  ELECTION_STEP_DOWN   // A higher leader is on the air: follow it
+};
+
+struct __attribute__((packed)) ElectionHeartbeat {
+  uint8_t magic;  // ELECTION_MAGIC
+  uint8_t seq;    // Relays' duplicate suppression
+  uint8_t flags;  // ELECTION_FLAG_*
+};
+
+struct ElectionStats {
+  ElectionState state;
+  bool pinned;             // We lead by long press
+  bool leaderPinned;       // Our leader does
+  uint32_t elections;      // Started
+  uint32_t won;
+  uint32_t stepDowns;
+  uint32_t failovers;      // Leader lost and a new one on our strip
+  uint32_t failoverLastMs; // Old leader's last packet to the new one's first frame
+  uint32_t failoverMaxMs;
+};
+
+// Pinned beats elected, then the higher MAC
+inline bool electionOutranks(const uint8_t a[6], bool aPinned, const uint8_t b[6], bool bPinned) {
+  if (aPinned != bPinned) return aPinned;
+  return memcmp(a, b, 6) > 0;
+}
+
+bool isElectionHeartbeat(const uint8_t* data, int len);
+void electionBegin(const uint8_t self[6]);
+
+// ----- Receive callback (WiFi task) -----
+void electionOnHeartbeat(const uint8_t* data);             // From the leader we follow
+void electionOnRival(const uint8_t leader[6], bool pinned); // Leading: another leader is on the air
+// Following: switched leaders after the old one's last packet at silentSinceMs
+void electionNoteLeaderChange(uint32_t silentSinceMs);
+void electionNoteFrame();  // A complete frame from our leader
+bool electionPreferred(const uint8_t mac[6]);  // Merging: switch to this leader's packets now
+
+// ----- Output task (loop() without one) -----
+void electionNoteSent(uint32_t nowMs);  // Leading: a frame went out
+
+// ----- loop() -----
+// leading: in a leader mode. eligible: may take over (a standalone mode).
+// leader: the one we follow (nullptr: none), last heard at lastHeardMs.
+ElectionAction electionUpdate(bool leading, bool eligible, const uint8_t* leader, uint32_t lastHeardMs);
+void electionSetPinned(bool pinned);
+bool electionPinned();
+bool electionLeaderPinned();
+bool electionSeeking();  // Merging: beacon as lost so relays bring the higher leader
+
+ElectionStats electionStats();
+void electionPrintReport();
+
+#endif
@@ -0,0 +1,48 @@
+#include "event_log.h"
+#include "config.h"
+#include "spsc_queue.h"
+
+#define EVENT_LOG_LINE_MAX 96  // Longest formatted record, incl. timestamp
+
+struct EventRecord {
+  uint32_t at;  // millis()
+  EventId id;
+  int32_t args[3];
+};
+
+#define EVENT_LOG_FORMAT(id, level, format) format,
+static const char* const eventFormats[] = { EVENT_LOG_EVENTS(EVENT_LOG_FORMAT) };
+#undef EVENT_LOG_FORMAT
+
+static SpscQueue<EventRecord, EVENT_LOG_SLOTS> records;
+static uint32_t droppedReported = 0;
+
+void eventLogPush(EventId id, int32_t a, int32_t b, int32_t c) {
+  EventRecord r;
+  r.at = millis();
+  r.id = id;
+  r.args[0] = a;
+  r.args[1] = b;
+  r.args[2] = c;
+  records.push(r);  // Full: dropped and counted
+}
+
+void eventLogDrain() {
+  // Only what fits the UART buffer, so loop() never waits on the wire
+  EventRecord r;
+  while (Serial.availableForWrite() >= EVENT_LOG_LINE_MAX && records.pop(r)) {
+    Serial.printf("[%lums] ", (unsigned long)r.at);
+    Serial.printf(eventFormats[r.id], (long)r.args[0], (long)r.args[1], (long)r.args[2]);
+    Serial.println();
+  }
+
+  uint32_t dropped = records.dropped();
+  if (dropped != droppedReported && Serial.availableForWrite() >= EVENT_LOG_LINE_MAX) {
+    Serial.printf("[LOG] %lu records dropped (ring full)\n", (unsigned long)(dropped - droppedReported));
+    droppedReported = dropped;
+  }
+}
+
+uint32_t eventLogDropped() {
+  return records.dropped();
+}
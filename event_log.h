@@ -0,0 +1,68 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdint.h>
+
+// ===== DEFERRED EVENT LOG =====
+// The ESP-NOW callbacks run in the WiFi task, where a Serial.print at
+// 115200 baud holds the radio for as long as the UART needs. They push a
+// compact record instead - event ID, millis() and up to three integer args -
+// into a lock-free ring, and loop() formats and prints records while the
+// UART has room. A full ring drops the record and counts it.
+//
+// Single producer: only the WiFi task (receive and send callbacks) logs
+// here. Everything else prints directly.
+
+#define LOG_LEVEL_OFF 0
+#define LOG_LEVEL_WARN 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3   // Per-packet events
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define EVENT_LOG_SLOTS 64  // Power of two
+
+// X(id, level, format): args arrive as long (%ld), unused ones are ignored
+#define EVENT_LOG_EVENTS(X) \
+  X(EV_SEND_FAIL,         WARN,  "ESP-NOW: Send FAIL") \
+  X(EV_RX_WRONG_SIZE,     WARN,  "ESP-NOW: WRONG SIZE, expected %ld, got %ld") \
+  X(EV_CHUNK_CORRUPT,     WARN,  "  Encoded chunk: BAD VERSION/CRC (%ld bytes)") \
+  X(EV_STATE_CORRUPT,     WARN,  "  State packet: BAD VERSION/CRC (%ld bytes)") \
+  X(EV_CHUNK_MALFORMED,   WARN,  "  Encoded chunk: MALFORMED (%ld bytes)") \
+  X(EV_MESH_MALFORMED,    WARN,  "  Relayed packet: MALFORMED (%ld bytes)") \
+  X(EV_LEADER_DETECTED,   INFO,  "  >>> LEADER DETECTED - now following <<<") \
+  X(EV_LEADER_CHANGED,    INFO,  "  >>> NEW LEADER after %ldms of silence - now following <<<") \
+  X(EV_LEADER_MERGED,     INFO,  "  >>> HIGHER LEADER reached - now following <<<") \
+  X(EV_RX_PACKET,         DEBUG, "ESP-NOW RX: %ld bytes, hop %ld") \
+  X(EV_RX_LEADER,         DEBUG, "ESP-NOW RX: %ld bytes - IGNORED (I'm a leader)") \
+  X(EV_RX_OTHER_LEADER,   DEBUG, "ESP-NOW RX: %ld bytes - IGNORED (another leader)") \
+  X(EV_FRAME_COMPLETE,    DEBUG, "  COMPLETE FRAME %ld - LEDs updated") \
+  X(EV_TORN_PRESENTED,    DEBUG, "  ~ TORN FRAME presented (policy), %ld%% of chunks") \
+  X(EV_NEED_KEYFRAME,     DEBUG, "  ... delta without reference, waiting for keyframe") \
+  X(EV_CHUNK_LATE,        DEBUG, "  ... LATE chunk of frame %ld, dropped") \
+  X(EV_V1_PACKET,         DEBUG, "  Packet: seq=%ld, start=%ld, count=%ld") \
+  X(EV_V1_OUTSIDE_STRIP,  DEBUG, "  ... outside our strip, ignored (start=%ld)") \
+  X(EV_V1_DROPPED,        DEBUG, "  ... late or duplicate packet, dropped") \
+  X(EV_V1_WAITING,        DEBUG, "  ... waiting for more packets")
+
+#define EVENT_LOG_ID(id, level, format) id,
+enum EventId : uint8_t { EVENT_LOG_EVENTS(EVENT_LOG_ID) EVENT_COUNT };
+#undef EVENT_LOG_ID
+
+#define EVENT_LOG_LEVEL(id, level, format) LOG_LEVEL_##level,
+static constexpr uint8_t eventLevels[] = { EVENT_LOG_EVENTS(EVENT_LOG_LEVEL) };
+#undef EVENT_LOG_LEVEL
+
+// The level test folds away at compile time: filtered events cost nothing
+#define LOG_EVENT(id, ...)                                     \
+  do {                                                         \
+    if (eventLevels[id] <= LOG_LEVEL) eventLogPush(id, ##__VA_ARGS__); \
+  } while (0)
+
+void eventLogPush(EventId id, int32_t a = 0, int32_t b = 0, int32_t c = 0);  // Producer: WiFi task
+void eventLogDrain();                // loop(): print what the UART can take without blocking
+uint32_t eventLogDropped();
+
+#endif
@@ -0,0 +1,462 @@
+#include "frame_codec.h"
+#include <stddef.h>
+
+// ===== CRC =====
+uint16_t crc16(const uint8_t* data, size_t len, uint16_t crc) {
+  // Nibble table: 32 bytes of flash, two lookups per byte
+  static const uint16_t table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+  };
+  for (size_t i = 0; i < len; i++) {
+    crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)]);
+    crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)]);
+  }
+  return crc;
+}
+
+// CRC of a packet as sent: the crc field at offset at counts as zero
+static uint16_t crcSkippingField(const uint8_t* data, size_t len, size_t at) {
+  static const uint8_t zero[2] = {0, 0};
+  uint16_t crc = crc16(data, at);
+  crc = crc16(zero, 2, crc);
+  return crc16(data + at + 2, len - at - 2, crc);
+}
+
+static uint16_t chunkCrc(const uint8_t* data, size_t len) {
+  return crcSkippingField(data, len, offsetof(EncodedChunkHeader, crc));
+}
+
+// Parity image of a data chunk: pixelStart, pixelCount and payload length
+// (little endian) into image, followed by the payload it returns
+static const uint8_t* chunkImageHeader(const uint8_t* data, int len, uint8_t* image) {
+  EncodedChunkHeader h;
+  memcpy(&h, data, sizeof(h));
+  uint16_t payloadLen = (uint16_t)(len - sizeof(h) - ((h.flags & CHUNK_FLAG_PADDED) ? 1 : 0));
+  uint16_t fields[3] = {h.pixelStart, h.pixelCount, payloadLen};
+  for (int i = 0; i < 3; i++) {
+    image[2 * i] = (uint8_t)fields[i];
+    image[2 * i + 1] = (uint8_t)(fields[i] >> 8);
+  }
+  return data + sizeof(h);
+}
+
+// ===== PIXEL RLE =====
+static inline bool samePixel(const uint8_t* a, const uint8_t* b) {
+  return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+// Encode pixels (3 bytes each) into out until it is full. Returns bytes
+// written; consumed = pixels encoded.
+static size_t rleEncode(const uint8_t* px, size_t count, uint8_t* out, size_t cap, size_t& consumed) {
+  size_t o = 0, i = 0;
+  while (i < count) {
+    size_t run = 1;
+    while (i + run < count && run < 129 && samePixel(px + 3 * i, px + 3 * (i + run))) run++;
+
+    if (run >= 2) {
+      if (o + 4 > cap) break;
+      out[o++] = (uint8_t)(0x7E + run);
+      memcpy(out + o, px + 3 * i, 3);
+      o += 3;
+      i += run;
+      continue;
+    }
+
+    // Literal: gather pixels until the next run of 2 starts
+    size_t lit = 1;
+    while (i + lit < count && lit < 128 &&
+           !(i + lit + 1 < count && samePixel(px + 3 * (i + lit), px + 3 * (i + lit + 1)))) {
+      lit++;
+    }
+    size_t room = cap > o + 1 ? (cap - o - 1) / 3 : 0;
+    if (room == 0) break;
+    if (lit > room) lit = room;
+    out[o++] = (uint8_t)(lit - 1);
+    memcpy(out + o, px + 3 * i, 3 * lit);
+    o += 3 * lit;
+    i += lit;
+  }
+  consumed = i;
+  return o;
+}
+
+// Decode exactly count pixels; xorInto applies them as XOR onto px
+static bool rleDecode(const uint8_t* in, size_t len, uint8_t* px, size_t count, bool xorInto) {
+  size_t o = 0, i = 0;
+  while (i < len && o < count) {
+    uint8_t t = in[i++];
+    if (t & 0x80) {
+      size_t run = t - 0x7E;
+      if (i + 3 > len || o + run > count) return false;
+      for (size_t k = 0; k < run; k++, o++) {
+        for (int c = 0; c < 3; c++) px[3 * o + c] = xorInto ? px[3 * o + c] ^ in[i + c] : in[i + c];
+      }
+      i += 3;
+    } else {
+      size_t lit = t + 1;
+      if (i + 3 * lit > len || o + lit > count) return false;
+      for (size_t k = 0; k < 3 * lit; k++) px[3 * o + k] = xorInto ? px[3 * o + k] ^ in[i + k] : in[i + k];
+      i += 3 * lit;
+      o += lit;
+    }
+  }
+  return o == count && i == len;
+}
+
+// ===== LEADER =====
+static size_t chunkPayloadLen(const EncodedPacket& p) {
+  uint8_t image[FEC_IMAGE_HEADER];
+  chunkImageHeader(p.data, p.len, image);
+  return (size_t)(image[4] | image[5] << 8);
+}
+
+// Parity group size for a frame of data chunks: SYNC_FEC_GROUP, or with
+// SYNC_FEC_V1_BUDGET the smallest from there up whose parity still keeps the
+// frame within the bytes raw v1 packets would take for it. Busy frames that
+// no group fits get the fewest parity chunks there are, not none.
+static int fecGroupSize(const EncodedPacket* data, int dataPackets, uint16_t count) {
+  if (SYNC_FEC_GROUP == 0 || !SYNC_FEC_V1_BUDGET) return SYNC_FEC_GROUP;
+  size_t budget = (size_t)(count + V1_LEDS_PER_PACKET - 1) / V1_LEDS_PER_PACKET * V1_PACKET_SIZE;
+  size_t used = 0;
+  for (int i = 0; i < dataPackets; i++) used += data[i].len;
+  for (int group = SYNC_FEC_GROUP;; group++) {
+    size_t parity = 0;
+    for (int first = 0; first < dataPackets; first += group) {
+      size_t longest = 0;
+      for (int i = first; i < first + group && i < dataPackets; i++) {
+        size_t len = chunkPayloadLen(data[i]);
+        if (len > longest) longest = len;
+      }
+      parity += sizeof(EncodedChunkHeader) + FEC_IMAGE_HEADER + longest + 1;  // + a pad byte at worst
+    }
+    // Already one group for the whole frame, or as large as the flags carry
+    if (used + parity <= budget || group >= dataPackets || group == FEC_MAX_GROUP) return group;
+  }
+}
+
+int encodeFrame(const CRGB* frame, CRGB* reference, uint16_t count, bool keyframe,
+                uint8_t frameSeq, uint8_t brightness, uint32_t presentAt, EncodedPacket* out, int maxPackets) {
+  static uint8_t source[3 * ENCODED_MAX_LEDS];
+  if (count > sizeof(source) / 3) return 0;
+
+  // Keyframes carry pixels, deltas the XOR against what followers show
+  const uint8_t* px = (const uint8_t*)frame;
+  const uint8_t* ref = (const uint8_t*)reference;
+  for (size_t k = 0; k < 3u * count; k++) source[k] = keyframe ? px[k] : px[k] ^ ref[k];
+
+  int packets = 0;
+  size_t start = 0;
+  while (start < count || packets == 0) {
+    if (packets >= maxPackets || packets >= ENCODED_MAX_CHUNKS) return 0;
+    EncodedPacket& p = out[packets];
+    EncodedChunkHeader* h = (EncodedChunkHeader*)p.data;
+    size_t consumed = 0;
+    size_t bytes = rleEncode(source + 3 * start, count - start, p.data + sizeof(EncodedChunkHeader),
+                             ENCODED_MAX_PAYLOAD, consumed);
+    h->magic = ENCODED_MAGIC;
+    h->version = SYNC_WIRE_VERSION;
+    h->flags = keyframe ? CHUNK_FLAG_KEYFRAME : 0;
+    h->frameSeq = frameSeq;
+    h->refSeq = (uint8_t)(frameSeq - 1);
+    h->chunkIndex = (uint8_t)packets;
+    h->pixelStart = (uint16_t)start;
+    h->pixelCount = (uint16_t)consumed;
+    h->brightness = brightness;
+    h->presentAt = presentAt;
+    p.len = (uint16_t)(sizeof(EncodedChunkHeader) + bytes);
+    if (p.len == V1_PACKET_SIZE) {
+      // Old followers accept anything of exactly this size as raw pixels
+      h->flags |= CHUNK_FLAG_PADDED;
+      p.data[p.len++] = 0;
+    }
+    start += consumed;
+    packets++;
+  }
+  const int dataPackets = packets;
+  const int group = fecGroupSize(out, dataPackets, count);
+  for (int i = 0; i < dataPackets; i++) {
+    EncodedChunkHeader* h = (EncodedChunkHeader*)out[i].data;
+    h->chunkCount = (uint8_t)dataPackets;
+    h->flags = (h->flags & ((1 << CHUNK_FEC_SHIFT) - 1)) | (group << CHUNK_FEC_SHIFT);
+  }
+
+  for (int first = 0; group && first < dataPackets; first += group) {
+    if (packets >= maxPackets) return 0;
+    EncodedPacket& p = out[packets];
+    EncodedChunkHeader* h = (EncodedChunkHeader*)p.data;
+    memcpy(h, out[first].data, sizeof(EncodedChunkHeader));  // Frame fields
+    h->flags = (h->flags & ~CHUNK_FLAG_PADDED) | CHUNK_FLAG_PARITY;
+    h->chunkIndex = (uint8_t)(first / group);
+    h->pixelStart = 0;
+    h->pixelCount = 0;
+
+    uint8_t* parity = p.data + sizeof(EncodedChunkHeader);
+    memset(parity, 0, FEC_IMAGE_MAX);
+    size_t imageLen = FEC_IMAGE_HEADER;
+    for (int i = first; i < first + group && i < dataPackets; i++) {
+      uint8_t image[FEC_IMAGE_HEADER];
+      const uint8_t* payload = chunkImageHeader(out[i].data, out[i].len, image);
+      size_t payloadLen = (size_t)(image[4] | image[5] << 8);
+      for (int k = 0; k < FEC_IMAGE_HEADER; k++) parity[k] ^= image[k];
+      for (size_t k = 0; k < payloadLen; k++) parity[FEC_IMAGE_HEADER + k] ^= payload[k];
+      if (FEC_IMAGE_HEADER + payloadLen > imageLen) imageLen = FEC_IMAGE_HEADER + payloadLen;
+    }
+    p.len = (uint16_t)(sizeof(EncodedChunkHeader) + imageLen);
+    if (p.len == V1_PACKET_SIZE) {
+      h->flags |= CHUNK_FLAG_PADDED;
+      p.data[p.len++] = 0;
+    }
+    packets++;
+  }
+
+  for (int i = 0; i < packets; i++) {
+    EncodedChunkHeader* h = (EncodedChunkHeader*)out[i].data;
+    h->crc = chunkCrc(out[i].data, out[i].len);
+  }
+
+  memcpy(reference, frame, 3u * count);
+  return packets;
+}
+
+// ===== FRAME ASSEMBLY =====
+static inline uint32_t fullBitmap(uint8_t chunkCount) {
+  return chunkCount >= 32 ? 0xFFFFFFFFu : (1u << chunkCount) - 1;
+}
+
+AssemblyResult assemblyBegin(FrameAssembler& a, uint8_t frameSeq, uint8_t chunkIndex, uint8_t chunkCount) {
+  if (a.started) {
+    int8_t age = (int8_t)(frameSeq - a.newestSeq);  // Wraps: +-127 frames either way
+    if (age < -ASSEMBLY_LATE_WINDOW) {
+      age = 1;  // Far behind: the leader restarted its frame IDs
+    } else if (age < 0) {
+      if (!a.lateSeen || a.lateSeq != frameSeq) a.stats.late++;
+      a.lateSeen = true;
+      a.lateSeq = frameSeq;
+      return ASSEMBLY_LATE;
+    }
+    if (age == 0) {
+      if (!a.assembling || chunkCount != a.chunkCount || (a.chunksSeen & (1u << chunkIndex))) {
+        return ASSEMBLY_DUPLICATE;
+      }
+      return ASSEMBLY_CONTINUE;
+    }
+    a.stats.dropped += age - 1;  // Frame IDs we never saw a single chunk of
+  }
+
+  bool torn = a.started && a.assembling;
+  if (torn) a.stats.torn++;
+  a.started = true;
+  a.newestSeq = frameSeq;
+  a.assembling = true;
+  a.chunksSeen = 0;
+  a.chunkCount = chunkCount;
+  return torn ? ASSEMBLY_TORN : ASSEMBLY_NEW_FRAME;
+}
+
+bool assemblyCommit(FrameAssembler& a, uint8_t chunkIndex) {
+  a.chunksSeen |= 1u << chunkIndex;
+  if (a.chunksSeen != fullBitmap(a.chunkCount)) return false;
+  a.assembling = false;
+  a.stats.complete++;
+  return true;
+}
+
+void assemblyAbandon(FrameAssembler& a) {
+  if (!a.assembling) return;
+  a.assembling = false;
+  a.stats.dropped++;
+}
+
+void assemblyReset(FrameAssembler& a) {
+  SyncStats stats = a.stats;
+  a = FrameAssembler();
+  a.stats = stats;
+}
+
+bool assemblyWouldTear(const FrameAssembler& a, uint8_t frameSeq, uint8_t* percent) {
+  if (!a.started || !a.assembling || (int8_t)(frameSeq - a.newestSeq) <= 0) return false;
+  if (percent) *percent = (uint8_t)(100 * __builtin_popcount(a.chunksSeen) / a.chunkCount);
+  return true;
+}
+
+// ===== FOLLOWER =====
+bool isEncodedPacket(const uint8_t* data, int len) {
+  return len >= (int)sizeof(EncodedChunkHeader) && data[0] == ENCODED_MAGIC;
+}
+
+bool encodedChunkIntact(const uint8_t* data, int len) {
+  if (!isEncodedPacket(data, len)) return false;
+  EncodedChunkHeader h;
+  memcpy(&h, data, sizeof(h));
+  return h.version == SYNC_WIRE_VERSION && h.crc == chunkCrc(data, len);
+}
+
+uint8_t encodedFrameSeq(const uint8_t* data) {
+  return ((const EncodedChunkHeader*)data)->frameSeq;
+}
+
+// ----- FEC -----
+// Group g's accumulator, cleared on first use in a frame; nullptr when the
+// frame has no parity or too many groups to track
+static FecGroup* fecGroup(FrameDecoder& d, uint8_t group) {
+  if (!d.fecGroupSize || group >= FEC_DECODE_GROUPS) return nullptr;
+  FecGroup& g = d.fec[group];
+  if (!(d.fecTouched & (1u << group))) {
+    d.fecTouched |= 1u << group;
+    g.parity = false;
+    memset(g.acc, 0, sizeof(g.acc));
+  }
+  return &g;
+}
+
+static void fecBegin(FrameDecoder& d, uint8_t groupSize) {
+  d.fecGroupSize = groupSize;
+  d.fecTouched = 0;
+  d.fecRebuilt = false;
+}
+
+static void xorInto(uint8_t* acc, const uint8_t* src, size_t len) {
+  for (size_t i = 0; i < len; i++) acc[i] ^= src[i];
+}
+
+// Decode one data chunk into pixels and mark it received
+static ChunkResult applyChunk(FrameDecoder& d, uint8_t chunkIndex, uint16_t pixelStart, uint16_t pixelCount,
+                              bool keyframe, const uint8_t* payload, int payloadLen, CRGB* pixels, uint16_t count) {
+  if (pixelStart + pixelCount > ENCODED_MAX_LEDS) return CHUNK_BAD;
+
+  // Decode via scratch so a leader with a longer strip still syncs the
+  // common part; deltas XOR onto the previous frame in pixels
+  static CRGB scratch[ENCODED_MAX_LEDS];
+  for (uint16_t i = 0; i < pixelCount; i++) {
+    uint16_t led = pixelStart + i;
+    scratch[i] = (!keyframe && led < count) ? pixels[led] : CRGB(0, 0, 0);
+  }
+  if (!rleDecode(payload, payloadLen, (uint8_t*)scratch, pixelCount, !keyframe)) return CHUNK_BAD;
+  if (pixelStart < count) {
+    uint16_t n = (pixelStart + pixelCount <= count) ? pixelCount : count - pixelStart;
+    memcpy(pixels + pixelStart, scratch, 3u * n);
+  }
+
+  if (!assemblyCommit(d.assembly, chunkIndex)) return CHUNK_PARTIAL;
+  if (d.fecRebuilt) d.assembly.stats.recovered++;
+  return CHUNK_FRAME_COMPLETE;
+}
+
+// With group's parity in and exactly one of its data chunks missing, the
+// accumulator holds that chunk: apply it
+static ChunkResult fecRecover(FrameDecoder& d, uint8_t group, bool keyframe, CRGB* pixels, uint16_t count) {
+  if (!d.fecGroupSize || group >= FEC_DECODE_GROUPS || !(d.fecTouched & (1u << group)) || !d.fec[group].parity) {
+    return CHUNK_PARTIAL;
+  }
+  uint8_t first = group * d.fecGroupSize;
+  uint8_t members = d.assembly.chunkCount - first < d.fecGroupSize ? d.assembly.chunkCount - first : d.fecGroupSize;
+  uint32_t missing = ~d.assembly.chunksSeen & (uint32_t)(((1ull << members) - 1) << first);
+  if (__builtin_popcount(missing) != 1) return CHUNK_PARTIAL;
+
+  const uint8_t* image = d.fec[group].acc;
+  uint16_t pixelStart = (uint16_t)(image[0] | image[1] << 8);
+  uint16_t pixelCount = (uint16_t)(image[2] | image[3] << 8);
+  uint16_t payloadLen = (uint16_t)(image[4] | image[5] << 8);
+  if (FEC_IMAGE_HEADER + (size_t)payloadLen > FEC_IMAGE_MAX) return CHUNK_BAD;
+  d.fecRebuilt = true;
+  return applyChunk(d, (uint8_t)__builtin_ctz(missing), pixelStart, pixelCount, keyframe, image + FEC_IMAGE_HEADER,
+                    payloadLen, pixels, count);
+}
+
+ChunkResult decodeChunk(FrameDecoder& d, const uint8_t* data, int len, CRGB* pixels, uint16_t count) {
+  if (!encodedChunkIntact(data, len)) {
+    if (isEncodedPacket(data, len)) d.assembly.stats.corrupt++;
+    return CHUNK_BAD;
+  }
+  EncodedChunkHeader h;
+  memcpy(&h, data, sizeof(h));
+  bool keyframe = h.flags & CHUNK_FLAG_KEYFRAME;
+  bool parity = h.flags & CHUNK_FLAG_PARITY;
+  uint8_t groupSize = h.flags >> CHUNK_FEC_SHIFT;
+  int payloadLen = len - (int)sizeof(h) - ((h.flags & CHUNK_FLAG_PADDED) ? 1 : 0);
+  if (payloadLen < 0 || h.chunkCount == 0 || h.chunkCount > ENCODED_MAX_CHUNKS) return CHUNK_BAD;
+  if (parity) {
+    if (groupSize == 0 || h.chunkIndex * groupSize >= h.chunkCount || payloadLen < FEC_IMAGE_HEADER) return CHUNK_BAD;
+  } else if (h.chunkIndex >= h.chunkCount) {
+    return CHUNK_BAD;
+  }
+
+  // A parity chunk isn't in the chunk bitmap: for the frame in progress it
+  // is never a duplicate, and it can start a frame like any chunk
+  AssemblyResult result;
+  if (parity && d.assembly.started && h.frameSeq == d.assembly.newestSeq) {
+    if (!d.assembly.assembling || h.chunkCount != d.assembly.chunkCount) return CHUNK_IGNORED;
+    result = ASSEMBLY_CONTINUE;
+  } else {
+    result = assemblyBegin(d.assembly, h.frameSeq, parity ? 0 : h.chunkIndex, h.chunkCount);
+  }
+
+  switch (result) {
+    case ASSEMBLY_LATE:
+      return CHUNK_LATE;
+    case ASSEMBLY_DUPLICATE:
+      return CHUNK_IGNORED;
+    case ASSEMBLY_CONTINUE:
+      break;
+    case ASSEMBLY_TORN:
+      if (d.fecGroupSize) d.assembly.stats.unrecoverable++;
+      // pixels now mix two frames, so deltas can't apply until a keyframe
+      d.synced = false;
+      // fall through
+    case ASSEMBLY_NEW_FRAME:
+      fecBegin(d, groupSize);
+      if (!keyframe && (!d.synced || h.refSeq != d.syncedSeq)) {
+        assemblyAbandon(d.assembly);
+        return CHUNK_NEED_KEYFRAME;
+      }
+      break;
+  }
+
+  const uint8_t* payload = data + sizeof(h);
+  uint8_t group = parity ? h.chunkIndex : (groupSize ? h.chunkIndex / groupSize : 0);
+  FecGroup* fec = groupSize == d.fecGroupSize ? fecGroup(d, group) : nullptr;
+  ChunkResult applied = CHUNK_PARTIAL;
+  if (parity) {
+    if (!fec || fec->parity || payloadLen > (int)FEC_IMAGE_MAX) return CHUNK_IGNORED;
+    xorInto(fec->acc, payload, payloadLen);
+    fec->parity = true;
+  } else {
+    applied = applyChunk(d, h.chunkIndex, h.pixelStart, h.pixelCount, keyframe, payload, payloadLen, pixels, count);
+    if (applied == CHUNK_BAD) return CHUNK_BAD;
+    if (fec && FEC_IMAGE_HEADER + payloadLen > (int)FEC_IMAGE_MAX) {
+      d.fecGroupSize = 0;  // Longer than any parity we can hold: no recovery this frame
+    } else if (fec) {
+      uint8_t image[FEC_IMAGE_HEADER];
+      chunkImageHeader(data, len, image);
+      xorInto(fec->acc, image, FEC_IMAGE_HEADER);
+      xorInto(fec->acc + FEC_IMAGE_HEADER, payload, payloadLen);
+    }
+  }
+
+  d.brightness = h.brightness;
+  d.presentAt = h.presentAt;
+  if (applied == CHUNK_PARTIAL) applied = fecRecover(d, group, keyframe, pixels, count);
+  if (applied != CHUNK_FRAME_COMPLETE) return applied;
+
+  d.synced = true;
+  d.syncedSeq = h.frameSeq;
+  return CHUNK_FRAME_COMPLETE;
+}
+
+// ===== PARAMETRIC SYNC =====
+bool isParamPacket(const uint8_t* data, int len) {
+  return len == (int)sizeof(ParamSyncPacket) && data[0] == PARAM_MAGIC;
+}
+
+bool paramPacketIntact(const uint8_t* data, int len) {
+  if (!isParamPacket(data, len)) return false;
+  ParamSyncPacket p;
+  memcpy(&p, data, sizeof(p));
+  return p.version == PARAM_WIRE_VERSION && p.crc == crcSkippingField(data, len, offsetof(ParamSyncPacket, crc));
+}
+
+void paramPacketSeal(ParamSyncPacket& packet) {
+  packet.version = PARAM_WIRE_VERSION;
+  packet.crc = crcSkippingField((const uint8_t*)&packet, sizeof(packet), offsetof(ParamSyncPacket, crc));
+}
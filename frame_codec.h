@@ -0,0 +1,210 @@
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include "config.h"
+#include "patterns.h"
+
+// ===== ENCODED FRAME TRANSPORT =====
+// Leader frames go out as keyframes (raw pixels) or deltas (XOR against the
+// previous frame), both run-length encoded per pixel, split into chunks
+// that each fit one ESP-NOW packet and decode on their own. Unchanged
+// pixels XOR to zero and collapse into runs, so a static or slow pattern
+// costs a few bytes per frame instead of 600.
+//
+// This is wire format v3 (v1 is the fixed 153-byte LEDSync packet): a
+// versioned header with 16-bit pixel offsets, a frame ID and a CRC, and
+// packets only as long as their payload - up to ESPNOW_MAX_PACKET, so
+// ESP-NOW v2 builds send a 1000-LED keyframe in 3 packets instead of 14.
+// v3 adds the parity chunks below.
+//
+// Payload token stream (pixel units):
+//   0x00-0x7F  literal: (t + 1) pixels follow, 3 bytes each
+//   0x80-0xFF  run: the next pixel repeats (t - 0x7E) times (2..129)
+
+#define ENCODED_MAGIC 0xE5          // v1 LEDSync packets start with a pixel index (< 250)
+#define SYNC_WIRE_VERSION 3         // Chunks of any other version are dropped
+#define KEYFRAME_INTERVAL 30        // Frames between keyframes (~0.5s at 60fps)
+#define KEYFRAME_MAX_AGE_MS 500     // Also by time: the leader skips unchanged frames
+#define ENCODED_MAX_CHUNKS 32       // Chunk bitmap is one uint32_t
+#define ENCODED_MAX_LEDS 1024       // Longest strip encodeFrame takes (and chunk range decoded)
+
+#define V1_PACKET_SIZE 153          // sizeof(LEDSync) - encoded packets never use this length
+#define V1_LEDS_PER_PACKET 49       // LEDSync startIndex / 49 is the chunk index
+
+#define CHUNK_FLAG_KEYFRAME 0x01
+#define CHUNK_FLAG_PADDED 0x02      // One trailing pad byte (avoids V1_PACKET_SIZE)
+#define CHUNK_FLAG_PARITY 0x04      // FEC parity chunk; chunkIndex is its group
+#define CHUNK_FEC_SHIFT 4           // flags >> 4: the frame's parity group size, 0 = no parity
+
+// Forward error correction: after the data chunks of a frame the leader
+// sends one parity chunk per group of them - the XOR of their pixel ranges
+// and payloads - so a follower rebuilds any one lost chunk of a group
+// without a retransmission. Groups are SYNC_FEC_GROUP chunks. The group
+// size travels in every chunk's flags. Also costs FEC_IMAGE_HEADER bytes of
+// each data chunk. 0 sends no parity; followers decode it either way.
+#ifndef SYNC_FEC_GROUP
+#define SYNC_FEC_GROUP 4
+#endif
+// 1: groups grow (up to the whole frame) while a parity chunk per
+// SYNC_FEC_GROUP would make the frame longer than raw v1 packets. A frame
+// that even one group overruns still gets it.
+#ifndef SYNC_FEC_V1_BUDGET
+#define SYNC_FEC_V1_BUDGET 0
+#endif
+#define FEC_MAX_GROUP 15            // CHUNK_FEC_SHIFT leaves 4 bits for it
+#if SYNC_FEC_GROUP > FEC_MAX_GROUP
+#error "SYNC_FEC_GROUP must fit CHUNK_FEC_SHIFT's 4 bits"
+#endif
+
+#if SYNC_FEC_GROUP > 0
+#define FEC_PARITY_PACKETS(chunks) (((chunks) + SYNC_FEC_GROUP - 1) / SYNC_FEC_GROUP)
+#else
+#define FEC_PARITY_PACKETS(chunks) 0
+#endif
+// Parity groups a follower tracks per frame: every group of a full frame
+// from a leader built alike (8 with no parity of its own)
+#define FEC_DECODE_GROUPS (SYNC_FEC_GROUP ? FEC_PARITY_PACKETS(ENCODED_MAX_CHUNKS) : 8)
+#define FEC_IMAGE_HEADER 6          // pixelStart, pixelCount, payload length - XORed like the payload
+
+struct __attribute__((packed)) EncodedChunkHeader {
+  uint8_t magic;        // ENCODED_MAGIC
+  uint8_t version;      // SYNC_WIRE_VERSION
+  uint8_t flags;        // CHUNK_FLAG_*
+  uint8_t frameSeq;     // Frame this chunk belongs to
+  uint8_t refSeq;       // Delta: frame the XOR is against (== frameSeq - 1)
+  uint8_t chunkIndex;
+  uint8_t chunkCount;
+  uint16_t pixelStart;
+  uint16_t pixelCount;
+  uint8_t brightness;
+  uint32_t presentAt;   // Leader micros() to show the frame at (clock_sync.h)
+  uint16_t crc;         // CRC-16/CCITT of the whole packet with this field zero
+};
+
+#define ENCODED_MAX_PAYLOAD \
+  (ESPNOW_MAX_PACKET - MESH_RELAY_OVERHEAD - sizeof(EncodedChunkHeader) - (SYNC_FEC_GROUP ? FEC_IMAGE_HEADER : 0))
+#define ENCODED_MAX_PACKETS (ENCODED_MAX_CHUNKS + FEC_PARITY_PACKETS(ENCODED_MAX_CHUNKS))  // Data + parity
+#define FEC_IMAGE_MAX (ESPNOW_MAX_PACKET - sizeof(EncodedChunkHeader))  // Largest parity payload
+
+struct EncodedPacket {
+  uint8_t data[ESPNOW_MAX_PACKET];
+  uint16_t len;
+};
+
+// ----- Leader -----
+// Encodes frame as chunks, then their parity chunks; reference holds what
+// followers should already show and is updated to frame. Returns the number
+// of packets (0 if count > ENCODED_MAX_LEDS or the frame needs more than
+// maxPackets; ENCODED_MAX_PACKETS always holds ENCODED_MAX_LEDS).
+int encodeFrame(const CRGB* frame, CRGB* reference, uint16_t count, bool keyframe,
+                uint8_t frameSeq, uint8_t brightness, uint32_t presentAt, EncodedPacket* out, int maxPackets);
+
+// ===== FRAME ASSEMBLY =====
+// Follower bookkeeping for any chunked sync stream with 8-bit frame IDs:
+// which chunks of the newest frame have arrived, and what happened to the
+// frames that never completed. Followers assemble into a back buffer and
+// only present it once assemblyCommit() reports the frame complete.
+struct SyncStats {
+  uint32_t complete = 0;  // Frames assembled in full
+  uint32_t torn = 0;      // Superseded by a newer frame while incomplete
+  uint32_t late = 0;      // Chunks arrived after a newer frame had started
+  uint32_t dropped = 0;   // Frame IDs never seen, or unusable (delta without reference)
+  uint32_t partial = 0;   // Torn frames presented anyway (follower policy)
+  uint32_t corrupt = 0;   // Packets failing the version or CRC check
+  uint32_t recovered = 0;      // Completed with a chunk rebuilt from parity
+  uint32_t unrecoverable = 0;  // Torn despite parity: two chunks of a group, or the parity, lost
+};
+
+#define ASSEMBLY_LATE_WINDOW 16     // Frames older than this mean the leader restarted
+
+struct FrameAssembler {
+  bool started = false;     // newestSeq is valid
+  uint8_t newestSeq = 0;    // Newest frame ID seen
+  bool assembling = false;  // newestSeq is still missing chunks
+  uint32_t chunksSeen = 0;  // Bitmap for newestSeq
+  uint8_t chunkCount = 0;
+  bool lateSeen = false;
+  uint8_t lateSeq = 0;      // Last late frame ID (late counts frames, not chunks)
+  SyncStats stats;
+};
+
+enum AssemblyResult {
+  ASSEMBLY_LATE,       // Chunk of an older frame - drop it
+  ASSEMBLY_DUPLICATE,  // Chunk already applied, or its frame was abandoned
+  ASSEMBLY_CONTINUE,   // Next chunk of the frame being assembled
+  ASSEMBLY_NEW_FRAME,  // First chunk of a newer frame
+  ASSEMBLY_TORN        // First chunk of a newer frame; the previous one never completed
+};
+
+// Classify a chunk and start a new frame if it is newer. chunkIndex must be
+// below chunkCount, and chunkCount at most ENCODED_MAX_CHUNKS.
+AssemblyResult assemblyBegin(FrameAssembler& a, uint8_t frameSeq, uint8_t chunkIndex, uint8_t chunkCount);
+bool assemblyCommit(FrameAssembler& a, uint8_t chunkIndex);  // Chunk applied; true when the frame is complete
+void assemblyAbandon(FrameAssembler& a);                     // Frame in progress can't be shown
+void assemblyReset(FrameAssembler& a);                       // New leader: forget frame IDs, keep stats
+// Would a chunk of frameSeq tear the frame in progress? percent = its chunks received
+bool assemblyWouldTear(const FrameAssembler& a, uint8_t frameSeq, uint8_t* percent);
+
+// ----- Follower -----
+enum ChunkResult {
+  CHUNK_BAD,            // Malformed
+  CHUNK_LATE,           // Older than the newest frame - dropped
+  CHUNK_IGNORED,        // Duplicate, or frame already abandoned
+  CHUNK_NEED_KEYFRAME,  // Delta against a frame we don't have - dropped
+  CHUNK_PARTIAL,        // Applied, frame not complete yet
+  CHUNK_FRAME_COMPLETE  // Applied, every chunk of the frame has arrived
+};
+
+// XOR of the chunk images (FEC_IMAGE_HEADER + payload) of one parity group
+// received so far; with the parity in and one data chunk missing, it is
+// that chunk's image
+struct FecGroup {
+  bool parity;
+  uint8_t acc[FEC_IMAGE_MAX];
+};
+
+struct FrameDecoder {
+  FrameAssembler assembly;
+  bool synced = false;          // pixels match the leader's frame syncedSeq
+  uint8_t syncedSeq = 0;
+  uint8_t brightness = 0;
+  uint32_t presentAt = 0;       // Of the frame being assembled
+  uint8_t fecGroupSize = 0;     // Of the frame being assembled, 0 = no parity
+  uint32_t fecTouched = 0;      // Bitmap of fec[] in use this frame
+  bool fecRebuilt = false;      // A chunk of this frame came from parity
+  FecGroup fec[FEC_DECODE_GROUPS];
+};
+
+// pixels is the follower's back buffer: it must keep its contents between
+// calls, and only holds a presentable frame after CHUNK_FRAME_COMPLETE
+ChunkResult decodeChunk(FrameDecoder& decoder, const uint8_t* data, int len, CRGB* pixels, uint16_t count);
+bool isEncodedPacket(const uint8_t* data, int len);   // Magic only - routing
+bool encodedChunkIntact(const uint8_t* data, int len);  // Version and CRC match
+uint8_t encodedFrameSeq(const uint8_t* data);  // Frame ID of an intact encoded packet
+
+// ===== PARAMETRIC SYNC =====
+// Pattern state instead of pixels: followers render the frame themselves
+// from the same RenderState (renderFromState), one small packet per frame
+// whatever the strip length. Only for sources that render deterministically.
+// Like encoded chunks, packets carry a wire version and a CRC-16: a
+// RenderState of another layout but the same size would misrender.
+#define PARAM_MAGIC 0xE6
+#define PARAM_WIRE_VERSION 1  // Bump with any change to RenderState or PatternSnapshot
+
+struct __attribute__((packed)) ParamSyncPacket {
+  uint8_t magic;        // PARAM_MAGIC
+  uint8_t version;      // PARAM_WIRE_VERSION
+  uint8_t frameSeq;
+  uint8_t brightness;   // FastLED global brightness
+  uint16_t crc;         // CRC-16 of the packet with this field zero
+  uint32_t presentAt;   // Leader micros() to show the frame at (clock_sync.h)
+  RenderState state;
+};
+
+bool isParamPacket(const uint8_t* data, int len);       // Magic and size only - routing
+bool paramPacketIntact(const uint8_t* data, int len);  // Version and CRC match
+void paramPacketSeal(ParamSyncPacket& packet);         // Sets version and CRC; fill the rest first
+
+uint16_t crc16(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF);  // CRC-16/CCITT-FALSE
+
+#endif
@@ -0,0 +1,55 @@
+// Dumps the capture-side audio features for a WAV file.
+//
+// Feeds the file through M5.Mic -> captureAudioBlock() -> popAudioFeature(),
+// the same path the device's capture task and loop() use, on a manual clock
+// that advances by one block per capture. Prints one CSV row per block.
+//
+// Also feeds the flux into the tempo tracker and prints its running estimate.
+//
+// Usage: audio_features <file.wav>
+
+#include "config.h"
+#include "audio_capture.h"
+#include "tempo.h"
+#include "wav_source.h"
+
+// Defined by m5lights_v1.ino on the device
+NodeMode currentMode = MODE_MUSIC;
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <file.wav>\n", argv[0]);
+    return 2;
+  }
+  if (!wavSourceOpen(argv[1])) return 1;
+  startAudioCapture(wavSourceSampleRate());
+  tempoInit((float)wavSourceSampleRate() / AUDIO_BLOCK_LEN);
+
+  hostClockSetManual(true);
+  const uint64_t blockUs = (uint64_t)AUDIO_BLOCK_LEN * 1000000 / wavSourceSampleRate();
+  uint64_t elapsedUs = 0;
+  int blocks = 0, onsets = 0;
+
+  printf("ms,level,onset,flux,bpm,confidence\n");
+  for (;;) {
+    // Clock ticks in whole microseconds; carry the remainder so it doesn't drift
+    uint64_t target = (uint64_t)(blocks + 1) * AUDIO_BLOCK_LEN * 1000000 / wavSourceSampleRate();
+    hostClockAdvanceMicros((uint32_t)(target - elapsedUs));
+    elapsedUs = target;
+    if (!captureAudioBlock()) break;
+    blocks++;
+
+    AudioFeature f;
+    while (popAudioFeature(f)) {
+      tempoAddOnsetStrength(f.flux);
+      printf("%u,%.4f,%d,%u,%.1f,%.2f\n", f.timestampMs, f.level, f.onset ? 1 : 0, f.flux,
+             tempoBPM(), tempoConfidence());
+      if (f.onset) onsets++;
+    }
+  }
+
+  fprintf(stderr, "%d blocks (%.1fms each), %d onsets, %u dropped\n",
+          blocks, blockUs / 1000.0, onsets, audioFeaturesDropped());
+  wavSourceClose();
+  return 0;
+}
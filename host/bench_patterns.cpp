@@ -0,0 +1,125 @@
+// Host microbenchmark for the m5lights pattern engine.
+//
+// Renders every pattern through renderPattern() (the same path loop() uses)
+// with and without an active cross-fade, in normal and music mode, and
+// reports ns/frame and ns/pixel. Music mode sweeps the brightness envelope
+// every frame so the output stage LUT is rebuilt each time (worst case).
+// NUM_LEDS is a compile-time constant in the firmware, so the Makefile builds
+// one binary per strip length.
+//
+// Usage: bench_patterns_<N> [frames]
+
+#include "config.h"
+#include "patterns.h"
+#include "audio.h"
+#include "spectral.h"
+
+#include <chrono>
+
+// Defined by m5lights_v1.ino on the device
+NodeMode currentMode = MODE_NORMAL;
+
+static const int WARMUP_FRAMES = 100;
+
+static double nowNs() {
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Checksum of the frame buffer so the compiler can't drop the render work
+static uint32_t frameChecksum = 0;
+
+static void foldFrame() {
+  for (int i = 0; i < NUM_LEDS; i++) {
+    frameChecksum = frameChecksum * 31 + leds[i].r + (leds[i].g << 8) + (leds[i].b << 16);
+  }
+}
+
+static void renderFrame(int f) {
+  if (currentMode == MODE_MUSIC) {
+    brightnessEnvelope = BRIGHTNESS_MIN + (f % (BRIGHTNESS_MAX - BRIGHTNESS_MIN));
+  }
+  renderPattern();
+}
+
+static double timeFrames(int frames) {
+  for (int f = 0; f < WARMUP_FRAMES; f++) renderFrame(f);
+  double start = nowNs();
+  for (int f = 0; f < frames; f++) renderFrame(f);
+  double elapsed = nowNs() - start;
+  foldFrame();
+  return elapsed / frames;
+}
+
+static void benchPattern(uint8_t pattern, bool fade, bool music, int frames) {
+  randomSeed(1234 + pattern);
+  currentMode = music ? MODE_MUSIC : MODE_NORMAL;
+  selectPattern(pattern);
+  if (fade) {
+    nextPattern();
+    fadeAmount = 0.5f;  // updateCrossFade() is never called, so it stays mid-fade
+  }
+
+  double nsPerFrame = timeFrames(frames);
+  printf("%-12s %-7s %-5s %12.0f %10.2f\n", patternNames[pattern], music ? "music" : "normal",
+         fade ? "on" : "off", nsPerFrame, nsPerFrame / NUM_LEDS);
+}
+
+template <typename Fn>
+static void benchPrimitive(const char* name, int iterations, Fn fn) {
+  double start = nowNs();
+  for (int i = 0; i < iterations; i++) fn(i);
+  double elapsed = nowNs() - start;
+  printf("%-12s %12.2f ns/call\n", name, elapsed / iterations);
+}
+
+int main(int argc, char** argv) {
+  int frames = (argc > 1) ? atoi(argv[1]) : 2000;
+  if (frames <= 0) frames = 2000;
+
+  Serial.enabled = false;  // nextPattern()/audio debug prints would skew timings
+
+  printf("m5lights pattern benchmark: NUM_LEDS=%d frames=%d\n", NUM_LEDS, frames);
+  printf("%-12s %-7s %-5s %12s %10s\n", "pattern", "mode", "fade", "ns/frame", "ns/pixel");
+  for (uint8_t p = 0; p < gPatternCount; p++) {
+    for (int music = 0; music < 2; music++) {
+      benchPattern(p, false, music, frames);
+      benchPattern(p, true, music, frames);
+    }
+  }
+  currentMode = MODE_NORMAL;
+
+  const int iterations = 1000000;
+  volatile uint32_t sink = 0;
+  printf("\n");
+  benchPrimitive("hsvToRgb", iterations, [&](int i) {
+    byte r, g, b;
+    hsvToRgb(i * 7, 255, 200, &r, &g, &b);
+    sink += r + g + b;
+  });
+  benchPrimitive("fixSin", iterations, [&](int i) { sink += fixSin(i * 3); });
+  benchPrimitive("fixCos", iterations, [&](int i) { sink += fixCos(i * 3); });
+  benchPrimitive("gammaTable", iterations, [&](int i) {
+    sink += gammaTable[i & 255] + gammaTable[(i >> 8) & 255] + gammaTable[(i >> 16) & 255];
+  });
+  benchPrimitive("blendFrames", iterations / NUM_LEDS, [&](int i) {
+    blendFrames(leds, ledsNext, (i & 255) + 1, NUM_LEDS);
+    sink += leds[i % NUM_LEDS].r;
+  });
+  benchPrimitive("intervalStats.add", iterations, [&](int i) {
+    beatIntervalStats.add(300 + (i * 37) % 900);
+  });
+  benchPrimitive("getMedianInterval", iterations, [&](int i) { sink += getMedianInterval(); });
+
+  // One FFT + flux per captured block; the device logs its own cost as fft=avg/peak
+  static int16_t block[SPECTRAL_FFT_SIZE];
+  for (int i = 0; i < SPECTRAL_FFT_SIZE; i++) block[i] = (int16_t)(fixSin(i * 7) * 200 + random(2000) - 1000);
+  spectralInit(MIC_SR);
+  benchPrimitive("spectralAnalyse", iterations / 1000, [&](int i) {
+    block[i & (SPECTRAL_FFT_SIZE - 1)] ^= (int16_t)i;
+    sink += spectralAnalyse(block).flux;
+  });
+
+  printf("\nchecksum %08x\n", (unsigned)(frameChecksum ^ sink));
+  return 0;
+}
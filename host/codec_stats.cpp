@@ -0,0 +1,159 @@
+// Encoded frame transport check: renders every pattern, encodes each frame
+// the way the leader broadcasts it (keyframe every KEYFRAME_INTERVAL frames,
+// XOR/RLE deltas between), decodes it as a follower would and compares.
+// Reports payload bytes and packets per frame against raw v1 LEDSync
+// packets. Each frame is also re-rendered from its parametric RenderState
+// (a cross-fade starts halfway through). With FEC, a second follower loses
+// one data chunk of every frame that carries parity (a different one each
+// frame) and must rebuild it from parity. Parity bytes are also reported on
+// their own, and a pattern whose encoded frames outweigh raw v1 is flagged.
+// Every packet is also wrapped as a mesh relay would send it: the copy must
+// never be V1_PACKET_SIZE (old followers show that as pixels) and must
+// unwrap to the original. First, with the pattern pool exhausted, leader and
+// follower must both render black. Exits nonzero if any decoded, rebuilt or
+// re-rendered frame differs, or any relayed copy fails.
+//
+// Usage: codec_stats_<N> [frames]
+// codec_stats_budget_<N> is built with SYNC_FEC_V1_BUDGET.
+
+#include "config.h"
+#include "patterns.h"
+#include "frame_codec.h"
+#include "audio.h"
+#include "mesh.h"
+
+// Defined by m5lights_v1.ino on the device
+NodeMode currentMode = MODE_NORMAL;
+
+static CRGB reference[NUM_LEDS];
+static CRGB follower[NUM_LEDS];
+static CRGB lossyFollower[NUM_LEDS];
+static CRGB paramFollower[NUM_LEDS];
+static EncodedPacket packets[ENCODED_MAX_PACKETS];
+
+static const uint8_t leaderMac[6] = {0x02, 0, 0, 0, 0, 1};
+static int relayFailures = 0, relayPadded = 0;
+
+// Relay one packet a hop and unwrap it on the far side
+static void checkRelayed(const uint8_t* data, int len) {
+  MeshArrival arrival = {leaderMac, leaderMac, 0, MESH_MAX_HOPS, 0};
+  uint8_t relayed[ESPNOW_MAX_PACKET];
+  int relayedLen = meshWrap(data, len, arrival, relayed);
+  if (relayedLen == 0) return;  // Too big to relay: counted as oversize on the device
+  if (relayedLen != len + (int)sizeof(MeshRelayHeader)) relayPadded++;
+  const uint8_t* inner = relayed;
+  int innerLen = relayedLen;
+  MeshArrival far;
+  if (relayedLen == V1_PACKET_SIZE || !meshUnwrap(leaderMac, inner, innerLen, far) || innerLen != len ||
+      memcmp(inner, data, len) != 0 || far.hops != 1) {
+    relayFailures++;
+  }
+}
+
+int main(int argc, char** argv) {
+  int frames = argc > 1 ? atoi(argv[1]) : 600;
+  Serial.enabled = false;
+  hostClockSetManual(true);  // Patterns animate on millis(): step a real 16ms per frame
+  audioDetected = false;     // Base pattern speed (1.0x), no beat envelope
+
+  const int rawPackets = (NUM_LEDS + V1_LEDS_PER_PACKET - 1) / V1_LEDS_PER_PACKET;
+  const double rawBytes = rawPackets * V1_PACKET_SIZE;
+  printf("codec_stats: %d LEDs, %d frames/pattern, raw v1 = %d packets / %d bytes per frame\n\n",
+         NUM_LEDS, frames, rawPackets, rawPackets * V1_PACKET_SIZE);
+  printf("encoded v%d = up to %d-byte packets, 1 parity per %d%s chunks, "
+         "parametric = 1 packet / %d bytes per frame\n\n",
+         SYNC_WIRE_VERSION, ESPNOW_MAX_PACKET, SYNC_FEC_GROUP, SYNC_FEC_V1_BUDGET ? "+ (raw v1 budget)" : "",
+         (int)sizeof(ParamSyncPacket));
+  printf("%-16s %10s %10s %10s %10s %8s %8s %8s %8s\n", "pattern", "key B", "delta B", "avg B", "pkts/frm", "vs raw",
+         "FEC", "FEC frm", "param");
+
+  int mismatches = 0;
+  // Pool exhausted before the first pattern: the leader renders black and
+  // sends no pattern, the follower renders black from that
+  Pattern* held[PATTERN_POOL_SLOTS];
+  int heldCount = 0;
+  while (heldCount < PATTERN_POOL_SLOTS && (held[heldCount] = acquirePattern(0, NUM_LEDS, 1))) heldCount++;
+  RenderState state;
+  fill_solid(leds, NUM_LEDS, CRGB(1, 2, 3));
+  renderPattern(leds, &state);
+  fill_solid(paramFollower, NUM_LEDS, CRGB(1, 2, 3));
+  renderFromState(state, paramFollower);
+  static const CRGB black[NUM_LEDS] = {};
+  bool poolOk = state.active.index == PATTERN_NONE && memcmp(leds, black, sizeof(leds)) == 0 &&
+                memcmp(paramFollower, black, sizeof(paramFollower)) == 0;
+  for (int i = 0; i < heldCount; i++) releasePattern(held[i]);
+  if (!poolOk) {
+    printf("pattern pool exhausted: frame not black or a pattern was sent\n");
+    mismatches++;
+  }
+  for (int p = 0; p < gPatternCount; p++) {
+    randomSeed(1234 + p);
+    selectPattern(p);
+    static FrameDecoder decoder, lossy;
+    decoder = FrameDecoder();
+    lossy = FrameDecoder();
+    uint64_t keyBytes = 0, deltaBytes = 0, parityBytes = 0, totalPackets = 0;
+    int keyFrames = 0, parityFrames = 0;
+    int paramMismatches = 0;
+    uint32_t rebuilt = 0;
+
+    for (int f = 0; f < frames; f++) {
+      hostClockAdvanceMicros(16000);
+      if (f == frames / 2) nextPattern();
+      updateCrossFade();
+      RenderState state;
+      renderPattern(leds, &state);
+      gHue++;
+      renderFromState(state, paramFollower);
+      if (memcmp(paramFollower, leds, sizeof(leds)) != 0) paramMismatches++;
+      bool keyframe = (f % KEYFRAME_INTERVAL) == 0;
+      int n = encodeFrame(leds, reference, NUM_LEDS, keyframe, (uint8_t)f, 255, 0, packets, ENCODED_MAX_PACKETS);
+      if (n == 0) {
+        printf("encodeFrame failed at frame %d\n", f);
+        return 1;
+      }
+      uint32_t bytes = 0;
+      bool complete = false, lossyComplete = false;
+      const EncodedChunkHeader* first = (const EncodedChunkHeader*)packets[0].data;
+      bool hasParity = (first->flags >> CHUNK_FEC_SHIFT) != 0;
+      int lost = hasParity ? f % first->chunkCount : -1;  // Data chunk the lossy follower misses
+      for (int i = 0; i < n; i++) {
+        bytes += packets[i].len;
+        checkRelayed(packets[i].data, packets[i].len);
+        if (((const EncodedChunkHeader*)packets[i].data)->flags & CHUNK_FLAG_PARITY) parityBytes += packets[i].len;
+        complete |= decodeChunk(decoder, packets[i].data, packets[i].len, follower, NUM_LEDS) == CHUNK_FRAME_COMPLETE;
+        if (i != lost) {
+          lossyComplete |=
+              decodeChunk(lossy, packets[i].data, packets[i].len, lossyFollower, NUM_LEDS) == CHUNK_FRAME_COMPLETE;
+        }
+      }
+      if (!complete || memcmp(follower, leds, sizeof(leds)) != 0) mismatches++;
+      if (!lossyComplete || memcmp(lossyFollower, leds, sizeof(leds)) != 0) mismatches++;
+      if (hasParity) parityFrames++;
+      if (keyframe) {
+        keyBytes += bytes;
+        keyFrames++;
+      } else {
+        deltaBytes += bytes;
+      }
+      totalPackets += n;
+    }
+
+    double avg = (double)(keyBytes + deltaBytes) / frames;
+    printf("%-16s %10.0f %10.0f %10.0f %10.2f %7.0f%% %7.0f%% %7.0f%% %8s%s\n", patternNames[p],
+           (double)keyBytes / keyFrames, (double)deltaBytes / (frames - keyFrames), avg,
+           (double)totalPackets / frames, 100.0 * avg / rawBytes, 100.0 * parityBytes / frames / rawBytes,
+           100.0 * parityFrames / frames, paramMismatches ? "DIFFERS" : "exact",
+           avg > rawBytes ? "  OVER RAW" : "");
+    mismatches += paramMismatches;
+    rebuilt += lossy.assembly.stats.recovered;
+    if (rebuilt != (uint32_t)parityFrames) {
+      printf("%-16s only %u of %d frames with parity rebuilt from it\n", "", (unsigned)rebuilt, parityFrames);
+    }
+  }
+
+  printf("\n%s (%d frames differed after decode or re-render)\n", mismatches ? "FAIL" : "PASS", mismatches);
+  printf("%s (%d relayed copies were %d bytes or unwrapped wrong, %d padded off it)\n",
+         relayFailures ? "FAIL" : "PASS", relayFailures, V1_PACKET_SIZE, relayPadded);
+  return mismatches || relayFailures ? 1 : 0;
+}
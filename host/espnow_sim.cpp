@@ -0,0 +1,880 @@
+// ESP-NOW network simulator: one leader and N followers, each running the
+// unmodified sketch - setup(), loop(), broadcastLEDData(), onDataReceived(),
+// checkLeaderTimeout() and the output task - against a simulated radio
+// channel and per-node clocks, and scores how well the followers track the
+// leader.
+//
+// Each node is the sketch built as a shared object (sim_node.cpp), loaded
+// once per node so every node has its own globals. The simulator defines
+// what the host stubs only declare: micros()/millis()/delay(), the FreeRTOS
+// task calls, esp_now_* and ESP.restart(). Tasks (loopTask, the output
+// task) are fibers on a discrete-event clock in true nanoseconds; a fiber
+// runs until it sleeps or waits, and every micros() call costs
+// MICROS_COST_NS so busy-waits end. Each node's micros() starts at its own
+// boot and drifts by up to +-drift ppm. ESP.restart() reloads the node but
+// keeps its RTC_NOINIT_ATTR memory, as the chip does.
+//
+// Radio: one shared channel. Packets from a node go out one at a time after
+// DIFS and a random backoff, taking PLCP + (payload + MAC overhead) bits at
+// the configured rate; a node holds at most radio_queue packets
+// (esp_now_send() returns ESP_ERR_ESPNOW_NO_MEM beyond that). At the end of
+// each transmission the sender gets its send callback, and every other
+// node independently loses the packet, or receives it after a random
+// jitter, plus a reorder delay for some packets. With -x the followers are
+// spread along a line reaching that many radio ranges from the leader, and
+// only nodes within one range of the sender hear it - the rest need the
+// relay mesh (mesh.h). Carrier sense has the same range, so nodes further
+// apart transmit at once; collisions at a receiver between two senders
+// that can't hear each other are not modelled.
+//
+// Scoring: every FastLED.show() is hashed (pixels + brightness). A follower
+// show matches the leader show with the same hash within MATCH_WINDOW_NS;
+// hashes the leader showed more than once in that window (static patterns)
+// are left out. Reported after the warm-up: the leader's broadcast rate
+// (broadcast_rate.h), firmware frame counters (complete/torn/late/dropped),
+// leader frames each follower showed, and show-time skew follower - leader,
+// also per hop count the follower ended up at. Any packet of LEDSync's
+// length that isn't one (relayed or encoded) fails the run.
+//
+// Failover (-k): the leader powers off for good at that time (election.h).
+// Leader frames are scored up to then; after it, the report shows which
+// node took over, how long each follower took to show the new leader's
+// frames, the longest stretch a follower showed nothing new, and any
+// all-black frames.
+//
+// Usage: espnow_sim [options] node.so
+//   -n followers (50)    -t seconds (20)        -w warm-up seconds (5)
+//   -l loss % (1)        -j jitter us (300)     -r reorder % (1)
+//   -R reorder delay us (5000)                  -b rate Mbps (1)
+//   -q radio queue packets (16)                 -d clock drift ppm (20)
+//   -x extent in radio ranges (0: all in range)  -s seed (1)
+//   -k power the leader off after this many seconds (0: never)
+//   -v print node serial output
+
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "Arduino.h"
+#include "WiFi.h"
+#include "sim_node.h"
+
+typedef long long SimTime;  // True time, ns
+
+#define MS_NS 1000000LL
+#define US_NS 1000LL
+
+#define MICROS_COST_NS 250              // Per micros()/millis() call
+#define LOOP_PERIOD_NS (1 * MS_NS)      // loopTask calls loop() at most this often
+#define FIBER_STACK_BYTES (256 * 1024)
+#define BOOT_SPREAD_NS (2000 * MS_NS)   // Nodes power up within this
+#define REBOOT_NS (500 * MS_NS)         // ESP.restart() until setup() runs again
+#define SHOW_NS_PER_LED (30 * US_NS)    // WS2812 wire time, blocks FastLED.show()
+#define SHOW_OVERHEAD_NS (50 * US_NS)   // Reset latch
+#define MATCH_WINDOW_NS (500 * MS_NS)
+
+// 802.11b long preamble; ESP-NOW rides a vendor action frame
+#define PLCP_US 192
+#define MAC_OVERHEAD_BYTES 51
+#define DIFS_US 50
+#define SLOT_US 20
+#define BACKOFF_SLOTS 31
+#define SIM_MAX_PAYLOAD 1470  // ESP-NOW v2; v1 builds send at most 250
+#define V1_LEDSYNC_BYTES 153  // Old followers take any packet this long for pixels
+#define V1_LEDSYNC_LEDS 49    // ... and real ones start at a multiple of this
+
+struct SimConfig {
+  int followers = 50;
+  double seconds = 20;
+  double warmup = 5;
+  double loss = 0.01;
+  int jitterUs = 300;
+  double reorder = 0.01;
+  int reorderUs = 5000;
+  double rateMbps = 1;
+  int radioQueue = 16;
+  double driftPpm = 20;
+  double extent = 0;
+  double kill = 0;
+  uint32_t seed = 1;
+  bool verbose = false;
+};
+
+static SimConfig config;
+static std::mt19937_64 rng;
+
+static double uniform(double lo, double hi) { return std::uniform_real_distribution<double>(lo, hi)(rng); }
+
+// ===== EVENTS =====
+struct Event {
+  SimTime at;
+  uint64_t seq;  // FIFO among equal times
+  std::function<void()> run;
+};
+struct EventLater {
+  bool operator()(const Event& a, const Event& b) const { return a.at != b.at ? a.at > b.at : a.seq > b.seq; }
+};
+static std::priority_queue<Event, std::vector<Event>, EventLater> events;
+static uint64_t eventSeq = 0;
+
+static void schedule(SimTime at, std::function<void()> run) { events.push({at, eventSeq++, std::move(run)}); }
+
+// ===== NODES =====
+typedef std::shared_ptr<const std::vector<uint8_t>> Packet;
+
+struct Node;
+
+struct Fiber {
+  Node* node;
+  ucontext_t ctx;
+  std::vector<char> stack;
+  void (*fn)(void*);
+  void* param;
+  uint32_t notify = 0;   // Task notification value
+  bool waiting = false;  // In ulTaskNotifyTake()
+  uint32_t wakeGen = 0;  // Invalidates the other wake-ups of one wait
+};
+
+struct NodeApi {
+  void (*setup)();
+  void (*loop)();
+  void (*makeLeader)();
+  void (*setShowHook)(SimShowHook);
+  void (*setVerbose)(bool);
+  bool (*following)();
+  bool (*leading)();
+  bool (*clockLocked)();
+  int (*hops)();
+  bool (*relaying)();
+  void (*stats)(SimNodeStats*);
+  uint8_t* (*rtcMemory)(size_t*);
+};
+
+struct Node {
+  int id;
+  bool leader;
+  uint8_t mac[6];
+  double x = 0;  // Position along the line, in radio ranges (-x)
+  void* lib = nullptr;
+  int libFd = -1;  // Open while loaded: dlopen() matches by path, and fds get reused
+  NodeApi api;
+  uint32_t boot = 0;       // Bumped by ESP.restart(): events of the old firmware are dropped
+  SimTime bootedAt = 0;
+  double clockRate = 1.0;  // Local per true second
+
+  bool espnowUp = false;
+  bool poweredOff = false;  // -k
+  SimTime leadingSince = 0;  // Became leader (pinned or elected), 0 = not leading
+  esp_now_send_cb_t sendCb = nullptr;
+  esp_now_recv_cb_t recvCb = nullptr;
+  std::deque<Packet> radio;  // Waiting for the air
+  bool transmitting = false;
+  SimTime busyUntil = 0;     // Carrier sense: a node in range is on the air
+
+  std::vector<std::unique_ptr<Fiber>> fibers;
+  SimNodeStats earlier = {};  // Counters of previous boots
+  SimNodeStats warm = {};     // Totals when the warm-up ended
+  int restarts = 0;
+  std::vector<uint8_t> rtc;   // RTC_NOINIT_ATTR memory over a restart; empty at power-on
+};
+
+static std::vector<std::unique_ptr<Node>> nodes;
+static std::vector<char> libraryImage;
+static uint8_t broadcastMac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// Running context: the node whose code is executing, its fiber (nullptr in
+// the WiFi task, i.e. ESP-NOW callbacks) and its time, advanced as it runs
+static Node* self = nullptr;
+static Fiber* running = nullptr;
+static SimTime now = 0;
+static ucontext_t schedulerCtx;
+
+static void addStats(SimNodeStats& into, const SimNodeStats& s, int sign = 1) {
+  into.complete += sign * s.complete;
+  into.torn += sign * s.torn;
+  into.late += sign * s.late;
+  into.dropped += sign * s.dropped;
+  into.corrupt += sign * s.corrupt;
+  into.recovered += sign * s.recovered;
+  into.unrecoverable += sign * s.unrecoverable;
+  into.txQueued += sign * s.txQueued;
+  into.txSent += sign * s.txSent;
+  into.txFailed += sign * s.txFailed;
+  into.txDropped += sign * s.txDropped;
+  into.forwarded += sign * s.forwarded;
+  into.duplicates += sign * s.duplicates;
+  into.rateFrames += sign * s.rateFrames;
+  into.rateUnchanged += sign * s.rateUnchanged;
+  into.rateHeld += sign * s.rateHeld;
+  into.elections += sign * s.elections;
+  into.electionsWon += sign * s.electionsWon;
+  into.failovers += sign * s.failovers;
+  into.failoverMaxMs = std::max(into.failoverMaxMs, s.failoverMaxMs);  // Not a counter
+  into.stalls += sign * s.stalls;
+  into.stallsRecovered += sign * s.stallsRecovered;
+  into.recoverMaxMs = std::max(into.recoverMaxMs, s.recoverMaxMs);
+}
+
+static SimNodeStats totalStats(Node* n) {
+  SimNodeStats s;
+  n->api.stats(&s);
+  addStats(s, n->earlier);
+  return s;
+}
+
+// ===== FIBERS =====
+static void suspend() { swapcontext(&running->ctx, &schedulerCtx); }
+
+static void resume(Fiber* f, SimTime at) {
+  self = f->node;
+  running = f;
+  now = at;
+  swapcontext(&schedulerCtx, &f->ctx);
+  self = nullptr;
+  running = nullptr;
+}
+
+static void resumeAt(Fiber* f, SimTime at) {
+  Node* n = f->node;
+  uint32_t boot = n->boot;
+  schedule(at, [=] {
+    if (n->boot == boot) resume(f, at);
+  });
+}
+
+static void sleepUntil(SimTime at) {
+  resumeAt(running, at);
+  suspend();
+}
+
+static void fiberMain() {
+  running->fn(running->param);
+  for (;;) suspend();  // Tasks never return; park one that does
+}
+
+static Fiber* startFiber(Node* n, void (*fn)(void*), void* param, SimTime at) {
+  n->fibers.emplace_back(new Fiber());
+  Fiber* f = n->fibers.back().get();
+  f->node = n;
+  f->fn = fn;
+  f->param = param;
+  f->stack.resize(FIBER_STACK_BYTES);
+  getcontext(&f->ctx);
+  f->ctx.uc_stack.ss_sp = f->stack.data();
+  f->ctx.uc_stack.ss_size = f->stack.size();
+  f->ctx.uc_link = &schedulerCtx;
+  makecontext(&f->ctx, fiberMain, 0);
+  resumeAt(f, at);
+  return f;
+}
+
+// Arduino's loopTask: setup(), then loop() forever
+static void loopTask(void*) {
+  Node* n = self;
+  n->api.setup();
+  if (n->leader) n->api.makeLeader();
+  for (;;) {
+    SimTime start = now;
+    n->api.loop();
+    if (!n->api.leading()) n->leadingSince = 0;
+    else if (!n->leadingSince) n->leadingSince = now;
+    sleepUntil(std::max(now, start + LOOP_PERIOD_NS));
+  }
+}
+
+// ===== MEASUREMENT =====
+struct ShowRecord {
+  SimTime at;
+  int node;
+  uint64_t hash;
+  bool black;
+};
+static std::vector<ShowRecord> shows;
+static SimTime measureFrom, measureTo;
+static SimTime killAt = 0;  // -k, 0 = never
+
+struct ChannelStats {
+  uint64_t packets, deliveries, lost, reordered, radioFull;
+  uint64_t v1Lookalikes;  // Not LEDSync, but its length: whole run, fails it
+  SimTime airtime;  // Inside the measurement window, summed over senders
+};
+static ChannelStats channel;
+
+static void onShow(const uint8_t* rgb, int count, uint8_t brightness) {
+  if (now >= measureFrom && now < measureTo) {
+    uint64_t hash = 0xcbf29ce484222325ULL;  // FNV-1a
+    bool black = true;
+    for (int i = 0; i < count * 3; i++) {
+      hash = (hash ^ rgb[i]) * 0x100000001b3ULL;
+      if (rgb[i]) black = false;
+    }
+    hash = (hash ^ brightness) * 0x100000001b3ULL;
+    shows.push_back({now, self->id, hash, black || brightness == 0});
+  }
+  now += count * SHOW_NS_PER_LED + SHOW_OVERHEAD_NS;
+}
+
+// ===== NODE LIFECYCLE =====
+template <typename T>
+static void bindSymbol(void* lib, const char* name, T& fn) {
+  fn = (T)dlsym(lib, name);
+  if (!fn) {
+    fprintf(stderr, "espnow_sim: node library lacks %s\n", name);
+    exit(1);
+  }
+}
+
+// A fresh copy every time: dlopen() of a new memfd never returns an old instance
+static void loadNode(Node* n) {
+  int fd = memfd_create("sim_node", MFD_CLOEXEC);
+  if (fd < 0 || write(fd, libraryImage.data(), libraryImage.size()) != (ssize_t)libraryImage.size()) {
+    perror("espnow_sim: memfd");
+    exit(1);
+  }
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+  n->lib = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  n->libFd = fd;
+  if (!n->lib) {
+    fprintf(stderr, "espnow_sim: %s\n", dlerror());
+    exit(1);
+  }
+  bindSymbol(n->lib, "simNodeSetup", n->api.setup);
+  bindSymbol(n->lib, "simNodeLoop", n->api.loop);
+  bindSymbol(n->lib, "simNodeMakeLeader", n->api.makeLeader);
+  bindSymbol(n->lib, "simNodeSetShowHook", n->api.setShowHook);
+  bindSymbol(n->lib, "simNodeSetVerbose", n->api.setVerbose);
+  bindSymbol(n->lib, "simNodeFollowing", n->api.following);
+  bindSymbol(n->lib, "simNodeLeading", n->api.leading);
+  bindSymbol(n->lib, "simNodeClockLocked", n->api.clockLocked);
+  bindSymbol(n->lib, "simNodeHops", n->api.hops);
+  bindSymbol(n->lib, "simNodeRelaying", n->api.relaying);
+  bindSymbol(n->lib, "simNodeStats", n->api.stats);
+  bindSymbol(n->lib, "simNodeRtcMemory", n->api.rtcMemory);
+  n->api.setShowHook(onShow);
+  n->api.setVerbose(config.verbose);
+}
+
+static void bootNode(Node* n, SimTime at) {
+  self = n;
+  now = at;
+  if (n->lib) {
+    SimNodeStats s;
+    n->api.stats(&s);
+    addStats(n->earlier, s);
+    size_t size;
+    uint8_t* rtc = n->api.rtcMemory(&size);
+    n->rtc.assign(rtc, rtc + size);
+    n->fibers.clear();
+    dlclose(n->lib);
+    close(n->libFd);
+  }
+  loadNode(n);
+  if (!n->rtc.empty()) {
+    size_t size;
+    memcpy(n->api.rtcMemory(&size), n->rtc.data(), std::min(size, n->rtc.size()));
+  }
+  n->bootedAt = at;
+  self = nullptr;
+  startFiber(n, loopTask, nullptr, at);
+}
+
+// ===== RADIO =====
+static SimTime airtimeNs(size_t len) {
+  return (SimTime)((PLCP_US + (len + MAC_OVERHEAD_BYTES) * 8 / config.rateMbps) * US_NS);
+}
+
+// -k: the radio and every task stop, as if the battery came off
+static void powerOff(Node* n) {
+  n->boot++;
+  n->poweredOff = true;
+  n->espnowUp = false;
+  n->sendCb = nullptr;
+  n->recvCb = nullptr;
+  n->radio.clear();
+  n->transmitting = false;
+}
+
+static bool inRange(const Node* a, const Node* b) {
+  return config.extent <= 0 || fabs(a->x - b->x) <= 1;
+}
+
+static void deliver(Node* from, Node* to, const Packet& p, SimTime sentAt) {
+  if (!to->lib || to->poweredOff || !inRange(from, to)) return;  // Not powered up, or out of range
+  if (uniform(0, 1) < config.loss) {
+    channel.lost++;
+    return;
+  }
+  SimTime at = sentAt + (SimTime)(uniform(0, config.jitterUs) * US_NS);
+  if (uniform(0, 1) < config.reorder) {
+    at += config.reorderUs * US_NS;
+    channel.reordered++;
+  }
+  uint32_t boot = to->boot;
+  schedule(at, [=] {
+    if (to->boot != boot || !to->recvCb) return;
+    self = to;
+    now = at;
+    esp_now_recv_info_t info = {from->mac, broadcastMac, nullptr};
+    to->recvCb(&info, p->data(), (int)p->size());
+    self = nullptr;
+    channel.deliveries++;
+  });
+}
+
+static void startTransmit(Node* n, SimTime at);
+
+static void finishTransmit(Node* n, uint32_t boot, Packet p, SimTime at) {
+  channel.packets++;
+  for (auto& other : nodes) {
+    if (other.get() != n) deliver(n, other.get(), p, at);
+  }
+  if (n->boot != boot) return;  // Restarted mid-air: the old firmware hears nothing
+
+  n->transmitting = false;
+  if (n->sendCb) {
+    self = n;
+    now = at;
+    n->sendCb(broadcastMac, ESP_NOW_SEND_SUCCESS);  // Broadcasts are never acked
+    self = nullptr;
+  }
+  if (!n->transmitting && !n->radio.empty()) startTransmit(n, std::max(at, now));
+}
+
+static void startTransmit(Node* n, SimTime at) {
+  Packet p = n->radio.front();
+  n->radio.pop_front();
+  n->transmitting = true;
+
+  SimTime start = std::max(at, n->busyUntil) + (DIFS_US + SLOT_US * (SimTime)uniform(0, BACKOFF_SLOTS)) * US_NS;
+  SimTime end = start + airtimeNs(p->size());
+  for (auto& other : nodes) {
+    if (inRange(n, other.get())) other->busyUntil = std::max(other->busyUntil, end);
+  }
+  if (start >= measureFrom && start < measureTo) channel.airtime += end - start;
+
+  uint32_t boot = n->boot;
+  schedule(end, [=] { finishTransmit(n, boot, p, end); });
+}
+
+// ===== SKETCH RUNTIME =====
+// Everything the host stubs declare for the simulator
+
+static uint64_t localMicros() {
+  return (uint64_t)((now - self->bootedAt) * self->clockRate / US_NS);
+}
+
+unsigned long micros() {
+  if (!self) return 0;
+  now += MICROS_COST_NS;
+  return (uint32_t)localMicros();
+}
+
+unsigned long millis() {
+  if (!self) return 0;
+  now += MICROS_COST_NS;
+  return (uint32_t)(localMicros() / 1000);
+}
+
+void delay(unsigned long ms) {
+  if (running) sleepUntil(now + (SimTime)ms * MS_NS);
+  else now += (SimTime)ms * MS_NS;
+}
+
+void delayMicroseconds(unsigned int us) { now += (SimTime)us * US_NS; }
+
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char*, uint32_t, void* param, unsigned,
+                                   TaskHandle_t* handle, BaseType_t) {
+  Fiber* f = startFiber(self, task, param, now);
+  if (handle) *handle = f;
+  return pdTRUE;
+}
+
+static void wakeAt(Fiber* f, uint32_t gen, SimTime at) {
+  Node* n = f->node;
+  uint32_t boot = n->boot;
+  schedule(at, [=] {
+    if (n->boot != boot || !f->waiting || f->wakeGen != gen) return;
+    f->waiting = false;
+    resume(f, at);
+  });
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+  Fiber* f = (Fiber*)task;
+  if (!f) return;
+  f->notify++;
+  if (f->waiting) wakeAt(f, f->wakeGen, now);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  Fiber* f = running;
+  if (f->notify == 0) {
+    // A zero timeout still yields, so a polling task lets time pass
+    f->waiting = true;
+    uint32_t gen = ++f->wakeGen;
+    if (ticks != portMAX_DELAY) wakeAt(f, gen, now + (SimTime)ticks * MS_NS);
+    suspend();
+  }
+  uint32_t value = f->notify;
+  if (clearOnExit) f->notify = 0;
+  else if (value) f->notify--;
+  return value;
+}
+
+void HostESP::restart() {
+  Node* n = self;
+  n->boot++;
+  n->restarts++;
+  n->espnowUp = false;
+  n->sendCb = nullptr;
+  n->recvCb = nullptr;
+  n->radio.clear();
+  n->transmitting = false;
+  schedule(now + REBOOT_NS, [n, at = now + REBOOT_NS] { bootNode(n, at); });
+  if (running) {
+    for (;;) suspend();  // Never resumed: the boot generation moved on
+  }
+}
+
+void hostMacAddress(uint8_t mac[6]) { memcpy(mac, self->mac, 6); }
+
+esp_err_t esp_now_init() {
+  self->espnowUp = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_deinit() {
+  self->espnowUp = false;
+  self->sendCb = nullptr;
+  self->recvCb = nullptr;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb) {
+  if (!self->espnowUp) return ESP_ERR_ESPNOW_NOT_INIT;
+  self->sendCb = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb) {
+  if (!self->espnowUp) return ESP_ERR_ESPNOW_NOT_INIT;
+  self->recvCb = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_unregister_send_cb() {
+  self->sendCb = nullptr;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_unregister_recv_cb() {
+  self->recvCb = nullptr;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t*) {
+  return self->espnowUp ? ESP_OK : ESP_ERR_ESPNOW_NOT_INIT;
+}
+
+esp_err_t esp_now_del_peer(const uint8_t*) { return ESP_OK; }
+
+esp_err_t esp_now_send(const uint8_t*, const uint8_t* data, size_t len) {
+  Node* n = self;
+  if (!n->espnowUp) return ESP_ERR_ESPNOW_NOT_INIT;
+  if (!data || len == 0 || len > SIM_MAX_PAYLOAD) return ESP_ERR_ESPNOW_ARG;
+  if (len == V1_LEDSYNC_BYTES && data[0] % V1_LEDSYNC_LEDS != 0) channel.v1Lookalikes++;
+  if ((int)n->radio.size() + n->transmitting >= config.radioQueue) {
+    channel.radioFull++;
+    return ESP_ERR_ESPNOW_NO_MEM;
+  }
+  n->radio.push_back(std::make_shared<const std::vector<uint8_t>>(data, data + len));
+  if (!n->transmitting) startTransmit(n, now);
+  return ESP_OK;
+}
+
+// ===== REPORT =====
+static double percentile(std::vector<double>& sorted, double p) {
+  if (sorted.empty()) return 0;
+  return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+// -k: who took over, and what the followers showed meanwhile
+static void reportFailover(const SimNodeStats& followers) {
+  int leaders = 0, newLeader = -1;
+  for (size_t i = 1; i < nodes.size(); i++) {
+    self = nodes[i].get();
+    if (nodes[i]->api.leading()) {
+      leaders++;
+      newLeader = (int)i;
+    }
+  }
+  self = nullptr;
+  printf("failover  leader off at %.1fs: %d leader(s) at the end", killAt / 1e9, leaders);
+  if (newLeader > 0) {
+    printf(", node %d took over after %.0fms", newLeader, (double)(nodes[newLeader]->leadingSince - killAt) / MS_NS);
+  }
+  printf("; %u elections, %u won, firmware failover max %ums\n", followers.elections, followers.electionsWon,
+         followers.failoverMaxMs);
+  if (leaders != 1) return;
+
+  // Its own frames: not the old leader's it was still showing after the kill
+  SimTime tookOver = nodes[newLeader]->leadingSince;
+  std::unordered_map<uint64_t, std::vector<SimTime>> newShows;
+  for (auto& s : shows) {
+    if (s.node == newLeader && s.at >= tookOver) newShows[s.hash].push_back(s.at);
+  }
+  std::vector<double> switchMs, gapMs;
+  std::vector<SimTime> lastShow(nodes.size(), -1), switched(nodes.size(), -1);
+  std::vector<double> nodeGap(nodes.size(), 0);
+  size_t black = 0;
+  for (auto& s : shows) {
+    if (s.node == 0 || s.node == newLeader) continue;
+    if (s.at >= killAt) {
+      if (s.black) black++;
+      if (lastShow[s.node] >= 0) nodeGap[s.node] = std::max(nodeGap[s.node], (double)(s.at - lastShow[s.node]) / MS_NS);
+      auto it = newShows.find(s.hash);
+      if (switched[s.node] < 0 && s.at >= tookOver && it != newShows.end()) {
+        for (SimTime at : it->second) {
+          if (llabs(at - s.at) <= MATCH_WINDOW_NS) switched[s.node] = s.at;
+        }
+      }
+    }
+    lastShow[s.node] = s.at;
+  }
+  int never = 0;
+  for (size_t i = 1; i < nodes.size(); i++) {
+    if ((int)i == newLeader) continue;
+    gapMs.push_back(nodeGap[i]);
+    if (switched[i] < 0) never++;
+    else switchMs.push_back((double)(switched[i] - killAt) / MS_NS);
+  }
+  std::sort(switchMs.begin(), switchMs.end());
+  std::sort(gapMs.begin(), gapMs.end());
+  printf("          followers on the new leader's frames after p50 %.0fms, max %.0fms (%d never); "
+         "longest show gap p50 %.0fms, max %.0fms; %zu black frames\n",
+         percentile(switchMs, 0.5), switchMs.empty() ? 0.0 : switchMs.back(), never, percentile(gapMs, 0.5),
+         gapMs.empty() ? 0.0 : gapMs.back(), black);
+}
+
+static void report() {
+  SimTime scoreTo = killAt ? killAt : measureTo;  // Leader frames exist up to here
+  // Leader shows by hash; only hashes shown once within the match window count
+  std::unordered_map<uint64_t, std::vector<size_t>> leaderShows;
+  for (size_t i = 0; i < shows.size(); i++) {
+    if (shows[i].node == 0) leaderShows[shows[i].hash].push_back(i);
+  }
+  auto uniqueLeaderShow = [&](uint64_t hash, SimTime at) -> long {
+    auto it = leaderShows.find(hash);
+    if (it == leaderShows.end()) return -1;
+    long found = -1;
+    for (size_t i : it->second) {
+      if (llabs(shows[i].at - at) > MATCH_WINDOW_NS) continue;
+      if (found >= 0) return -2;  // Ambiguous
+      found = (long)i;
+    }
+    return found;
+  };
+
+  // Leader frames a follower could have shown: unambiguous, not in the last window
+  size_t expected = 0;
+  for (auto& s : shows) {
+    if (s.node == 0 && s.at < scoreTo - MATCH_WINDOW_NS && uniqueLeaderShow(s.hash, s.at) >= 0) expected++;
+  }
+
+  std::vector<double> skewUs;
+  std::vector<std::vector<double>> nodeSkewUs(nodes.size());
+  double skewSum = 0;
+  std::vector<std::vector<bool>> matched(nodes.size(), std::vector<bool>(shows.size(), false));
+  std::vector<size_t> shownCount(nodes.size(), 0);
+  for (auto& s : shows) {
+    if (s.node == 0) continue;
+    long i = uniqueLeaderShow(s.hash, s.at);
+    if (i < 0 || matched[s.node][i]) continue;
+    matched[s.node][i] = true;
+    if (shows[i].at < scoreTo - MATCH_WINDOW_NS) shownCount[s.node]++;
+    double skew = (double)(s.at - shows[i].at) / US_NS;
+    skewSum += skew;
+    skewUs.push_back(fabs(skew));
+    nodeSkewUs[s.node].push_back(fabs(skew));
+  }
+  std::sort(skewUs.begin(), skewUs.end());
+
+  // Per hop count at the end (index 0 = no route)
+  struct HopGroup {
+    int nodes = 0;
+    double shownSum = 0;
+    std::vector<double> skewUs;
+  };
+  std::vector<HopGroup> hopGroups(1);
+
+  SimNodeStats followers = {};
+  int following = 0, locked = 0, restarts = 0, relays = 0;
+  double shownSum = 0, shownMin = 1;
+  for (size_t i = 1; i < nodes.size(); i++) {
+    Node* n = nodes[i].get();
+    self = n;
+    SimNodeStats s = totalStats(n);
+    addStats(s, n->warm, -1);
+    addStats(followers, s);
+    following += n->api.following();
+    locked += n->api.clockLocked();
+    relays += n->api.relaying();
+    size_t group = n->api.hops() + 1;
+    self = nullptr;
+    restarts += n->restarts;
+    double shown = expected ? (double)shownCount[i] / expected : 0;
+    shownSum += shown;
+    shownMin = std::min(shownMin, shown);
+
+    if (group >= hopGroups.size()) hopGroups.resize(group + 1);
+    hopGroups[group].nodes++;
+    hopGroups[group].shownSum += shown;
+    hopGroups[group].skewUs.insert(hopGroups[group].skewUs.end(), nodeSkewUs[i].begin(), nodeSkewUs[i].end());
+  }
+  self = nodes[0].get();
+  SimNodeStats leader = totalStats(nodes[0].get());
+  self = nullptr;
+  addStats(leader, nodes[0]->warm, -1);
+
+  double window = (double)(measureTo - measureFrom) / 1e9;
+  uint32_t frames = followers.complete + followers.torn + followers.dropped;
+  printf("channel   %.1f%% airtime, %llu packets, %llu deliveries, %llu lost, %llu reordered, %llu radio queue full\n",
+         100.0 * channel.airtime / (measureTo - measureFrom), (unsigned long long)channel.packets,
+         (unsigned long long)channel.deliveries, (unsigned long long)channel.lost,
+         (unsigned long long)channel.reordered, (unsigned long long)channel.radioFull);
+  printf("leader    TX queue %u queued, %u sent, %u failed, %u dropped (%.0f packets/s)\n", leader.txQueued,
+         leader.txSent, leader.txFailed, leader.txDropped, leader.txSent / window);
+  printf("rate      leader sent %u frames (%.1f/s), skipped %u unchanged, %u held back\n", leader.rateFrames,
+         leader.rateFrames / window, leader.rateUnchanged, leader.rateHeld);
+  printf("frames    %u complete, %u torn, %u late, %u dropped, %u corrupt -> delivery %.2f%%\n",
+         followers.complete, followers.torn, followers.late, followers.dropped, followers.corrupt,
+         frames ? 100.0 * followers.complete / frames : 0.0);
+  printf("fec       %u frames recovered from parity, %u unrecoverable\n", followers.recovered,
+         followers.unrecoverable);
+  printf("shown     %.2f%% of %zu leader frames per follower (worst %.2f%%)\n",
+         nodes.size() > 1 ? 100.0 * shownSum / (nodes.size() - 1) : 0.0, expected, 100.0 * shownMin);
+  printf("skew      |follower - leader| p50 %.0fus, p95 %.0fus, max %.0fus, mean %+.0fus over %zu frames\n",
+         percentile(skewUs, 0.5), percentile(skewUs, 0.95), skewUs.empty() ? 0.0 : skewUs.back(),
+         skewUs.empty() ? 0.0 : skewSum / skewUs.size(), skewUs.size());
+  printf("nodes     %d/%zu following, %d clock locked, %d restarts\n", following, nodes.size() - 1, locked,
+         restarts);
+  printf("recovery  %u stalls (leader heard, no frames), %u recovered", followers.stalls, followers.stallsRecovered);
+  if (followers.stallsRecovered) printf(", time to recover max %ums", followers.recoverMaxMs);
+  printf("\n");
+  printf("mesh      %d relays, %u packets forwarded, %u duplicate copies dropped\n", relays, followers.forwarded,
+         followers.duplicates);
+  for (size_t group = 0; group < hopGroups.size(); group++) {
+    HopGroup& g = hopGroups[group];
+    if (g.nodes == 0) continue;
+    std::sort(g.skewUs.begin(), g.skewUs.end());
+    if (group == 0) printf("  no route");
+    else printf("  hop %-5zu", group - 1);
+    printf(" %3d nodes, shown %.2f%%, skew p50 %.0fus, p95 %.0fus\n", g.nodes, 100.0 * g.shownSum / g.nodes,
+           percentile(g.skewUs, 0.5), percentile(g.skewUs, 0.95));
+  }
+  if (killAt) reportFailover(followers);
+  if (channel.v1Lookalikes) {
+    printf("FAIL      %llu packets were %d bytes without being LEDSync: old followers would show them as pixels\n",
+           (unsigned long long)channel.v1Lookalikes, V1_LEDSYNC_BYTES);
+  }
+}
+
+int main(int argc, char** argv) {
+  const char* usage =
+      "usage: %s [-n followers] [-t seconds] [-w warmup_s] [-l loss_%%] [-j jitter_us] [-r reorder_%%]\n"
+      "          [-R reorder_us] [-b rate_mbps] [-q radio_queue] [-d drift_ppm] [-x extent_ranges] [-s seed] [-v]\n"
+      "          [-k kill_leader_s] node.so\n";
+  int opt;
+  while ((opt = getopt(argc, argv, "n:t:w:l:j:r:R:b:q:d:x:k:s:v")) != -1) {
+    if (opt == 'n') config.followers = atoi(optarg);
+    else if (opt == 't') config.seconds = atof(optarg);
+    else if (opt == 'w') config.warmup = atof(optarg);
+    else if (opt == 'l') config.loss = atof(optarg) / 100;
+    else if (opt == 'j') config.jitterUs = atoi(optarg);
+    else if (opt == 'r') config.reorder = atof(optarg) / 100;
+    else if (opt == 'R') config.reorderUs = atoi(optarg);
+    else if (opt == 'b') config.rateMbps = atof(optarg);
+    else if (opt == 'q') config.radioQueue = atoi(optarg);
+    else if (opt == 'd') config.driftPpm = atof(optarg);
+    else if (opt == 'x') config.extent = atof(optarg);
+    else if (opt == 'k') config.kill = atof(optarg);
+    else if (opt == 's') config.seed = (uint32_t)atol(optarg);
+    else if (opt == 'v') config.verbose = true;
+    else {
+      fprintf(stderr, usage, argv[0]);
+      return 2;
+    }
+  }
+  if (optind != argc - 1 || config.followers < 1 || config.warmup >= config.seconds ||
+      (config.kill && (config.kill <= config.warmup || config.kill >= config.seconds))) {
+    fprintf(stderr, usage, argv[0]);
+    return 2;
+  }
+
+  const char* library = argv[optind];
+  FILE* f = fopen(library, "rb");
+  if (!f) {
+    perror(library);
+    return 1;
+  }
+  char buf[65536];
+  size_t got;
+  while ((got = fread(buf, 1, sizeof(buf), f)) > 0) libraryImage.insert(libraryImage.end(), buf, buf + got);
+  fclose(f);
+
+  rng.seed(config.seed);
+  measureFrom = (SimTime)(config.warmup * 1e9);
+  measureTo = (SimTime)(config.seconds * 1e9);
+
+  printf("espnow_sim: %s, 1 leader + %d followers, %.0fs (%.0fs warm-up), seed %u\n", library, config.followers,
+         config.seconds, config.warmup, config.seed);
+  printf("radio     %.0f Mbps, loss %.1f%%, jitter 0-%dus, reorder %.1f%% (+%dus), queue %d, drift +-%.0fppm\n",
+         config.rateMbps, config.loss * 100, config.jitterUs, config.reorder * 100, config.reorderUs,
+         config.radioQueue, config.driftPpm);
+  if (config.extent > 0) printf("layout    followers on a line out to %.1f radio ranges\n", config.extent);
+  if (config.kill > 0) {
+    killAt = (SimTime)(config.kill * 1e9);
+    schedule(killAt, [] { powerOff(nodes[0].get()); });
+  }
+
+  for (int i = 0; i <= config.followers; i++) {
+    nodes.emplace_back(new Node());
+    Node* n = nodes.back().get();
+    n->id = i;
+    n->leader = i == 0;
+    uint8_t mac[6] = {0x24, 0x6F, 0x28, 0x00, (uint8_t)(i >> 8), (uint8_t)i};
+    memcpy(n->mac, mac, 6);
+    n->x = config.extent * i / config.followers;  // Evenly out to the far end
+    n->clockRate = 1.0 + uniform(-config.driftPpm, config.driftPpm) * 1e-6;
+    SimTime bootAt = n->leader ? 0 : (SimTime)uniform(0, BOOT_SPREAD_NS);
+    schedule(bootAt, [n, bootAt] { bootNode(n, bootAt); });
+  }
+  schedule(measureFrom, [] {
+    for (auto& n : nodes) {
+      self = n.get();
+      if (n->lib) n->warm = totalStats(n.get());
+    }
+    self = nullptr;
+  });
+
+  while (!events.empty() && events.top().at < measureTo) {
+    Event e = events.top();
+    events.pop();
+    e.run();
+  }
+  report();
+  return channel.v1Lookalikes ? 1 : 0;
+}
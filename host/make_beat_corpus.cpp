@@ -0,0 +1,115 @@
+// Writes a small deterministic labelled corpus for replay_audio.
+//
+// Each track is a 16-bit mono 44.1kHz WAV plus a .beats file (one beat time
+// in seconds per line). Synthetic, so labels are exact; real recordings
+// with hand-tapped .beats files can sit next to them.
+//
+// Usage: make_beat_corpus <dir>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static const int SR = 44100;
+static const double SECONDS = 20.0;
+
+static uint32_t noiseState = 0x2545F491;
+static double noise() {
+  noiseState ^= noiseState << 13;
+  noiseState ^= noiseState >> 17;
+  noiseState ^= noiseState << 5;
+  return (double)noiseState / 2147483648.0 - 1.0;
+}
+
+static double kick(double t) {
+  if (t < 0.0) return 0.0;
+  double freq = 50.0 + 90.0 * exp(-t * 40.0);  // Pitch drop like a real kick
+  return 0.7 * exp(-t * 25.0) * sin(2.0 * M_PI * freq * t);
+}
+
+static double hat(double t) {
+  if (t < 0.0) return 0.0;
+  return 0.15 * exp(-t * 200.0) * noise();
+}
+
+struct Track {
+  const char* name;
+  double bpmStart, bpmEnd;  // Tempo jumps from start to end half way through
+  bool vocals, hats;
+  double noiseLevel;
+};
+
+static void writeTrack(const std::string& dir, const Track& tr) {
+  std::vector<double> beats;
+  for (double t = 0.5; t < SECONDS - 0.5;) {
+    beats.push_back(t);
+    t += 60.0 / (t < SECONDS / 2 ? tr.bpmStart : tr.bpmEnd);
+  }
+
+  size_t n = (size_t)(SECONDS * SR);
+  std::vector<int16_t> pcm(n);
+  size_t nextBeat = 0;
+  double lastBeat = -1.0, lastHat = -1.0;
+  for (size_t i = 0; i < n; i++) {
+    double t = (double)i / SR;
+    while (nextBeat < beats.size() && beats[nextBeat] <= t) lastBeat = beats[nextBeat++];
+    double v = kick(t - lastBeat) + tr.noiseLevel * noise();
+    if (tr.hats && lastBeat >= 0.0) {
+      // Off-beat hats half way between kicks
+      double period = 60.0 / (t < SECONDS / 2 ? tr.bpmStart : tr.bpmEnd);
+      double off = lastBeat + period / 2;
+      if (t >= off) lastHat = off;
+      if (lastHat >= lastBeat) v += hat(t - lastHat);
+    }
+    if (tr.vocals) {
+      double env = 0.5 + 0.5 * sin(2.0 * M_PI * 0.37 * t + sin(t));
+      v += 0.35 * env * sin(2.0 * M_PI * 330.0 * t * (1.0 + 0.05 * sin(2.0 * M_PI * 0.5 * t)));
+    }
+    if (v > 1.0) v = 1.0;
+    if (v < -1.0) v = -1.0;
+    pcm[i] = (int16_t)(v * 32000.0);
+  }
+
+  std::string base = dir + "/" + tr.name;
+  FILE* f = fopen((base + ".wav").c_str(), "wb");
+  if (!f) {
+    perror(base.c_str());
+    return;
+  }
+  uint32_t dataBytes = (uint32_t)(n * 2), riffBytes = 36 + dataBytes, fmtBytes = 16, rate = SR, byteRate = SR * 2;
+  uint16_t pcmFormat = 1, channels = 1, blockAlign = 2, bits = 16;
+  fwrite("RIFF", 1, 4, f); fwrite(&riffBytes, 4, 1, f); fwrite("WAVE", 1, 4, f);
+  fwrite("fmt ", 1, 4, f); fwrite(&fmtBytes, 4, 1, f);
+  fwrite(&pcmFormat, 2, 1, f); fwrite(&channels, 2, 1, f); fwrite(&rate, 4, 1, f);
+  fwrite(&byteRate, 4, 1, f); fwrite(&blockAlign, 2, 1, f); fwrite(&bits, 2, 1, f);
+  fwrite("data", 1, 4, f); fwrite(&dataBytes, 4, 1, f);
+  fwrite(pcm.data(), 2, n, f);
+  fclose(f);
+
+  f = fopen((base + ".beats").c_str(), "w");
+  if (!f) return;
+  fprintf(f, "# %s: %.0f -> %.0f BPM\n", tr.name, tr.bpmStart, tr.bpmEnd);
+  for (double b : beats) fprintf(f, "%.4f\n", b);
+  fclose(f);
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <dir>\n", argv[0]);
+    return 2;
+  }
+  static const Track tracks[] = {
+    {"kick_090", 90, 90, false, false, 0.01},
+    {"kick_120", 120, 120, false, false, 0.01},
+    {"kick_174", 174, 174, false, false, 0.01},
+    {"kick_vocals_120", 120, 120, true, false, 0.01},
+    {"kick_hats_128", 128, 128, false, true, 0.01},
+    {"noisy_kick_100", 100, 100, false, false, 0.08},
+    {"tempo_change_100_140", 100, 140, false, true, 0.01},
+  };
+  for (const Track& tr : tracks) writeTrack(argv[1], tr);
+  return 0;
+}
@@ -0,0 +1,265 @@
+// Offline audio replay harness: scores the firmware beat pipeline against
+// labelled WAV files.
+//
+// Each file is fed through M5.Mic -> captureAudioBlock() (AUDIO_BLOCK_LEN
+// samples per block) and updateAudioLevel() every 16ms frame, on a manual
+// clock, exactly as loop() and the capture task drive them on the stick.
+// Beats are the frames where beatDetected rises; their visible time is the
+// frame time plus the pipeline latency the firmware itself compensates for.
+//
+// Labels: <file>.beats next to <file>.wav, one beat time in seconds per line
+// ('#' starts a comment). Each file runs in a forked child so firmware
+// globals start fresh.
+//
+// Usage: replay_audio [-t tolerance_ms] [-l output_latency_ms] file.wav...
+//   -t  hit window around a labelled beat (default 70)
+//   -l  device output latency to assume, render + show (default 8)
+
+#include "config.h"
+#include "audio.h"
+#include "audio_capture.h"
+#include "latency.h"
+#include "tempo.h"
+#include "wav_source.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Defined by m5lights_v1.ino on the device
+NodeMode currentMode = MODE_MUSIC;
+
+static const uint32_t FRAME_MS = 16;
+static const uint32_t START_MS = 1000;   // Keep millis() clear of 0 sentinels
+static const float LOCK_TOLERANCE = 0.04f;
+
+struct FileResult {
+  bool ok;
+  int labels, detections, hits;
+  double errorSum, errorAbsSum, errorMax;  // Visible time - label, ms (hits only)
+  double lockMs;                           // -1 = never locked
+  double inTolerance;                      // Fraction of frames with BPM within 4% of truth
+  double blockUsSum, blockUsMax, frameUsSum, frameUsMax;
+  int blocks, frames;
+};
+
+static double nowUs() {
+  return std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool loadLabels(const std::string& wavPath, std::vector<double>& beatsMs) {
+  std::string path = wavPath.substr(0, wavPath.rfind('.')) + ".beats";
+  FILE* f = fopen(path.c_str(), "r");
+  if (!f) {
+    fprintf(stderr, "replay: no labels %s\n", path.c_str());
+    return false;
+  }
+  char line[128];
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#') continue;
+    double t;
+    if (sscanf(line, "%lf", &t) == 1) beatsMs.push_back(t * 1000.0);
+  }
+  fclose(f);
+  std::sort(beatsMs.begin(), beatsMs.end());
+  return beatsMs.size() >= 2;
+}
+
+// Tempo implied by the labels around time t (ms since file start)
+static float labelBpmAt(const std::vector<double>& beats, double t) {
+  size_t i = std::upper_bound(beats.begin(), beats.end(), t) - beats.begin();
+  if (i == 0) i = 1;
+  if (i >= beats.size()) i = beats.size() - 1;
+  return (float)(60000.0 / (beats[i] - beats[i - 1]));
+}
+
+static FileResult replayFile(const char* path, double toleranceMs, uint32_t outputLatencyUs) {
+  FileResult r = {};
+  r.lockMs = -1;
+
+  std::vector<double> labels;
+  if (!loadLabels(path, labels) || !wavSourceOpen(path)) return r;
+  if (wavSourceSampleRate() != (uint32_t)MIC_SR) {
+    fprintf(stderr, "replay: %s is %uHz, firmware expects %dHz\n", path, wavSourceSampleRate(), MIC_SR);
+    return r;
+  }
+
+  Serial.enabled = false;
+  hostClockSetManual(true);
+  hostClockAdvanceMicros(START_MS * 1000);
+  initAudio();
+  latencyRecord(LAT_SHOW, outputLatencyUs);  // Stand-in for render + show on the device
+  latencyRecord(LAT_CADENCE, FRAME_MS * 500);
+
+  std::vector<double> detections;
+  uint64_t clockUs = (uint64_t)START_MS * 1000;
+  uint64_t blockEndUs = clockUs;
+  bool prevBeat = false, audioLeft = true;
+  double lastOutOfBand = 0.0;
+  int framesWithTruth = 0, framesInBand = 0;
+
+  for (uint64_t frameUs = clockUs + FRAME_MS * 1000; audioLeft; frameUs += FRAME_MS * 1000) {
+    // Capture task: every block whose audio has fully arrived by this frame
+    for (;;) {
+      uint64_t nextEnd = blockEndUs + (uint64_t)AUDIO_BLOCK_LEN * 1000000 / MIC_SR;
+      if (nextEnd > frameUs) break;
+      hostClockAdvanceMicros((uint32_t)(nextEnd - clockUs));
+      clockUs = blockEndUs = nextEnd;
+      double t0 = nowUs();
+      if (!captureAudioBlock()) {
+        audioLeft = false;
+        break;
+      }
+      double us = nowUs() - t0;
+      r.blockUsSum += us;
+      r.blockUsMax = std::max(r.blockUsMax, us);
+      r.blocks++;
+    }
+    if (!audioLeft) break;
+
+    // loop(): one music-mode frame
+    hostClockAdvanceMicros((uint32_t)(frameUs - clockUs));
+    clockUs = frameUs;
+    double t0 = nowUs();
+    updateAudioLevel();
+    double us = nowUs() - t0;
+    r.frameUsSum += us;
+    r.frameUsMax = std::max(r.frameUsMax, us);
+    r.frames++;
+
+    double fileMs = (double)(frameUs / 1000 - START_MS);
+    if (beatDetected && !prevBeat) {
+      detections.push_back(fileMs + latencyTotalMicros(false) / 1000.0);
+    }
+    prevBeat = beatDetected;
+
+    if (fileMs >= labels.front()) {
+      float truth = labelBpmAt(labels, fileMs);
+      bool inBand = fabsf(currentBPM - truth) <= truth * LOCK_TOLERANCE;
+      framesWithTruth++;
+      if (inBand) framesInBand++;
+      else lastOutOfBand = fileMs;
+    }
+  }
+
+  // Greedy one-to-one matching in time order
+  size_t d = 0;
+  for (double label : labels) {
+    while (d < detections.size() && detections[d] < label - toleranceMs) d++;
+    if (d < detections.size() && detections[d] <= label + toleranceMs) {
+      double err = detections[d] - label;
+      r.errorSum += err;
+      r.errorAbsSum += fabs(err);
+      r.errorMax = std::max(r.errorMax, fabs(err));
+      r.hits++;
+      d++;
+    }
+  }
+  r.labels = (int)labels.size();
+  r.detections = (int)detections.size();
+  if (framesInBand > 0) r.lockMs = lastOutOfBand;
+  r.inTolerance = framesWithTruth ? (double)framesInBand / framesWithTruth : 0.0;
+  r.ok = true;
+  return r;
+}
+
+// Run in a child so every file starts from the firmware's power-on state
+static FileResult replayIsolated(const char* path, double toleranceMs, uint32_t outputLatencyUs) {
+  FileResult r = {};
+  int fds[2];
+  if (pipe(fds) != 0) return r;
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    FileResult child = replayFile(path, toleranceMs, outputLatencyUs);
+    ssize_t written = write(fds[1], &child, sizeof(child));
+    _exit(written == (ssize_t)sizeof(child) ? 0 : 1);
+  }
+  close(fds[1]);
+  if (read(fds[0], &r, sizeof(r)) != (ssize_t)sizeof(r)) r.ok = false;
+  close(fds[0]);
+  waitpid(pid, nullptr, 0);
+  return r;
+}
+
+int main(int argc, char** argv) {
+  double toleranceMs = 70.0;
+  uint32_t outputLatencyUs = 8000;
+  int opt;
+  while ((opt = getopt(argc, argv, "t:l:")) != -1) {
+    if (opt == 't') toleranceMs = atof(optarg);
+    else if (opt == 'l') outputLatencyUs = (uint32_t)(atof(optarg) * 1000);
+    else {
+      fprintf(stderr, "usage: %s [-t tolerance_ms] [-l output_latency_ms] file.wav...\n", argv[0]);
+      return 2;
+    }
+  }
+  if (optind >= argc) {
+    fprintf(stderr, "usage: %s [-t tolerance_ms] [-l output_latency_ms] file.wav...\n", argv[0]);
+    return 2;
+  }
+
+  printf("%-24s %5s %5s %6s %6s %6s %8s %8s %8s %7s %8s %8s\n", "file", "beats", "det",
+         "prec", "recall", "F1", "err ms", "|err|ms", "lock ms", "inBPM", "us/block", "us/frame");
+  FileResult total = {};
+  int files = 0, failed = 0;
+  double lockSum = 0;
+  int locked = 0;
+  for (int i = optind; i < argc; i++) {
+    FileResult r = replayIsolated(argv[i], toleranceMs, outputLatencyUs);
+    std::string name = argv[i];
+    name = name.substr(name.rfind('/') + 1);
+    if (!r.ok) {
+      printf("%-24s  FAILED\n", name.c_str());
+      failed++;
+      continue;
+    }
+    double precision = r.detections ? (double)r.hits / r.detections : 0.0;
+    double recall = (double)r.hits / r.labels;
+    double f1 = precision + recall > 0 ? 2 * precision * recall / (precision + recall) : 0.0;
+    printf("%-24s %5d %5d %6.3f %6.3f %6.3f %8.1f %8.1f %8.0f %6.0f%% %8.1f %8.1f\n", name.c_str(),
+           r.labels, r.detections, precision, recall, f1,
+           r.hits ? r.errorSum / r.hits : 0.0, r.hits ? r.errorAbsSum / r.hits : 0.0,
+           r.lockMs, r.inTolerance * 100, r.blocks ? r.blockUsSum / r.blocks : 0.0,
+           r.frames ? r.frameUsSum / r.frames : 0.0);
+
+    files++;
+    total.labels += r.labels;
+    total.detections += r.detections;
+    total.hits += r.hits;
+    total.errorSum += r.errorSum;
+    total.errorAbsSum += r.errorAbsSum;
+    total.inTolerance += r.inTolerance;
+    total.blockUsSum += r.blockUsSum;
+    total.blockUsMax = std::max(total.blockUsMax, r.blockUsMax);
+    total.blocks += r.blocks;
+    total.frameUsSum += r.frameUsSum;
+    total.frameUsMax = std::max(total.frameUsMax, r.frameUsMax);
+    total.frames += r.frames;
+    if (r.lockMs >= 0) {
+      lockSum += r.lockMs;
+      locked++;
+    }
+  }
+
+  if (files > 0) {
+    double precision = total.detections ? (double)total.hits / total.detections : 0.0;
+    double recall = total.labels ? (double)total.hits / total.labels : 0.0;
+    double f1 = precision + recall > 0 ? 2 * precision * recall / (precision + recall) : 0.0;
+    printf("%-24s %5d %5d %6.3f %6.3f %6.3f %8.1f %8.1f %8.0f %6.0f%% %8.1f %8.1f\n", "TOTAL",
+           total.labels, total.detections, precision, recall, f1,
+           total.hits ? total.errorSum / total.hits : 0.0,
+           total.hits ? total.errorAbsSum / total.hits : 0.0,
+           locked ? lockSum / locked : -1.0, total.inTolerance / files * 100,
+           total.blocks ? total.blockUsSum / total.blocks : 0.0,
+           total.frames ? total.frameUsSum / total.frames : 0.0);
+    printf("\nhit window +/-%.0fms, assumed output latency %.1fms, host CPU peak %.1fus/block %.1fus/frame\n",
+           toleranceMs, outputLatencyUs / 1000.0, total.blockUsMax, total.frameUsMax);
+    printf("err = visible beat - labelled beat (negative = early); lock = last frame BPM was off by >4%%\n");
+  }
+  return failed ? 1 : 0;
+}
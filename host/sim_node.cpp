@@ -0,0 +1,95 @@
+// Entry points of one simulated node (sim_node.h). Linked into the sketch's
+// shared object next to m5lights_v1.ino, so it reaches the sketch's globals
+// directly.
+
+#include "sim_node.h"
+#include "config.h"
+#include "frame_codec.h"
+#include "clock_sync.h"
+#include "tx_queue.h"
+#include "mesh.h"
+#include "broadcast_rate.h"
+#include "election.h"
+#include "recovery.h"
+
+// Defined by m5lights_v1.ino
+void setup();
+void loop();
+void switchToNormalLeaderMode();
+extern bool leaderDataActive;
+extern FrameDecoder syncDecoder;
+extern FrameAssembler v1Assembly;
+extern FrameAssembler paramAssembly;
+
+// Linker-made bounds of the RTC_NOINIT_ATTR section (stubs/Arduino.h)
+extern uint8_t __start_rtc_noinit[], __stop_rtc_noinit[];
+
+static SimShowHook showHook = nullptr;
+
+static void forwardShow(const CRGB* leds, int count, uint8_t brightness) {
+  showHook(leds[0].raw, count, brightness);
+}
+
+extern "C" {
+
+void simNodeSetup() { setup(); }
+void simNodeLoop() { loop(); }
+void simNodeMakeLeader() {
+  electionSetPinned(true);
+  switchToNormalLeaderMode();
+}
+
+void simNodeSetShowHook(SimShowHook hook) {
+  showHook = hook;
+  FastLED.showHook = hook ? forwardShow : nullptr;
+}
+
+void simNodeSetVerbose(bool verbose) { Serial.enabled = verbose; }
+bool simNodeFollowing() { return leaderDataActive; }
+bool simNodeLeading() { return currentMode == MODE_NORMAL_LEADER || currentMode == MODE_MUSIC_LEADER; }
+bool simNodeClockLocked() { return clockSyncLocked(); }
+int simNodeHops() { return meshStats().hops == MESH_NO_ROUTE ? -1 : meshStats().hops; }
+bool simNodeRelaying() { return meshStats().relaying; }
+
+void simNodeStats(SimNodeStats* stats) {
+  *stats = SimNodeStats();
+  const SyncStats* streams[] = {&paramAssembly.stats, &syncDecoder.assembly.stats, &v1Assembly.stats};
+  for (const SyncStats* s : streams) {
+    stats->complete += s->complete;
+    stats->torn += s->torn;
+    stats->late += s->late;
+    stats->dropped += s->dropped;
+    stats->corrupt += s->corrupt;
+    stats->recovered += s->recovered;
+    stats->unrecoverable += s->unrecoverable;
+  }
+  TxStats tx = txQueueStats();
+  stats->txQueued = tx.queued;
+  stats->txSent = tx.sent;
+  stats->txFailed = tx.failed;
+  stats->txDropped = tx.dropped;
+  MeshStats mesh = meshStats();
+  stats->forwarded = mesh.forwarded;
+  stats->duplicates = mesh.duplicates;
+  RateStats rate = broadcastRateStats();
+  stats->rateFrames = rate.frames;
+  stats->rateUnchanged = rate.unchanged;
+  stats->rateHeld = rate.held;
+  ElectionStats election = electionStats();
+  stats->elections = election.elections;
+  stats->electionsWon = election.won;
+  stats->failovers = election.failovers;
+  stats->failoverMaxMs = election.failoverMaxMs;
+  RecoveryStats recovery = recoveryStats();
+  stats->stalls = recovery.stalls;
+  stats->stallsRecovered = recovery.recovered[RECOVERY_FLUSH] + recovery.recovered[RECOVERY_RESET] +
+                           recovery.recovered[RECOVERY_REBOOT];
+  stats->recoverMaxMs = recovery.maxMs;
+}
+
+uint8_t* simNodeRtcMemory(size_t* size) {
+  *size = __stop_rtc_noinit - __start_rtc_noinit;
+  return __start_rtc_noinit;
+}
+
+}
@@ -0,0 +1,43 @@
+#ifndef SIM_NODE_H
+#define SIM_NODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One simulated stick: the whole sketch plus sim_node.cpp, built as a
+// shared object that espnow_sim.cpp loads once per node. These are the only
+// symbols the simulator looks up in it (dlsym, unmangled).
+
+struct SimNodeStats {
+  // Follower frames, summed over the state, encoded and v1 streams (SyncStats)
+  uint32_t complete, torn, late, dropped, corrupt, recovered, unrecoverable;
+  // Transmit queue (TxStats)
+  uint32_t txQueued, txSent, txFailed, txDropped;
+  // Relay mesh (MeshStats)
+  uint32_t forwarded, duplicates;
+  // Leader broadcast rate (RateStats): frames sent, skipped unchanged, held back
+  uint32_t rateFrames, rateUnchanged, rateHeld;
+  // Leader election (ElectionStats)
+  uint32_t elections, electionsWon, failovers, failoverMaxMs;
+  // Stuck follower recovery (RecoveryStats): stalls, recovered, time to recover
+  uint32_t stalls, stallsRecovered, recoverMaxMs;
+};
+
+typedef void (*SimShowHook)(const uint8_t* rgb, int count, uint8_t brightness);
+
+extern "C" {
+void simNodeSetup();
+void simNodeLoop();
+void simNodeMakeLeader();                   // Pinned, as by long press
+void simNodeSetShowHook(SimShowHook hook);  // Every FastLED.show()
+void simNodeSetVerbose(bool verbose);       // Serial output on stdout
+bool simNodeFollowing();                    // leaderDataActive
+bool simNodeLeading();                      // Pinned or elected
+bool simNodeClockLocked();
+int simNodeHops();                          // Relays between us and the leader, -1 without a route
+bool simNodeRelaying();
+void simNodeStats(SimNodeStats* stats);
+uint8_t* simNodeRtcMemory(size_t* size);    // RTC_NOINIT_ATTR variables: kept over ESP.restart()
+}
+
+#endif
@@ -0,0 +1,83 @@
+// Host check for IntervalStats (interval_stats.h) against a sorted reference.
+//
+// Feeds random beat intervals and after every add() recomputes median,
+// quartiles and histogram peak from a plain sorted copy of the last N
+// intervals. Intervals are drawn on a coarse grid so duplicates are common,
+// include values outside MIN_MS..MAX_MS (clamped into the end bins), and
+// the window is full for most of the run so every add() evicts. clear() is
+// exercised every few thousand adds. Runs the audio's window size and an
+// odd one. Exits nonzero on any mismatch.
+//
+// Usage: stress_interval_stats [adds]
+
+#include "interval_stats.h"
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+template <size_t N>
+static uint64_t check(int adds, uint32_t seed) {
+  typedef IntervalStats<N> Stats;
+  static Stats stats;  // A global on the device (beatIntervalStats)
+  stats.clear();
+  std::deque<uint16_t> window;
+  std::mt19937 rng(seed);
+  uint64_t mismatches = 0;
+
+  for (int i = 0; i < adds; i++) {
+    if (i > 0 && rng() % 5000 == 0) {
+      stats.clear();
+      window.clear();
+    }
+    // 5ms grid over 100..2200ms: duplicates, and both ends out of range
+    uint16_t interval = 100 + 5 * (rng() % 421);
+    stats.add(interval);
+    window.push_back(interval);
+    if (window.size() > N) window.pop_front();
+
+    std::vector<uint16_t> sorted(window.begin(), window.end());
+    std::sort(sorted.begin(), sorted.end());
+    size_t n = sorted.size();
+    uint32_t median = (n % 2) ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    uint32_t q1 = sorted[n / 4];
+    uint32_t q3 = sorted[(3 * n) / 4];
+
+    std::vector<int> hist(Stats::BINS, 0);
+    for (uint16_t v : sorted) {
+      size_t bin = v < Stats::MIN_MS ? 0 : v > Stats::MAX_MS ? Stats::BINS - 1 : (v - Stats::MIN_MS) / Stats::BIN_MS;
+      hist[bin]++;
+    }
+    size_t best = 0;  // Lowest of equally full bins
+    for (size_t b = 1; b < Stats::BINS; b++) {
+      if (hist[b] > hist[best]) best = b;
+    }
+    uint32_t peak = Stats::MIN_MS + best * Stats::BIN_MS + Stats::BIN_MS / 2;
+
+    bool histOk = true;
+    for (size_t b = 0; b < Stats::BINS; b++) histOk &= stats.histogram(b) == hist[b];
+    if (stats.count() != n || stats.median() != median || stats.q1() != q1 || stats.q3() != q3 ||
+        stats.peakInterval() != peak || !histOk) {
+      if (mismatches < 5) {
+        printf("  N=%zu add %d: count %zu/%zu median %u/%u q1 %u/%u q3 %u/%u peak %u/%u%s\n", N, i,
+               stats.count(), n, (unsigned)stats.median(), (unsigned)median, (unsigned)stats.q1(), (unsigned)q1,
+               (unsigned)stats.q3(), (unsigned)q3, (unsigned)stats.peakInterval(), (unsigned)peak,
+               histOk ? "" : ", histogram differs");
+      }
+      mismatches++;
+    }
+  }
+  printf("IntervalStats<%zu>: %d adds, %llu mismatches against a sorted copy\n", N, adds,
+         (unsigned long long)mismatches);
+  return mismatches;
+}
+
+int main(int argc, char** argv) {
+  int adds = argc > 1 ? atoi(argv[1]) : 100000;
+  uint64_t mismatches = check<50>(adds, 1) + check<7>(adds, 2);
+  printf("%s\n", mismatches ? "FAIL" : "PASS");
+  return mismatches ? 1 : 0;
+}
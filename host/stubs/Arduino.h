@@ -0,0 +1,142 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Minimal Arduino core stand-in for the Linux host build.
+// Only what the firmware modules actually use is provided.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <ctype.h>
+#include <algorithm>
+#include <string>
+
+typedef uint8_t byte;
+
+using std::min;
+using std::max;
+
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR __attribute__((section("rtc_noinit")))  // espnow_sim keeps it over ESP.restart()
+
+template <typename T, typename L, typename H>
+inline T constrain(T x, L lo, H hi) { return x < lo ? (T)lo : (x > hi ? (T)hi : x); }
+
+// ===== HOST CLOCK =====
+// Real monotonic time by default. Replay tools switch to a manual clock and
+// advance it themselves so runs are deterministic.
+void hostClockSetManual(bool manual);
+void hostClockAdvanceMicros(uint32_t us);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+inline void yield() {}
+
+// ===== FREERTOS =====
+// Declared for the sketch; only the ESP-NOW simulator (espnow_sim.cpp)
+// defines them, running each task as a fiber on simulated time.
+typedef void* TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xFFFFFFFFu
+#define portNUM_PROCESSORS 2
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))  // 1ms tick
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char* name, uint32_t stack, void* param,
+                                   unsigned priority, TaskHandle_t* handle, BaseType_t core);
+void xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+void vTaskDelay(TickType_t ticks);
+
+// ===== SYSTEM =====
+class HostESP {
+ public:
+  void restart();  // Simulator: reboots the node
+};
+extern HostESP ESP;
+
+// ===== PINS =====
+// The button reads as released and its interrupt never fires
+#define HIGH 1
+#define LOW 0
+#define INPUT_PULLUP 0x05
+#define CHANGE 0x03
+#define digitalPinToInterrupt(pin) (pin)
+inline void pinMode(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }
+inline void attachInterrupt(uint8_t, void (*)(), int) {}
+
+// ===== STRING =====
+class String {
+ public:
+  String(const char* s = "") : str(s ? s : "") {}
+  String(const std::string& s) : str(s) {}
+  explicit String(int v) : str(std::to_string(v)) {}
+  explicit String(unsigned v) : str(std::to_string(v)) {}
+  explicit String(long v) : str(std::to_string(v)) {}
+  explicit String(unsigned long v) : str(std::to_string(v)) {}
+
+  const char* c_str() const { return str.c_str(); }
+  size_t length() const { return str.size(); }
+  String& operator+=(const String& o) { str += o.str; return *this; }
+  friend String operator+(const String& a, const String& b) { return String(a.str + b.str); }
+  friend String operator+(const char* a, const String& b) { return String(a + b.str); }
+  friend String operator+(const String& a, const char* b) { return String(a.str + b); }
+
+ private:
+  std::string str;
+};
+
+class IPAddress {
+ public:
+  bool fromString(const String& s) { text = s; return true; }
+  String toString() const { return text; }
+
+ private:
+  String text = "0.0.0.0";
+};
+
+// ===== RANDOM =====
+// Deterministic xorshift so benchmark runs are repeatable
+void randomSeed(unsigned long seed);
+long random(long howbig);
+long random(long howsmall, long howbig);
+
+// ===== SERIAL =====
+class HostSerial {
+ public:
+  bool enabled = true;  // Benchmarks turn this off to keep output clean
+
+  void begin(unsigned long) {}
+  int available() { return 0; }
+  int read() { return -1; }
+  void flush() { if (enabled) fflush(stdout); }
+  int availableForWrite() { return 4096; }  // stdout never blocks the caller
+  int printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+  size_t print(const char* s) { return out("%s", s); }
+  size_t print(char c) { return out("%c", c); }
+  size_t print(int v) { return out("%d", v); }
+  size_t print(unsigned int v) { return out("%u", v); }
+  size_t print(long v) { return out("%ld", v); }
+  size_t print(unsigned long v) { return out("%lu", v); }
+  size_t print(double v, int digits = 2) { return out("%.*f", digits, v); }
+  size_t print(const String& s) { return out("%s", s.c_str()); }
+  size_t print(const IPAddress& ip) { return print(ip.toString()); }
+
+  size_t println() { return out("\n"); }
+  template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+  size_t println(double v, int digits) { size_t n = print(v, digits); return n + println(); }
+
+ private:
+  size_t out(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HostSerial Serial;
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef HOST_FASTLED_H
+#define HOST_FASTLED_H
+
+// Thin FastLED stand-in for the Linux host build: CRGB, fill_solid and a
+// controller object that counts show() calls instead of driving a strip.
+
+#include "Arduino.h"
+
+#define FASTLED_USING_NAMESPACE
+
+enum LEDColorCorrection {
+  TypicalLEDStrip = 0xFFB0F0,
+  TypicalPixelString = 0xFFE08C,
+  UncorrectedColor = 0xFFFFFF
+};
+
+struct CRGB {
+  union {
+    struct {
+      uint8_t r;
+      uint8_t g;
+      uint8_t b;
+    };
+    uint8_t raw[3];
+  };
+
+  enum HTMLColorCode {
+    Black = 0x000000,
+    White = 0xFFFFFF,
+    Red = 0xFF0000,
+    Green = 0x008000,
+    Blue = 0x0000FF
+  };
+
+  CRGB() = default;
+  constexpr CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+  constexpr CRGB(uint32_t colorcode)
+      : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b(colorcode & 0xFF) {}
+  constexpr CRGB(HTMLColorCode colorcode) : CRGB((uint32_t)colorcode) {}
+
+  bool operator==(const CRGB& o) const { return r == o.r && g == o.g && b == o.b; }
+  bool operator!=(const CRGB& o) const { return !(*this == o); }
+};
+
+inline void fill_solid(CRGB* leds, int numToFill, const CRGB& color) {
+  for (int i = 0; i < numToFill; i++) leds[i] = color;
+}
+
+// Same shape as FastLED's: a block that runs at most once per period
+#define EVERY_N_MILLISECONDS(ms)                                     \
+  static unsigned long everyNLast_##ms = 0;                          \
+  if (millis() - everyNLast_##ms >= (ms) && (everyNLast_##ms = millis(), true))
+
+enum EOrder { RGB = 0012, RBG = 0021, GRB = 0102, GBR = 0120, BRG = 0201, BGR = 0210 };
+template <uint8_t DATA_PIN, EOrder RGB_ORDER> class WS2811 {};
+template <uint8_t DATA_PIN, EOrder RGB_ORDER> class WS2812B {};
+
+class CLEDController {
+ public:
+  CLEDController& setCorrection(uint32_t) { return *this; }
+  CLEDController& setDither(uint8_t) { return *this; }
+};
+
+class CFastLED {
+ public:
+  template <template <uint8_t, EOrder> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER>
+  CLEDController& addLeds(CRGB* data, int count) {
+    leds = data;
+    numLeds = count;
+    return controller;
+  }
+
+  void setBrightness(uint8_t scale) { brightness = scale; }
+  uint8_t getBrightness() const { return brightness; }
+  void show() {
+    showCount++;
+    if (showHook) showHook(leds, numLeds, brightness);
+  }
+
+  uint8_t brightness = 255;
+  uint32_t showCount = 0;
+  CRGB* leds = nullptr;   // Strip registered by addLeds()
+  int numLeds = 0;
+  void (*showHook)(const CRGB* leds, int count, uint8_t brightness) = nullptr;  // Simulator: observe frames
+
+ private:
+  CLEDController controller;
+};
+
+extern CFastLED FastLED;
+
+#endif
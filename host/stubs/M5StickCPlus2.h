@@ -0,0 +1,61 @@
+#ifndef HOST_M5STICKCPLUS2_H
+#define HOST_M5STICKCPLUS2_H
+
+// M5StickC Plus 2 stand-in for the Linux host build. Only the microphone is
+// modelled; it returns silence unless a host tool installs a sample source.
+// The display draws nothing and buttons are never pressed.
+
+#include "Arduino.h"
+
+class HostMic {
+ public:
+  typedef bool (*SourceFn)(int16_t* buf, size_t len);
+
+  bool begin() { return true; }
+  void setSampleRate(uint32_t rate) { sampleRate = rate; }
+  bool record(int16_t* buf, size_t len) {
+    if (source) return source(buf, len);
+    memset(buf, 0, len * sizeof(int16_t));
+    return true;
+  }
+
+  uint32_t sampleRate = 44100;
+  SourceFn source = nullptr;
+};
+
+enum HostColor : uint16_t {
+  BLACK = 0x0000, WHITE = 0xFFFF, RED = 0xF800, GREEN = 0x07E0, BLUE = 0x001F,
+  ORANGE = 0xFDA0, PURPLE = 0x780F, YELLOW = 0xFFE0, CYAN = 0x07FF, MAGENTA = 0xF81F
+};
+
+class HostDisplay {
+ public:
+  void setRotation(uint8_t) {}
+  void fillScreen(uint16_t) {}
+  void setTextColor(uint16_t) {}
+  void setTextColor(uint16_t, uint16_t) {}
+  void setTextSize(float) {}
+  void drawString(const String&, int32_t, int32_t) {}
+};
+
+class HostButton {
+ public:
+  bool isPressed() const { return false; }
+  bool wasPressed() const { return false; }
+};
+
+struct HostM5Config {};
+
+struct HostM5 {
+  HostMic Mic;
+  HostDisplay Display;
+  HostButton BtnA, BtnB;
+
+  HostM5Config config() const { return HostM5Config(); }
+  void begin(const HostM5Config&) {}
+  void update() {}
+};
+
+extern HostM5 M5;
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+// WiFi stand-in: station mode for ESP-NOW only. Access points never
+// connect, so Fluffy (E1.31) mode times out and receives nothing.
+
+#include "esp_wifi.h"
+#include "esp_now.h"
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+
+void hostMacAddress(uint8_t mac[6]);  // Simulator: this node's MAC
+
+class WiFiClass {
+ public:
+  bool mode(wifi_mode_t) { return true; }
+  bool disconnect(bool = false) { return true; }
+  wl_status_t begin(const char*, const char* = nullptr) { return WL_DISCONNECTED; }
+  wl_status_t status() { return WL_DISCONNECTED; }
+  uint8_t* macAddress(uint8_t* mac) { hostMacAddress(mac); return mac; }
+  IPAddress localIP() { return IPAddress(); }
+};
+extern WiFiClass WiFi;
+
+class WiFiUDP {
+ public:
+  uint8_t beginMulticast(const IPAddress&, uint16_t) { return 0; }
+  void stop() {}
+  int parsePacket() { return 0; }
+  int read(uint8_t*, size_t) { return 0; }
+};
+
+#endif
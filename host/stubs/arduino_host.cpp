@@ -0,0 +1,87 @@
+#include "Arduino.h"
+#include "FastLED.h"
+#include "M5StickCPlus2.h"
+#include "WiFi.h"
+
+#include <stdarg.h>
+#include <chrono>
+#include <thread>
+
+HostSerial Serial;
+CFastLED FastLED;
+HostM5 M5;
+HostESP ESP;
+WiFiClass WiFi;
+
+// ===== HOST CLOCK =====
+// Simulator nodes get theirs from espnow_sim.cpp: one clock per node
+#ifndef HOST_SIM_NODE
+static bool clockManual = false;
+static uint64_t manualMicros = 0;
+static const auto clockStart = std::chrono::steady_clock::now();
+
+void hostClockSetManual(bool manual) { clockManual = manual; }
+void hostClockAdvanceMicros(uint32_t us) { manualMicros += us; }
+
+unsigned long micros() {
+  if (clockManual) return (unsigned long)(uint32_t)manualMicros;
+  auto elapsed = std::chrono::steady_clock::now() - clockStart;
+  return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+unsigned long millis() {
+  if (clockManual) return (unsigned long)(uint32_t)(manualMicros / 1000);
+  auto elapsed = std::chrono::steady_clock::now() - clockStart;
+  return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+void delay(unsigned long ms) {
+  if (clockManual) manualMicros += (uint64_t)ms * 1000;
+  else std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+  if (clockManual) manualMicros += us;
+  else std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+#endif
+
+// ===== RANDOM =====
+static uint32_t rngState = 0x12345678;
+
+void randomSeed(unsigned long seed) {
+  rngState = seed ? (uint32_t)seed : 0x12345678;
+}
+
+long random(long howbig) {
+  if (howbig <= 0) return 0;
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return (long)(rngState % (uint32_t)howbig);
+}
+
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig) return howsmall;
+  return howsmall + random(howbig - howsmall);
+}
+
+// ===== SERIAL =====
+int HostSerial::printf(const char* fmt, ...) {
+  if (!enabled) return 0;
+  va_list args;
+  va_start(args, fmt);
+  int n = vprintf(fmt, args);
+  va_end(args);
+  return n;
+}
+
+size_t HostSerial::out(const char* fmt, ...) {
+  if (!enabled) return 0;
+  va_list args;
+  va_start(args, fmt);
+  int n = vprintf(fmt, args);
+  va_end(args);
+  return n > 0 ? (size_t)n : 0;
+}
@@ -0,0 +1,93 @@
+#include "wav_source.h"
+#include "M5StickCPlus2.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static FILE* wavFile = nullptr;
+static uint16_t wavChannels = 0;
+static uint32_t wavRate = 0;
+static uint32_t wavRemaining = 0;  // Bytes of sample data left
+
+static bool readExact(void* buf, size_t len) {
+  return fread(buf, 1, len, wavFile) == len;
+}
+
+static bool wavSourceRead(int16_t* buf, size_t len) {
+  if (!wavFile || wavRemaining < len * wavChannels * 2) return false;
+  for (size_t i = 0; i < len; i++) {
+    int32_t sum = 0;
+    for (uint16_t c = 0; c < wavChannels; c++) {
+      int16_t s;
+      if (!readExact(&s, 2)) return false;
+      sum += s;
+    }
+    buf[i] = (int16_t)(sum / wavChannels);
+  }
+  wavRemaining -= len * wavChannels * 2;
+  return true;
+}
+
+bool wavSourceOpen(const char* path) {
+  wavSourceClose();
+  wavFile = fopen(path, "rb");
+  if (!wavFile) {
+    fprintf(stderr, "wav: cannot open %s\n", path);
+    return false;
+  }
+
+  char riff[12];
+  if (!readExact(riff, 12) || memcmp(riff, "RIFF", 4) || memcmp(riff + 8, "WAVE", 4)) {
+    fprintf(stderr, "wav: %s is not a RIFF/WAVE file\n", path);
+    wavSourceClose();
+    return false;
+  }
+
+  // Walk chunks until "data", picking up the format on the way
+  uint16_t format = 0, bits = 0;
+  for (;;) {
+    char id[4];
+    uint32_t size;
+    if (!readExact(id, 4) || !readExact(&size, 4)) {
+      fprintf(stderr, "wav: %s has no data chunk\n", path);
+      wavSourceClose();
+      return false;
+    }
+    if (!memcmp(id, "fmt ", 4)) {
+      uint8_t fmt[16];
+      if (size < 16 || !readExact(fmt, 16)) break;
+      memcpy(&format, fmt, 2);
+      memcpy(&wavChannels, fmt + 2, 2);
+      memcpy(&wavRate, fmt + 4, 4);
+      memcpy(&bits, fmt + 14, 2);
+      fseek(wavFile, (size - 16) + (size & 1), SEEK_CUR);
+    } else if (!memcmp(id, "data", 4)) {
+      wavRemaining = size;
+      break;
+    } else {
+      fseek(wavFile, size + (size & 1), SEEK_CUR);
+    }
+  }
+
+  if (format != 1 || bits != 16 || wavChannels == 0) {
+    fprintf(stderr, "wav: %s must be 16-bit PCM (format=%u bits=%u channels=%u)\n",
+            path, format, bits, wavChannels);
+    wavSourceClose();
+    return false;
+  }
+
+  M5.Mic.source = wavSourceRead;
+  M5.Mic.setSampleRate(wavRate);
+  return true;
+}
+
+void wavSourceClose() {
+  if (wavFile) fclose(wavFile);
+  wavFile = nullptr;
+  wavRemaining = 0;
+  if (M5.Mic.source == wavSourceRead) M5.Mic.source = nullptr;
+}
+
+uint32_t wavSourceSampleRate() {
+  return wavRate;
+}
@@ -0,0 +1,15 @@
+#ifndef HOST_WAV_SOURCE_H
+#define HOST_WAV_SOURCE_H
+
+// WAV file sample source for the host build. wavSourceOpen() installs itself
+// as M5.Mic's source, so captureAudioBlock() reads the file exactly as it
+// would read the mic. 16-bit PCM only; stereo is downmixed to mono.
+
+#include <stdint.h>
+#include <stddef.h>
+
+bool wavSourceOpen(const char* path);
+void wavSourceClose();
+uint32_t wavSourceSampleRate();
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef INTERVAL_STATS_H
+#define INTERVAL_STATS_H
+
+#include <stdint.h>
+#include <string.h>
+
+// ===== STREAMING BEAT-INTERVAL STATISTICS =====
+// Keeps the last N beat intervals in a ring (arrival order, for eviction) and
+// a sorted copy (for order statistics). add() does one sorted insert and one
+// sorted delete - O(N) moves once per beat - then caches median, quartiles
+// and the histogram peak, so every per-frame query is O(1).
+template <size_t N>
+class IntervalStats {
+ public:
+  static constexpr uint16_t MIN_MS = 150;      // 400 BPM
+  static constexpr uint16_t MAX_MS = 2000;     // 30 BPM
+  static constexpr uint16_t BIN_MS = 25;
+  static constexpr size_t BINS = (MAX_MS - MIN_MS) / BIN_MS + 1;
+
+  void add(uint16_t interval) {
+    if (n == N) {
+      uint16_t evicted = ring[head];
+      removeSorted(evicted);
+      hist[binOf(evicted)]--;
+    } else {
+      n++;
+    }
+    ring[head] = interval;
+    head = (head + 1) % N;
+    insertSorted(interval, n - 1);
+    hist[binOf(interval)]++;
+    refresh();
+  }
+
+  void clear() {
+    n = 0;
+    head = 0;
+    memset(hist, 0, sizeof(hist));
+    cachedMedian = cachedQ1 = cachedQ3 = cachedPeak = 0;
+  }
+
+  size_t count() const { return n; }
+  uint32_t median() const { return cachedMedian; }
+  uint32_t q1() const { return cachedQ1; }
+  uint32_t q3() const { return cachedQ3; }
+  uint32_t iqr() const { return cachedQ3 - cachedQ1; }
+  uint32_t peakInterval() const { return cachedPeak; }  // Centre of the fullest bin
+  uint8_t histogram(size_t bin) const { return bin < BINS ? hist[bin] : 0; }
+
+ private:
+  static size_t binOf(uint16_t interval) {
+    if (interval < MIN_MS) return 0;
+    if (interval > MAX_MS) return BINS - 1;
+    return (interval - MIN_MS) / BIN_MS;
+  }
+
+  // sorted[0..len) is ordered; open a gap for v and write it
+  void insertSorted(uint16_t v, size_t len) {
+    size_t i = len;
+    while (i > 0 && sorted[i - 1] > v) {
+      sorted[i] = sorted[i - 1];
+      i--;
+    }
+    sorted[i] = v;
+  }
+
+  // Remove one copy of v from sorted[0..n)
+  void removeSorted(uint16_t v) {
+    size_t i = 0;
+    while (i < n && sorted[i] != v) i++;
+    for (; i + 1 < n; i++) sorted[i] = sorted[i + 1];
+  }
+
+  void refresh() {
+    cachedMedian = (n % 2) ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    cachedQ1 = sorted[n / 4];
+    cachedQ3 = sorted[(3 * n) / 4];
+    size_t best = 0;
+    for (size_t b = 1; b < BINS; b++) {
+      if (hist[b] > hist[best]) best = b;
+    }
+    cachedPeak = MIN_MS + best * BIN_MS + BIN_MS / 2;
+  }
+
+  uint16_t ring[N];
+  uint16_t sorted[N];
+  uint8_t hist[BINS] = {};
+  size_t n = 0;
+  size_t head = 0;  // Next ring slot to write (oldest entry once full)
+  uint32_t cachedMedian = 0, cachedQ1 = 0, cachedQ3 = 0, cachedPeak = 0;
+};
+
+#endif
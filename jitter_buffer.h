@@ -0,0 +1,55 @@
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== PLAYOUT JITTER BUFFER =====
+// Frames waiting for their presentation time (T::presentAt, local micros()),
+// in arrival order. Owned by a single task - not thread safe. When full the
+// oldest frame is overwritten; when several frames are due at once only the
+// newest is shown and the rest are skipped. Both are counted.
+template <typename T, size_t N>
+class JitterBuffer {
+ public:
+  // Slot for the next frame; fill it, then commit()
+  T& slot() {
+    if (count == N) {
+      head = (head + 1) % N;  // Drop the oldest
+      count--;
+      overflowCount++;
+    }
+    return items[(head + count) % N];
+  }
+  void commit() { count++; }
+
+  bool empty() const { return count == 0; }
+  size_t size() const { return count; }
+  uint32_t nextDue() const { return items[head].presentAt; }  // Oldest frame; not empty()
+
+  // Newest frame due by now, or nullptr. Valid until the next slot().
+  T* takeDue(uint32_t now) {
+    T* due = nullptr;
+    while (count > 0 && (int32_t)(items[head].presentAt - now) <= 0) {
+      if (due) skippedCount++;
+      due = &items[head];
+      head = (head + 1) % N;
+      count--;
+    }
+    return due;
+  }
+
+  void clear() { head = count = 0; }
+
+  uint32_t overflowed() const { return overflowCount; }
+  uint32_t skipped() const { return skippedCount; }
+
+ private:
+  T items[N];
+  size_t head = 0;
+  size_t count = 0;
+  uint32_t overflowCount = 0;
+  uint32_t skippedCount = 0;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "latency.h"
+#include "config.h"
+
+static const char* const stageNames[LAT_STAGE_COUNT] = {
+  "capture", "queue", "cadence", "render", "handoff", "show", "sync"
+};
+
+// Each stage is written by exactly one task, so plain words are enough
+static uint32_t stageAvg[LAT_STAGE_COUNT];  // EMA, 1/16 per sample
+
+struct StageStats {
+  uint32_t count, sum, min, max;
+};
+static StageStats calib[LAT_STAGE_COUNT];
+static bool calibrating = false;
+static unsigned long calibrationStart = 0;
+
+void latencyRecord(LatencyStage stage, uint32_t us) {
+  uint32_t avg = stageAvg[stage];
+  stageAvg[stage] = avg == 0 ? us : avg - (avg >> 4) + (us >> 4);
+
+  if (calibrating) {
+    StageStats& s = calib[stage];
+    if (s.count == 0 || us < s.min) s.min = us;
+    if (us > s.max) s.max = us;
+    s.sum += us;
+    s.count++;
+  }
+}
+
+uint32_t latencyStageMicros(LatencyStage stage) {
+  return stageAvg[stage];
+}
+
+uint32_t latencyTotalMicros(bool includeSync) {
+  uint32_t total = 0;
+  for (int i = 0; i < LAT_STAGE_COUNT; i++) {
+    if (i == LAT_SYNC && !includeSync) continue;
+    total += stageAvg[i];
+  }
+  return total;
+}
+
+void latencyStartCalibration() {
+  memset(calib, 0, sizeof(calib));
+  calibrationStart = millis();
+  calibrating = true;
+  Serial.println("[LATENCY] Calibrating for 10s - play music with a clear beat");
+}
+
+void latencyUpdate() {
+  if (calibrating && millis() - calibrationStart >= LATENCY_CALIBRATION_MS) {
+    calibrating = false;
+    latencyPrintReport();
+  }
+}
+
+// Calibration average if the stage was sampled, running average otherwise
+static uint32_t reportAverage(int stage) {
+  const StageStats& s = calib[stage];
+  return s.count ? s.sum / s.count : stageAvg[stage];
+}
+
+void latencyPrintReport() {
+  Serial.println("[LATENCY] stage      samples    min    avg    max  (us)");
+  uint32_t total = 0;
+  for (int i = 0; i < LAT_STAGE_COUNT; i++) {
+    const StageStats& s = calib[i];
+    uint32_t avg = reportAverage(i);
+    total += avg;
+    Serial.printf("[LATENCY] %-9s %8u %6u %6u %6u\n", stageNames[i],
+                  (unsigned)s.count, (unsigned)s.min, (unsigned)avg, (unsigned)s.max);
+  }
+  Serial.printf("[LATENCY] total %uus, %uus without leader sync - beat effects fire this early\n",
+                (unsigned)total, (unsigned)(total - reportAverage(LAT_SYNC)));
+}
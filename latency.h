@@ -0,0 +1,32 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+// ===== PIPELINE LATENCY BUDGET =====
+// Each stage between a drum hit and visible light records its measured cost
+// here (running average, microseconds). The beat predictor fires beat
+// effects early by the sum, and a calibration run prints the budget.
+
+enum LatencyStage {
+  LAT_CAPTURE,   // Mic block fill (half a block on average) + FFT
+  LAT_QUEUE,     // Feature waiting in the SPSC queue for loop()
+  LAT_CADENCE,   // Waiting for the next 16ms frame slot (half a frame on average)
+  LAT_RENDER,    // renderPattern() incl. output stage
+  LAT_HANDOFF,   // Triple buffer publish -> output task picks it up
+  LAT_SHOW,      // FastLED.show() wire time
+  LAT_SYNC,      // Leader only: broadcast + wait for the next broadcast slot
+  LAT_STAGE_COUNT
+};
+
+#define LATENCY_CALIBRATION_MS 10000
+
+void latencyRecord(LatencyStage stage, uint32_t us);
+uint32_t latencyStageMicros(LatencyStage stage);  // Running average
+uint32_t latencyTotalMicros(bool includeSync);    // Sum of stage averages
+
+void latencyStartCalibration();  // Collect min/avg/max for LATENCY_CALIBRATION_MS
+void latencyUpdate();            // Call from loop(); prints the report when done
+void latencyPrintReport();
+
+#endif
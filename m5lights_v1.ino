@@ -1,7 +1,7 @@
 /// @file    m5lights_v1_simple.ino
 /// @brief   ESP-NOW LED Sync with Larry's 4 Beat-Reactive Patterns
-/// @version 5.2.0
-/// @date    2026-03-14
+/// @version 5.27.0
+/// @date    2026-10-16
 /// @author  John Cohn (Larry patterns adapted from larry_test_m5stack)
 ///
 /// @changelog
@@ -168,25 +168,29 @@
 ///   - All 12 patterns from v2.6 + working music system
 ///   - High contrast music mode (2-96 brightness range)
 
-#include <M5StickCPlus2.h>
-#include <FastLED.h>
+#include "config.h"
+#include "patterns.h"
+#include "audio.h"
+#include "triple_buffer.h"
+#include "latency.h"
+#include "frame_codec.h"
+#include "clock_sync.h"
+#include "jitter_buffer.h"
+#include "spsc_queue.h"
+#include "tx_queue.h"
+#include "event_log.h"
+#include "mesh.h"
+#include "broadcast_rate.h"
+#include "election.h"
+#include "recovery.h"
 #include <esp_now.h>
 #include <WiFi.h>
 #include <esp_system.h>
 #include <esp_task_wdt.h>
 #include <esp_wifi.h>
 
-FASTLED_USING_NAMESPACE
-
 // Version info
-#define VERSION "5.2.0"
-
-// Hardware config
-#define LED_PIN 32
-#define NUM_LEDS 200
-#define BRIGHTNESS 25  // Adjusted for M5Stick power stability
-#define COLOR_ORDER GRB
-#define CHIPSET WS2811
+#define VERSION "5.27.0"
 
 // Leader sync delay - adjust to match follower display timing
 #define LEADER_DELAY_MS 10  // Delay before leader shows LEDs (ms) - reduced for smoother animation
@@ -201,127 +205,6 @@ FASTLED_USING_NAMESPACE
 #define E131_START_CHANNEL 31
 #define E131_MULTICAST_BASE "239.255.0."
 
-CRGB leds[NUM_LEDS];
-CRGB ledsNext[NUM_LEDS];  // Second buffer for cross-fading
-
-// ===== GAMMA CORRECTION SYSTEM =====
-// 8-bit gamma correction table for WS2812B LEDs (from original Larry code)
-// Extends black range (0-41 -> pure black) for dramatic dark gaps
-// Creates rich, saturated colors by applying exponential brightness curve
-const byte gammaTable[256] = {
-    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  1,  1,  2,  2,
-    3,  3,  4,  4,  4,  4,  5,  5,  5,  5,  6,  6,  6,  7,  7,  7,
-    8,  8,  8,  9,  9,  9, 10, 10, 11, 11, 11, 12, 12, 13, 13, 14,
-   14, 15, 15, 16, 16, 17, 17, 18, 18, 19, 19, 20, 20, 21, 22, 22,
-   23, 23, 24, 25, 25, 26, 26, 27, 28, 28, 29, 30, 30, 31, 32, 33,
-   33, 34, 35, 35, 36, 37, 38, 38, 39, 40, 41, 42, 42, 43, 44, 45,
-   46, 47, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 56, 57, 58, 59,
-   60, 61, 62, 63, 64, 65, 66, 67, 68, 70, 71, 72, 73, 74, 75, 76,
-   77, 78, 79, 81, 82, 83, 84, 85, 86, 88, 89, 90, 91, 92, 94, 95,
-   96, 97, 99,100,101,102,104,105,106,108,109,110,112,113,114,116,
-  117,119,120,121,123,124,126,127,129,130,132,133,135,136,138,139,
-  141,142,144,145,147,149,150,152,153,155,157,158,160,162,163,165,
-  167,168,170,172,174,175,177,179,181,182,184,186,188,190,192,193,
-  195,197,199,201,203,205,207,209,211,213,215,217,219,221,223,225
-};
-
-// Apply gamma correction to a single RGB value
-CRGB applyGamma(CRGB color) {
-  return CRGB(
-    gammaTable[color.r],
-    gammaTable[color.g],
-    gammaTable[color.b]
-  );
-}
-
-// ===== FIXED-POINT MATH UTILITIES =====
-// Sine lookup table for fixed-point math (0-180 degrees)
-// CRITICAL: Must use signed char on ESP32 for proper dark gaps!
-// ESP32 treats 'char' as unsigned by default, which breaks sine wave troughs
-const signed char sineTable[181] = {
-  0,1,2,3,5,6,7,8,9,10,11,12,13,15,16,17,
-  18,19,20,21,22,23,24,25,27,28,29,30,31,32,33,34,
-  35,36,37,38,39,40,42,43,44,45,46,47,48,49,50,51,
-  52,53,54,55,56,57,58,59,60,61,62,63,64,65,66,67,
-  67,68,69,70,71,72,73,74,75,76,77,77,78,79,80,81,
-  82,83,83,84,85,86,87,88,88,89,90,91,92,92,93,94,
-  95,95,96,97,97,98,99,100,100,101,102,102,103,104,104,105,
-  105,106,107,107,108,108,109,110,110,111,111,112,112,113,113,114,
-  114,115,115,116,116,117,117,117,118,118,119,119,120,120,120,121,
-  121,121,122,122,122,123,123,123,123,124,124,124,124,125,125,125,
-  125,125,126,126,126,126,126,126,126,127,127,127,127,127,127,127,
-  127,127,127,127,127
-};
-
-// Fixed-point sine function (angle in 720 units per cycle, 0-719)
-// Returns signed value -127 to +127
-// Uses 720-unit cycle (2× resolution of 360 degrees) for smoother animations
-signed char fixSin(int angle) {
-  angle %= 720;
-  if (angle < 0) angle += 720;
-  return (angle <= 360) ?
-     sineTable[(angle <= 180) ?
-       angle          :
-      (360 - angle)] :
-    -sineTable[(angle <= 540) ?
-      (angle - 360)   :
-      (720 - angle)];
-}
-
-// Fixed-point cosine function (angle in 720 units per cycle, 0-719)
-// Returns signed value -127 to +127
-signed char fixCos(int angle) {
-  angle %= 720;
-  if (angle < 0) angle += 720;
-  return (angle <= 360) ?
-    ((angle <= 180) ?  sineTable[180 - angle]  :
-                      -sineTable[angle - 180]) :
-    ((angle <= 540) ? -sineTable[540 - angle]  :
-                       sineTable[angle - 540]);
-}
-
-// HSV to RGB conversion with custom hue range (0-1535)
-// The Larry patterns use 1536 hue units instead of FastLED's 256
-void hsvToRgb(int h, byte s, byte v, byte *r, byte *g, byte *b) {
-  h %= 1536;
-  if (h < 0) h += 1536;
-
-  byte sextant = h >> 8;
-  byte frac = h & 255;
-  byte vs = (v * s) >> 8;
-  byte p = v - vs;
-  byte q = v - ((vs * frac) >> 8);
-  byte t = v - ((vs * (255 - frac)) >> 8);
-
-  switch (sextant) {
-    case 0: *r = v; *g = t; *b = p; break;
-    case 1: *r = q; *g = v; *b = p; break;
-    case 2: *r = p; *g = v; *b = t; break;
-    case 3: *r = p; *g = q; *b = v; break;
-    case 4: *r = t; *g = p; *b = v; break;
-    default: *r = v; *g = p; *b = q; break;
-  }
-}
-
-// Cross-fade variables
-bool isFading = false;
-float fadeAmount = 0.0f;  // 0.0 = current pattern, 1.0 = next pattern
-uint8_t fadeFromPattern = 0;
-uint8_t fadeToPattern = 0;
-unsigned long fadeStartTime = 0;
-#define FADE_DURATION_MS 3000  // 3 second fade
-
-// Ultra-Simple Mode System  
-enum NodeMode {
-  MODE_NORMAL,        // Standalone normal patterns, no sync
-  MODE_MUSIC,         // Standalone music-reactive patterns, no sync
-  MODE_NORMAL_LEADER, // Normal patterns + broadcast LED data
-  MODE_MUSIC_LEADER,  // Music patterns + broadcast LED data
-  MODE_FLUFFY         // E1.31/sACN WiFi receiver mode
-};
-
 // Simple LED data sync message
 struct LEDSync {
   uint8_t startIndex;       // LED start position (0-199)
@@ -347,70 +230,10 @@ unsigned long lastFluffyWiFiCheck = 0;
 const unsigned long FLUFFY_WIFI_CHECK_INTERVAL = 30000;  // 30s
 NodeMode previousNonLeaderMode = MODE_NORMAL;  // Track for leader exit
 
-// Pattern globals
-uint8_t gCurrentPatternNumber = 0;
-uint8_t gPreviousPatternNumber = 255;  // Track pattern changes for state reset
-bool g_patternShouldReset = false;     // Signal to patterns that they should reinitialize
-uint8_t gHue = 0;
-
-// Audio system variables (from working v2.6 implementation)
-float soundMin = 1.0f;
-float soundMax = 0.0f;
-float musicLevel = 0.0f;
-float audioLevel = 0.0f;
-bool beatDetected = false;
-bool prevAbove = false;
-uint32_t beatTimes[50];
-uint8_t beatCount = 0;
-uint32_t beatIntervals[50];         // NEW: Track intervals between beats
-uint8_t intervalCount = 0;          // NEW: Number of intervals stored
-uint32_t lastBeatTime = 0;          // NEW: Timestamp of last detected beat
-uint32_t lastBpmMillis = 0;
-bool audioDetected = true;
-uint8_t musicBrightness = BRIGHTNESS;
-unsigned long lastMusicDetectedTime = 0;  // Timestamp of last music detection for sticky behavior
-float currentBPM = 0.0f;                   // Smoothed BPM value for display
-bool beatReactive = false;                 // NEW: Whether patterns should respond to beats
-
-// Brightness decay envelope for smoother audio response
-float brightnessEnvelope = BRIGHTNESS;  // Current decaying brightness level
-unsigned long lastBrightnessUpdate = 0;  // For calculating decay time delta
-unsigned long lastBeatDetectedTime = 0;  // Track when last beat occurred
-#define BRIGHTNESS_DECAY_SECONDS 1.0f    // Time constant for exponential decay (63% falloff) - slower = less jarring
-#define BRIGHTNESS_THRESHOLD 0.35f       // Audio must exceed this level to boost brightness (0.0-1.0)
-#define BRIGHTNESS_POWER_CURVE 2.0f      // Power curve exponent (1.0=linear, 2.0=square, 3.0=cube)
-#define BRIGHTNESS_MIN 8                 // Minimum brightness during active music (very dark for contrast)
-#define BRIGHTNESS_MAX 80                // Maximum brightness - very bright for dramatic beats
-#define BRIGHTNESS_IDLE 50               // Brightness when no beats detected
-#define NO_BEAT_TIMEOUT 3000             // Restore full brightness after 3 seconds of silence
-
-// Speed envelope for moderate beat-reactive speed changes
-float speedEnvelope = 0.3f;              // Current speed multiplier (0.3 = slower base, 1.3 = boosted)
-unsigned long lastSpeedUpdate = 0;       // For calculating decay time delta
-#define SPEED_BOOST_MULTIPLIER 1.3f      // How much to boost speed on beat (1.3x on beat)
-#define SPEED_BASE 0.3f                  // Minimum speed between beats (slower for contrast)
-
-// Adaptive audio scaling - Ultra-fast response for immediate contrast
-float noiseFloor = 0.01f;          // Moving average of quiet ambient sound
-float peakLevel = 0.1f;            // Moving average of loud sound peaks
-float noiseFloorSmooth = 0.7f;     // Ultra-fast adaptation (30% new value per frame)
-float peakLevelSmooth = 0.5f;      // Ultra-fast decay (50% new value per frame)
-
 // Pattern control
 bool autoAdvancePatterns = true;   // Whether patterns auto-advance
 unsigned long lastPatternChange = 0;
 
-// ESP-NOW rejoin logic
-unsigned long lastRejoinScan = 0;
-bool rejoinMode = false;
-uint8_t rejoinAttempts = 0;
-
-// Audio configuration
-static constexpr size_t MIC_BUF_LEN = 240;
-static constexpr int MIC_SR = 44100;
-static constexpr float SMOOTH = 0.985f;  // Faster adaptation (was 0.995) for better beat detection
-static constexpr uint32_t BPM_WINDOW = 5000;
-
 // Button handling
 volatile bool buttonStateChanged = false;
 volatile bool buttonCurrentState = false;
@@ -418,184 +241,408 @@ volatile unsigned long buttonLastInterrupt = 0;
 unsigned long lastDisplayUpdate = 0;
 unsigned long lastBroadcast = 0;
 
+// Pipelined output: render in loop(), show + broadcast on the other core
+#ifndef PIPELINED_OUTPUT
+#define PIPELINED_OUTPUT 1   // Set to 0 to render and show inline in loop()
+#endif
+#define OUTPUT_TASK_CORE 0   // loop() runs on core 1
+
+#if PIPELINED_OUTPUT
+struct PipelineFrame {
+  CRGB pixels[NUM_LEDS];
+  unsigned long renderedAt;  // micros() when the render finished
+  RenderState state;         // Inputs of this render (parametric sync)
+  bool fromLeader;           // Follower rendering a leader's parametric state
+  uint32_t presentAt;        // fromLeader: leader micros() to show it at
+  uint8_t brightness;        // fromLeader: leader's global brightness
+  bool direct;               // E1.31 or mode-change blanking: show at once, no sync
+};
+TripleBuffer<PipelineFrame> framePipeline;
+TaskHandle_t outputTaskHandle = NULL;
+#endif
+
+// Leader sync transport: pattern state, keyframe/delta RLE chunks, or raw
+// LEDSync pixels. Followers accept all three.
+#ifndef SYNC_PARAMETRIC
+#define SYNC_PARAMETRIC 1    // Set to 0 to stream pixels (SYNC_ENCODED below)
+#endif
+#ifndef SYNC_ENCODED
+#define SYNC_ENCODED 1       // Set to 0 to broadcast v1 LEDSync packets only
+#endif
+// State and encoded frames are small enough to send every rendered frame
+// (broadcast_rate.h picks which go out); the output task can then hold
+// frames for scheduled presentation without stalling rendering
+#define SYNC_EVERY_FRAME ((SYNC_PARAMETRIC || SYNC_ENCODED) && PIPELINED_OUTPUT)
+// Frames carry a presentation time on the leader's clock; every node holds
+// them in a jitter buffer and shows them at that instant (clock_sync.h).
+// Otherwise the leader waits LEADER_DELAY_MS and followers show on arrival.
+#define SCHEDULED_PRESENTATION SYNC_EVERY_FRAME
+// Every frame has to fit the transport the leader uses
+static_assert(SYNC_PARAMETRIC || !SYNC_ENCODED || NUM_LEDS <= ENCODED_MAX_LEDS,
+              "encodeFrame takes at most ENCODED_MAX_LEDS pixels");
+static_assert(SYNC_ENCODED || SYNC_PARAMETRIC || NUM_LEDS <= 255, "LEDSync startIndex is one byte");
+
+RenderState presentedState;  // RenderState of the frame in leds[] (leader)
+TripleBuffer<ParamSyncPacket> paramInbox;  // Leader state: receive callback -> loop()
+
+struct ScheduledFrame {
+  CRGB pixels[NUM_LEDS];
+  uint32_t presentAt;  // Local micros() (leader micros() while in followerInbox)
+  uint8_t brightness;
+  bool timed;          // presentAt is valid (v1 packets carry no time)
+};
+// Pixel frames: receive callback -> output task (loop() without one). The
+// callback only copies; FastLED.show() there would hold the radio task for
+// the strip's whole wire time.
+TripleBuffer<ScheduledFrame> followerInbox;
+
+#if SCHEDULED_PRESENTATION
+#define JITTER_BUFFER_FRAMES 4   // PRESENT_DELAY_MAX_US is under 4 frames at 60fps
+#define PLAYOUT_SPIN_US 1500     // Busy-wait the last stretch: ticks are 1ms
+
+JitterBuffer<ScheduledFrame, JITTER_BUFFER_FRAMES> playout;  // Output task only
+
+// Clock requests: receive callback -> loop(), which replies (leader)
+struct PendingClockRequest {
+  ClockSyncPacket packet;
+  uint32_t receivedAt;        // t2
+  uint32_t leaderReceivedAt;  // Relay: t2 on the leader's clock
+};
+SpscQueue<PendingClockRequest, 8> clockRequests;
+#endif
+uint8_t selfMac[6];
+
 // Timing constants
 #define LONG_PRESS_TIME_MS 1500
-#define BROADCAST_INTERVAL_MS 50
-#define LEADER_TIMEOUT_MS 1500  // Fast re-sync: detect missing leader within 1.5s
-#define REJOIN_SCAN_INTERVAL_MS 15000  // Scan for leaders every 15 seconds
-#define COMPLETE_FRAME_TIMEOUT_MS 5000  // Max time between complete frames before restart
-
-// ===== LARRY PATTERN DECLARATIONS =====
-// Four beat-reactive patterns from larry_test_m5stack
-void solidColor();      // Random vibrant solid colors (beat triggers new color)
-void rainbowLarry();    // Smooth rotating color wheel (BPM-synced speed)
-void sineWaveChase();   // Color waves with dramatic dark gaps (BPM-synced motion)
-void wavyFlag();        // Animated red/white/blue patriotic pattern (BPM-synced waves)
-
-// Pattern list and names
-typedef void (*SimplePatternList[])();
-SimplePatternList gPatterns = {
-  solidColor,
-  rainbowLarry,
-  sineWaveChase,
-  wavyFlag
-};
+#define LEADER_TIMEOUT_MS 1500  // Hold the last frame this long for a new leader, then go standalone
 
-const char* patternNames[] = {
-  "Solid",
-  "Rainbow",
-  "SineChase",
-  "WavyFlag"
-};
+// ESP-NOW callbacks. Both run in the WiFi task: no Serial here, log through
+// LOG_EVENT (event_log.h) and loop() prints it.
+void onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
+  txQueueOnSent(status == ESP_NOW_SEND_SUCCESS);  // Frees a credit and submits the next packet
+  if (status != ESP_NOW_SEND_SUCCESS) LOG_EVENT(EV_SEND_FAIL);
+}
+
+// Track leader presence for any valid sync packet
+void noteLeaderMessage() {
+  bool wasActive = leaderDataActive;
+  lastLeaderMessage = millis();
+  leaderDataActive = true;
 
-#define ARRAY_SIZE(A) (sizeof(A) / sizeof((A)[0]))
-
-// ===== BEAT-REACTIVE HELPER FUNCTIONS =====
-// Calculate speed multiplier from beat interval (0.5x to 3.0x)
-// Faster BPM = higher speed multiplier for pattern animations
-float getBeatSpeed() {
-  uint32_t interval = getMedianInterval();
-  if (interval == 0) return 1.0f;  // No beat detected, use default speed
-
-  // Calculate BPM from interval: BPM = 60000 / intervalMs
-  // Then scale to 0.5-3.0 range:
-  //   60 BPM (1000ms) -> 1.0x (normal speed)
-  //   120 BPM (500ms) -> 2.0x (double speed)
-  //   180 BPM (333ms) -> 3.0x (triple speed)
-  //   30 BPM (2000ms) -> 0.5x (half speed)
-  float speed = 1000.0f / (float)interval;
-  return constrain(speed, 0.5f, 3.0f);
+  if (!wasActive) {
+    LOG_EVENT(EV_LEADER_DETECTED);
+  }
 }
 
-// Adjust animation increment based on beat speed
-// Example: getBeatAdjustedInc(2) returns 2 at 60BPM, 4 at 120BPM, 1 at 30BPM
-int getBeatAdjustedInc(int baseInc) {
-  return (int)(baseInc * getBeatSpeed());
+// ===== FOLLOWER FRAME ASSEMBLY =====
+// Sync packets land in per-protocol back buffers; leds[] only ever receives
+// a complete frame. A frame superseded before all of its chunks arrived is
+// torn and skipped, unless the policy below presents it anyway.
+#define PRESENT_TORN_FRAMES 0        // 1 = show a torn frame if enough of it arrived
+#define TORN_FRAME_MIN_PERCENT 80    // Chunks received before a torn frame is shown
+
+CRGB encodedBack[NUM_LEDS];      // Encoded stream (also the delta reference)
+CRGB v1Back[NUM_LEDS];           // Raw LEDSync stream
+FrameDecoder syncDecoder;
+FrameAssembler v1Assembly;       // LEDSync: sequenceNum is the frame ID, 49 LEDs per chunk
+FrameAssembler paramAssembly;    // Parametric: one chunk per frame
+uint8_t v1Brightness = BRIGHTNESS;
+uint8_t followedLeader[6];
+
+// Forget what we assembled from the leader: frame IDs, a half-built frame,
+// the decoder's delta reference. full: also the clock fit and mesh route,
+// as for a new leader. WiFi task only - it owns all of them.
+void flushLeaderState(bool full) {
+  if (full) {
+#if SCHEDULED_PRESENTATION
+    clockSyncReset();
+#endif
+    meshReset();
+  }
+  assemblyReset(syncDecoder.assembly);
+  syncDecoder.synced = false;
+  assemblyReset(v1Assembly);
+  assemblyReset(paramAssembly);
 }
 
-// Get SUBTLE beat-reactive speed multiplier for patterns (0.8x to 1.2x)
-// More subtle than before for smoother, more predictable motion
-float getBeatSpeedMultiplier() {
-  if (!audioDetected) return 1.0f;  // No music, use base speed
+// Follow one leader at a time: chunks from two leaders would mix frames.
+// mac is the leader's, also for packets relayed to us (mesh.h). Another
+// leader is taken once ours has been quiet ELECTION_LEADER_LOSS_MS - the
+// one elected in its place - while we still hold its last frame, or when
+// election.h is seeking it (a higher leader, merging).
+bool acceptLeaderPacket(const uint8_t* mac) {
+  if (leaderDataActive) {
+    if (memcmp(mac, followedLeader, 6) == 0) return true;
+    unsigned long silent = millis() - lastLeaderMessage;
+    if (electionPreferred(mac)) {
+      LOG_EVENT(EV_LEADER_MERGED);
+    } else if (silent >= ELECTION_LEADER_LOSS_MS) {
+      electionNoteLeaderChange(lastLeaderMessage);
+      LOG_EVENT(EV_LEADER_CHANGED, silent);
+    } else {
+      return false;
+    }
+  }
 
-  uint32_t interval = getMedianInterval();
-  if (interval == 0) return 1.0f;  // No beat detected
+  // New leader: its frame IDs mean nothing to what we have buffered
+  memcpy(followedLeader, mac, 6);
+  flushLeaderState(true);
+  return true;
+}
 
-  // Calculate speed from BPM, but keep it subtle (0.8x to 1.2x range)
-  // 60 BPM = 1.0x, 120 BPM = 1.2x, 30 BPM = 0.8x
-  float speed = 1000.0f / (float)interval;  // BPM-based speed
-  speed = 0.8f + (speed - 0.5f) * 0.2f;  // Map to 0.8-1.2 range
-  return constrain(speed, 0.8f, 1.2f);
+// Hand a finished back buffer to the output side, which swaps it onto the
+// strip - at presentAt (leader clock) when presentation is scheduled and
+// the frame carries a time, otherwise as soon as it picks it up
+void presentFollowerFrame(const CRGB* back, uint8_t brightness, uint32_t presentAt, bool timed) {
+  ScheduledFrame& frame = followerInbox.back();
+  memcpy(frame.pixels, back, sizeof(frame.pixels));
+  frame.brightness = brightness;
+  frame.presentAt = presentAt;
+  frame.timed = timed;
+  followerInbox.publish();
+#if PIPELINED_OUTPUT
+  xTaskNotifyGive(outputTaskHandle);
+#endif
+  lastCompleteFrame = millis();  // Mark successful complete frame reception
+  electionNoteFrame();
 }
 
-// Get speed multiplier from envelope for dramatic beat-reactive speed changes
-// Returns 1.0x (normal) to 3.5x (boosted) with smooth decay
-float getSpeedMultiplier() {
-  if (!audioDetected) return 1.0f;  // No music, use normal speed
-  return speedEnvelope;  // Use the globally tracked speed envelope
+// Call before a chunk of frameSeq is applied: it may tear the frame in back
+void handleTornFrame(FrameAssembler& assembly, uint8_t frameSeq, const CRGB* back, uint8_t brightness,
+                     uint32_t presentAt, bool timed) {
+#if PRESENT_TORN_FRAMES
+  uint8_t percent;
+  if (assemblyWouldTear(assembly, frameSeq, &percent) && percent >= TORN_FRAME_MIN_PERCENT) {
+    assembly.stats.partial++;
+    presentFollowerFrame(back, brightness, presentAt, timed);
+    LOG_EVENT(EV_TORN_PRESENTED, percent);
+  }
+#endif
 }
 
-// Get beat-reactive brightness scale for music mode patterns (0.1 to 1.0)
-// Applied BEFORE gamma correction to preserve dark gaps
-// Only affects music mode - normal mode always returns 1.0
-float getMusicBeatBrightnessScale() {
-  if (currentMode != MODE_MUSIC && currentMode != MODE_MUSIC_LEADER) {
-    return 1.0f;  // Normal mode - no scaling
+void onEncodedChunk(const uint8_t* data, int len, const MeshArrival& arrival) {
+  if (!encodedChunkIntact(data, len)) {
+    syncDecoder.assembly.stats.corrupt++;  // Before its frame ID can tear anything
+    LOG_EVENT(EV_CHUNK_CORRUPT, len);
+    return;
+  }
+  if (!meshOnSyncPacket(data, len, arrival)) return;  // Relayed copy of a chunk we have
+  handleTornFrame(syncDecoder.assembly, encodedFrameSeq(data), encodedBack, syncDecoder.brightness,
+                  syncDecoder.presentAt, true);
+  ChunkResult result = decodeChunk(syncDecoder, data, len, encodedBack, NUM_LEDS);
+  if (result == CHUNK_BAD) {
+    LOG_EVENT(EV_CHUNK_MALFORMED, len);
+    return;
   }
+  noteLeaderMessage();
 
-  // Always use brightnessEnvelope - it handles idle brightness restoration
-  // Map brightnessEnvelope (8-80) to VERY dramatic range (0.02-1.0)
-  // Idle/no beats: 50 → ~0.6, Min during beats: 8 → 0.02 (very dark!), Max on beats: 80 → 1.0 (full bright!)
-  float normalized = (brightnessEnvelope - (float)BRIGHTNESS_MIN) / (float)(BRIGHTNESS_MAX - BRIGHTNESS_MIN);
-  float scale = 0.02f + normalized * 0.98f;
-  return constrain(scale, 0.02f, 1.0f);
+  if (result == CHUNK_FRAME_COMPLETE) {
+    presentFollowerFrame(encodedBack, syncDecoder.brightness, syncDecoder.presentAt, true);
+    LOG_EVENT(EV_FRAME_COMPLETE, syncDecoder.syncedSeq);
+  } else if (result == CHUNK_NEED_KEYFRAME) {
+    LOG_EVENT(EV_NEED_KEYFRAME);
+  } else if (result == CHUNK_LATE) {
+    LOG_EVENT(EV_CHUNK_LATE, encodedFrameSeq(data));
+  }
 }
 
-// ESP-NOW callbacks
-void onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
-  // Commented out to reduce serial spam - only report failures
-  // if (status == ESP_NOW_SEND_SUCCESS) {
-  //   Serial.println("ESP-NOW: Send OK");
-  // } else {
-  if (status != ESP_NOW_SEND_SUCCESS) {
-    Serial.println("ESP-NOW: Send FAIL");
+void onParamPacket(const uint8_t* data, int len, const MeshArrival& arrival) {
+  if (!paramPacketIntact(data, len)) {
+    paramAssembly.stats.corrupt++;  // Another wire version, or damaged
+    LOG_EVENT(EV_STATE_CORRUPT, len);
+    return;
   }
+  if (!meshOnSyncPacket(data, len, arrival)) return;  // Relayed copy of a frame we have
+  noteLeaderMessage();
+  // Each packet is a whole frame: drop any older than the newest
+  AssemblyResult result = assemblyBegin(paramAssembly, ((const ParamSyncPacket*)data)->frameSeq, 0, 1);
+  if (result == ASSEMBLY_LATE || result == ASSEMBLY_DUPLICATE) return;
+  assemblyCommit(paramAssembly, 0);
+
+  // Rendering takes a while - loop() does it, like our own frames
+  memcpy(&paramInbox.back(), data, sizeof(ParamSyncPacket));
+  paramInbox.publish();
+  lastCompleteFrame = millis();
+  electionNoteFrame();
 }
 
-void onDataReceived(const esp_now_recv_info* recv_info, const uint8_t *incomingData, int len) {
-  unsigned long now = millis();
-  Serial.print("[");
-  Serial.print(now);
-  Serial.print("ms] ESP-NOW RX: ");
-  Serial.print(len);
-  Serial.print(" bytes");
+// Receive callback cost: written by the WiFi task, read racily for printing
+struct RxCallbackStats {
+  uint32_t count, totalUs, maxUs;
+};
+RxCallbackStats rxCallback;
 
-  // Only process if we're a follower (not a leader)
+void printSyncStats() {
+  struct { const char* name; const SyncStats& stats; } streams[] = {
+    {"state", paramAssembly.stats}, {"encoded", syncDecoder.assembly.stats}, {"v1", v1Assembly.stats}
+  };
+  Serial.println("=== FOLLOWER SYNC (frames) ===");
+  for (auto& stream : streams) {
+    Serial.printf("%-8s complete=%lu torn=%lu late=%lu dropped=%lu partial=%lu corrupt=%lu recovered=%lu unrecoverable=%lu\n",
+                  stream.name, (unsigned long)stream.stats.complete, (unsigned long)stream.stats.torn,
+                  (unsigned long)stream.stats.late, (unsigned long)stream.stats.dropped,
+                  (unsigned long)stream.stats.partial, (unsigned long)stream.stats.corrupt,
+                  (unsigned long)stream.stats.recovered, (unsigned long)stream.stats.unrecoverable);
+  }
+  RxCallbackStats rx = rxCallback;
+  if (rx.count > 0) {
+    Serial.printf("receive callback avg/max %lu/%luus over %lu packets\n", (unsigned long)(rx.totalUs / rx.count),
+                  (unsigned long)rx.maxUs, (unsigned long)rx.count);
+  }
+  memset(&rxCallback, 0, sizeof(rxCallback));
+  recoveryPrintReport();
+}
+
+#if SCHEDULED_PRESENTATION
+// Clock exchange: leaders and relays queue requests for loop() to answer,
+// followers take replies addressed to them. Too frequent to log.
+void onClockSyncPacket(const uint8_t* mac, const uint8_t* data, uint32_t receivedAt) {
+  PendingClockRequest pending;
+  memcpy(&pending.packet, data, sizeof(pending.packet));
+  pending.receivedAt = receivedAt;
+  bool leader = currentMode == MODE_NORMAL_LEADER || currentMode == MODE_MUSIC_LEADER;
+
+  if (pending.packet.type == CLOCK_REQUEST && leader) {
+    clockRequests.push(pending);
+  } else if (pending.packet.type == CLOCK_REQUEST && meshRelaying() && leaderDataActive &&
+             clockSyncLocalToLeader(receivedAt, &pending.leaderReceivedAt)) {
+    clockRequests.push(pending);  // Relays answer the nodes they serve; loop() checks which
+  } else if (pending.packet.type == CLOCK_REPLY && !leader && leaderDataActive &&
+             memcmp(mac, meshUpstream(), 6) == 0 && memcmp(pending.packet.requester, selfMac, 6) == 0) {
+    clockSyncOnReply(pending.packet, receivedAt);  // From the leader, or the relay we hear it through
+  }
+}
+#endif
+
+// Everything a packet needs in the WiFi task: decode into a back buffer and,
+// when a frame completes, copy it to the output side
+void receivePacket(const uint8_t* mac, const uint8_t *incomingData, int len, uint32_t receivedAt) {
+#if SCHEDULED_PRESENTATION
+  if (isClockSyncPacket(incomingData, len)) {
+    onClockSyncPacket(mac, incomingData, receivedAt);
+    return;
+  }
+#endif
+  if (isMeshBeacon(incomingData, len)) {
+    const MeshBeacon* beacon = (const MeshBeacon*)incomingData;
+    if (currentMode != MODE_NORMAL_LEADER && currentMode != MODE_MUSIC_LEADER) {
+      meshOnBeacon(mac, incomingData);
+    } else if (beacon->hops != MESH_NO_ROUTE) {
+      electionOnRival(beacon->leader, beacon->flags & MESH_BEACON_LEADER_PINNED);  // Leader beyond our range
+    }
+    return;
+  }
+  // Relayed packets: from here on incomingData is the leader's packet
+  MeshArrival arrival;
+  arrival.receivedAt = receivedAt;
+  if (!meshUnwrap(mac, incomingData, len, arrival)) {
+    LOG_EVENT(EV_MESH_MALFORMED, len);
+    return;
+  }
+  // Leaders only listen for other leaders' heartbeats (election.h)
   if (currentMode == MODE_NORMAL_LEADER || currentMode == MODE_MUSIC_LEADER) {
-    Serial.println(" - IGNORED (I'm a leader)");
+    if (isElectionHeartbeat(incomingData, len)) {
+      electionOnRival(arrival.origin, ((const ElectionHeartbeat*)incomingData)->flags & ELECTION_FLAG_PINNED);
+    }
+    LOG_EVENT(EV_RX_LEADER, len);
+    return;
+  }
+  if (!acceptLeaderPacket(arrival.origin)) {
+    LOG_EVENT(EV_RX_OTHER_LEADER, len);
+    return;
+  }
+  LOG_EVENT(EV_RX_PACKET, len, arrival.hops);
+  RecoveryTier flush = recoveryTakeFlush();  // Stuck (recovery.h): loop() can't touch our state
+  if (flush != RECOVERY_NONE) flushLeaderState(flush == RECOVERY_RESET);
+
+  if (isElectionHeartbeat(incomingData, len)) {
+    if (!meshOnSyncPacket(incomingData, len, arrival)) return;
+    electionOnHeartbeat(incomingData);
+    noteLeaderMessage();
+    return;
+  }
+  if (isEncodedPacket(incomingData, len)) {
+    onEncodedChunk(incomingData, len, arrival);
+    return;
+  }
+  if (isParamPacket(incomingData, len)) {
+    onParamPacket(incomingData, len, arrival);
     return;
   }
-  Serial.println();
 
   // Verify message size
   if (len != sizeof(LEDSync)) {
-    Serial.print("ESP-NOW: WRONG SIZE, expected ");
-    Serial.print(sizeof(LEDSync));
-    Serial.print(", got ");
-    Serial.println(len);
+    LOG_EVENT(EV_RX_WRONG_SIZE, sizeof(LEDSync), len);
     return;
   }
 
   LEDSync receivedData;
   memcpy(&receivedData, incomingData, sizeof(receivedData));
 
-  Serial.print("  Packet: seq=");
-  Serial.print(receivedData.sequenceNum);
-  Serial.print(", start=");
-  Serial.print(receivedData.startIndex);
-  Serial.print(", count=");
-  Serial.println(receivedData.count);
+  LOG_EVENT(EV_V1_PACKET, receivedData.sequenceNum, receivedData.startIndex, receivedData.count);
+
+  // Leaders send V1_LEDS_PER_PACKET LEDs per packet, all packets of a frame share sequenceNum
+  const int chunkCount = (NUM_LEDS + V1_LEDS_PER_PACKET - 1) / V1_LEDS_PER_PACKET;
+  if (receivedData.startIndex % V1_LEDS_PER_PACKET != 0 || receivedData.startIndex >= NUM_LEDS ||
+      receivedData.count > V1_LEDS_PER_PACKET) {
+    LOG_EVENT(EV_V1_OUTSIDE_STRIP, receivedData.startIndex);
+    return;
+  }
+  uint8_t chunkIndex = receivedData.startIndex / V1_LEDS_PER_PACKET;
+  if (!meshOnSyncPacket(incomingData, len, arrival)) return;
 
   // Update leader activity
-  bool wasActive = leaderDataActive;
-  lastLeaderMessage = millis();
-  leaderDataActive = true;
+  noteLeaderMessage();
 
-  if (!wasActive) {
-    Serial.println("  >>> LEADER DETECTED - now following <<<");
+  handleTornFrame(v1Assembly, receivedData.sequenceNum, v1Back, v1Brightness, 0, false);
+  AssemblyResult result = assemblyBegin(v1Assembly, receivedData.sequenceNum, chunkIndex, chunkCount);
+  if (result == ASSEMBLY_LATE || result == ASSEMBLY_DUPLICATE) {
+    LOG_EVENT(EV_V1_DROPPED);
+    return;
   }
 
-  // Exit rejoin mode immediately when receiving valid leader data
-  if (rejoinMode) {
-    rejoinMode = false;
-    rejoinAttempts = 0;
-    Serial.println("  >>> EXITING REJOIN MODE <<<");
-  }
+  // Brightness from leader (for audio sync)
+  v1Brightness = receivedData.brightness;
 
-  // Apply brightness from leader (for audio sync)
-  FastLED.setBrightness(receivedData.brightness);
-  
-  // Apply LED data directly
-  for (int i = 0; i < receivedData.count && i < 49; i++) {
+  // Assemble into the back buffer
+  for (int i = 0; i < receivedData.count; i++) {
     int ledIndex = receivedData.startIndex + i;
     if (ledIndex < NUM_LEDS) {
       int dataIndex = i * 3;
-      leds[ledIndex].r = receivedData.rgbData[dataIndex];
-      leds[ledIndex].g = receivedData.rgbData[dataIndex + 1];
-      leds[ledIndex].b = receivedData.rgbData[dataIndex + 2];
+      v1Back[ledIndex].r = receivedData.rgbData[dataIndex];
+      v1Back[ledIndex].g = receivedData.rgbData[dataIndex + 1];
+      v1Back[ledIndex].b = receivedData.rgbData[dataIndex + 2];
     }
   }
-  
-  // Show LEDs when we receive the last packet
-  if (receivedData.startIndex + receivedData.count >= NUM_LEDS) {
-    FastLED.show();
-    lastCompleteFrame = millis();  // Mark successful complete frame reception
-    Serial.println("  ✓ COMPLETE FRAME - LEDs updated");
+
+  // Show LEDs once every packet of this frame has arrived
+  if (assemblyCommit(v1Assembly, chunkIndex)) {
+    presentFollowerFrame(v1Back, v1Brightness, 0, false);
+    LOG_EVENT(EV_FRAME_COMPLETE, receivedData.sequenceNum);
   } else {
-    Serial.println("  ... waiting for more packets");
+    LOG_EVENT(EV_V1_WAITING);
   }
 }
 
+void onDataReceived(const esp_now_recv_info* recv_info, const uint8_t *incomingData, int len) {
+  uint32_t receivedAt = micros();  // Before any work: clock sync t2/t4
+  receivePacket(recv_info->src_addr, incomingData, len, receivedAt);
+
+  uint32_t elapsed = micros() - receivedAt;
+  rxCallback.count++;
+  rxCallback.totalUs += elapsed;
+  if (elapsed > rxCallback.maxUs) rxCallback.maxUs = elapsed;
+}
+
+bool addBroadcastPeer() {
+  esp_now_peer_info_t peerInfo = {};
+  memcpy(peerInfo.peer_addr, broadcastAddress, 6);
+  peerInfo.channel = 1;
+  peerInfo.encrypt = false;
+  peerInfo.ifidx = WIFI_IF_STA;
+  return esp_now_add_peer(&peerInfo) == ESP_OK;
+}
+
 // ESP-NOW setup
 void setupESPNOW() {
   WiFi.mode(WIFI_STA);
@@ -609,14 +656,13 @@ void setupESPNOW() {
   
   esp_now_register_send_cb(onDataSent);
   esp_now_register_recv_cb(onDataReceived);
+  txQueueBegin([](const uint8_t* data, uint16_t len) {
+    return esp_now_send(broadcastAddress, data, len) == ESP_OK;
+  });
+  WiFi.macAddress(selfMac);  // Clock replies are broadcast, addressed by MAC; elections rank by it
+  electionBegin(selfMac);
   
-  esp_now_peer_info_t peerInfo = {};
-  memcpy(peerInfo.peer_addr, broadcastAddress, 6);
-  peerInfo.channel = 1;
-  peerInfo.encrypt = false;
-  peerInfo.ifidx = WIFI_IF_STA;
-  
-  if (esp_now_add_peer(&peerInfo) != ESP_OK) {
+  if (!addBroadcastPeer()) {
     Serial.println("ESP-NOW peer add failed");
   } else {
     Serial.println("ESP-NOW setup complete");
@@ -645,6 +691,31 @@ void joinE131Multicast() {
   }
 }
 
+// Frames that skip patterns and sync (E1.31, blanking on entering or
+// leaving Fluffy mode): fill directFrame(), then showDirectFrame(). With the
+// output task they go through the pipeline like any other frame, so loop()
+// never writes leds[] or shows while that task may be presenting.
+CRGB* directFrame() {
+#if PIPELINED_OUTPUT
+  return framePipeline.back().pixels;
+#else
+  return leds;
+#endif
+}
+
+void showDirectFrame() {
+#if PIPELINED_OUTPUT
+  PipelineFrame& frame = framePipeline.back();
+  frame.direct = true;
+  frame.fromLeader = false;
+  frame.renderedAt = micros();
+  framePipeline.publish();
+  xTaskNotifyGive(outputTaskHandle);
+#else
+  FastLED.show();
+#endif
+}
+
 void enterFluffyMode() {
   Serial.println("*** ENTERING FLUFFY MODE ***");
   Serial.flush();
@@ -689,8 +760,8 @@ void enterFluffyMode() {
   }
 
   // Clear all LEDs to black
-  fill_solid(leds, NUM_LEDS, CRGB::Black);
-  FastLED.show();
+  fill_solid(directFrame(), NUM_LEDS, CRGB::Black);
+  showDirectFrame();
 }
 
 void exitFluffyMode() {
@@ -709,8 +780,8 @@ void exitFluffyMode() {
   setupESPNOW();
 
   // Clear LEDs
-  fill_solid(leds, NUM_LEDS, CRGB::Black);
-  FastLED.show();
+  fill_solid(directFrame(), NUM_LEDS, CRGB::Black);
+  showDirectFrame();
 }
 
 void checkFluffyWiFi() {
@@ -789,25 +860,26 @@ void processE131() {
   // Log packet receipt every 5 seconds
   packetCount++;
   if (millis() - lastPacketLog > 5000) {
-    Serial.printf("E131: receiving OK - %lu packets in last 5s\n", packetCount);
+    Serial.printf("E131: receiving OK - %lu packets in last 5s\n", (unsigned long)packetCount);
     packetCount = 0;
     lastPacketLog = millis();
   }
 
   // Map 300 channels to 100 RGB LEDs
+  CRGB* frame = directFrame();
   for (int i = 0; i < 100; i++) {
     int channelIndex = startIndex + (i * 3);
-    leds[i].r = dmxData[channelIndex];
-    leds[i].g = dmxData[channelIndex + 1];
-    leds[i].b = dmxData[channelIndex + 2];
+    frame[i].r = dmxData[channelIndex];
+    frame[i].g = dmxData[channelIndex + 1];
+    frame[i].b = dmxData[channelIndex + 2];
   }
 
   // Clear remaining 100 LEDs to black
   for (int i = 100; i < NUM_LEDS; i++) {
-    leds[i] = CRGB::Black;
+    frame[i] = CRGB::Black;
   }
 
-  FastLED.show();
+  showDirectFrame();
 }
 
 // Broadcast LED data (for leader modes)
@@ -816,7 +888,6 @@ void broadcastLEDData() {
   static uint32_t broadcastCount = 0;
   unsigned long now = millis();
 
-  const int LEDS_PER_PACKET = 49;  // Reduced by 1 to fit brightness byte
   static uint8_t sequenceNum = 0;
 
   LEDSync message;
@@ -836,9 +907,9 @@ void broadcastLEDData() {
   int successCount = 0;
   int failCount = 0;
 
-  for (int startIdx = 0; startIdx < NUM_LEDS; startIdx += LEDS_PER_PACKET) {
+  for (int startIdx = 0; startIdx < NUM_LEDS; startIdx += V1_LEDS_PER_PACKET) {
     message.startIndex = startIdx;
-    message.count = min(LEDS_PER_PACKET, NUM_LEDS - startIdx);
+    message.count = min(V1_LEDS_PER_PACKET, NUM_LEDS - startIdx);
     message.brightness = FastLED.getBrightness();  // Include current brightness
 
     // Pack RGB data
@@ -850,325 +921,24 @@ void broadcastLEDData() {
       message.rgbData[dataIdx + 2] = leds[ledIdx].b;
     }
 
-    esp_err_t result = esp_now_send(broadcastAddress, (uint8_t*)&message, sizeof(message));
-    if (result == ESP_OK) {
+    // Queued, not sent: the TX queue paces packets by send completions
+    if (txQueueSend((uint8_t*)&message, sizeof(message))) {
       successCount++;
     } else {
       failCount++;
     }
-
-    // Small delay between packets to prevent ESP-NOW buffer overflow
-    delayMicroseconds(500);  // 0.5ms between packets
   }
 
-  // Log if any packets failed
+  // Log if the queue had to drop older packets
   if (failCount > 0) {
-    Serial.print("!!! BROADCAST FAILED: ");
+    Serial.print("!!! BROADCAST BACKLOG: ");
     Serial.print(failCount);
-    Serial.print(" packets failed, ");
+    Serial.print(" queued packets dropped, ");
     Serial.print(successCount);
-    Serial.println(" succeeded");
+    Serial.println(" queued cleanly");
   }
 }
 
-// Audio system (working implementation from v2.6)
-void initAudio() {
-  M5.Mic.begin(); 
-  M5.Mic.setSampleRate(MIC_SR);
-  lastBpmMillis = millis();
-  Serial.println("Audio initialized");
-}
-
-void detectAudioFrame() {
-  static int16_t micBuf[MIC_BUF_LEN];
-  if (!M5.Mic.record(micBuf, MIC_BUF_LEN)) return;
-  
-  long sum = 0;
-  for (auto &v : micBuf) sum += abs(v);
-  float raw = float(sum) / MIC_BUF_LEN / 32767.0f;
-
-  // Asymmetric smoothing: slow rise, fast fall for soundMax to prevent tap spikes from lingering
-  soundMin = min(raw, SMOOTH * soundMin + (1 - SMOOTH) * raw);
-
-  if (raw > soundMax) {
-    // Rising: use slow smoothing (SMOOTH = 0.985)
-    soundMax = max(raw, SMOOTH * soundMax + (1 - SMOOTH) * raw);
-  } else {
-    // Falling: use fast decay (0.95 = 5% new value per frame, ~13x faster than rising)
-    const float FAST_DECAY = 0.95f;
-    soundMax = max(raw, FAST_DECAY * soundMax + (1 - FAST_DECAY) * raw);
-  }
-  
-  // Adaptive sensitivity with aggressive AGC for noisy environments
-  float dynamicRange = soundMax - soundMin;
-  const float MIN_DYNAMIC_RANGE = 0.25f;  // Increased from 0.15 for more aggressive AGC
-  const float HIGH_VOLUME_THRESHOLD = 0.3f;  // Lower threshold to trigger AGC earlier
-
-  float adaptedMin = soundMin;
-  float adaptedMax = soundMax;
-  float beatThreshold = 0.25f;  // Default threshold - lowered for sensitivity
-
-  bool highVolumeEnvironment = (soundMin > HIGH_VOLUME_THRESHOLD) || (dynamicRange < MIN_DYNAMIC_RANGE);
-
-  if (highVolumeEnvironment) {
-    if (dynamicRange < MIN_DYNAMIC_RANGE) {
-      // More aggressive expansion for better dynamic range in noisy environments
-      float expansion = (MIN_DYNAMIC_RANGE - dynamicRange) * 1.5f;  // Increased from 1.0 to 1.5
-      adaptedMin = max(0.0f, soundMin - expansion);
-      adaptedMax = min(1.0f, soundMax + expansion);
-    }
-    beatThreshold = 0.12f;  // Very low threshold for better beat detection
-  }
-
-  // Debug output every 60 frames (~1 second) when in music mode
-  static int debugCounter = 0;
-  if ((currentMode == MODE_MUSIC || currentMode == MODE_MUSIC_LEADER) && ++debugCounter >= 60) {
-    debugCounter = 0;
-    Serial.print("Audio: raw=");
-    Serial.print(raw, 3);
-    Serial.print(" min=");
-    Serial.print(soundMin, 3);
-    Serial.print(" max=");
-    Serial.print(soundMax, 3);
-    Serial.print(" range=");
-    Serial.print(dynamicRange, 3);
-    Serial.print(" level=");
-    Serial.print(musicLevel, 3);
-    Serial.print(" thresh=");
-    Serial.print(beatThreshold, 2);
-    Serial.print(" AGC=");
-    Serial.print(highVolumeEnvironment ? "ON" : "OFF");
-    Serial.print(" beat=");
-    Serial.println(beatDetected ? "YES" : "NO");
-  }
-  
-  musicLevel = constrain((raw - adaptedMin) / (adaptedMax - adaptedMin + 1e-6f), 0.0f, 1.0f);
-  audioLevel = musicLevel;
-  
-  bool above = (musicLevel > beatThreshold);
-  if (above && !prevAbove) {
-    uint32_t t = millis();
-
-    // Track beat times (for legacy BPM calculation)
-    if (beatCount < 50) {
-      beatTimes[beatCount++] = t;
-    } else {
-      memmove(beatTimes, beatTimes + 1, 49 * sizeof(uint32_t));
-      beatTimes[49] = t;
-    }
-
-    // NEW: Track beat intervals for improved BPM calculation
-    if (lastBeatTime > 0) {
-      uint32_t interval = t - lastBeatTime;
-      // Only track reasonable intervals (150ms to 2000ms = 30-400 BPM)
-      if (interval >= 150 && interval <= 2000) {
-        if (intervalCount < 50) {
-          beatIntervals[intervalCount++] = interval;
-        } else {
-          memmove(beatIntervals, beatIntervals + 1, 49 * sizeof(uint32_t));
-          beatIntervals[49] = interval;
-        }
-      }
-    }
-    lastBeatTime = t;
-    lastBeatDetectedTime = t;  // Track for brightness restoration
-
-    beatDetected = true;
-  } else if (!above) {
-    beatDetected = false;
-  }
-  prevAbove = above;
-}
-
-// Helper function to find median interval (for stable BPM calculation)
-uint32_t getMedianInterval() {
-  if (intervalCount == 0) return 0;
-
-  // Copy intervals to temp array for sorting
-  uint32_t temp[50];
-  memcpy(temp, beatIntervals, intervalCount * sizeof(uint32_t));
-
-  // Simple bubble sort (small array, not performance critical)
-  for (int i = 0; i < intervalCount - 1; i++) {
-    for (int j = 0; j < intervalCount - i - 1; j++) {
-      if (temp[j] > temp[j + 1]) {
-        uint32_t swap = temp[j];
-        temp[j] = temp[j + 1];
-        temp[j + 1] = swap;
-      }
-    }
-  }
-
-  // Return median
-  if (intervalCount % 2 == 0) {
-    return (temp[intervalCount/2 - 1] + temp[intervalCount/2]) / 2;
-  } else {
-    return temp[intervalCount/2];
-  }
-}
-
-void updateBPM() {
-  uint32_t now = millis();
-  if (now - lastBpmMillis >= BPM_WINDOW) {
-    // Count beats in window (for music detection)
-    int cnt = 0;
-    uint32_t cutoff = now - BPM_WINDOW;
-    for (int i = 0; i < beatCount; i++) {
-      if (beatTimes[i] >= cutoff) cnt++;
-    }
-
-    // NEW: INTERVAL-BASED BPM CALCULATION
-    // Instead of just counting beats, find the most common interval
-    // This locks onto the actual tempo instead of fluctuating
-    float bpm = 0.0f;
-    if (intervalCount >= 3) {  // Need at least 3 intervals for median
-      uint32_t medianInterval = getMedianInterval();
-      if (medianInterval > 0) {
-        bpm = 60000.0f / float(medianInterval);  // Convert interval to BPM
-      }
-    } else if (cnt >= 2) {
-      // Fallback to count-based if not enough intervals yet
-      bpm = cnt * (60000.0f / float(BPM_WINDOW));
-    }
-
-    // VERY AGGRESSIVE SMOOTHING - 90% old + 10% new for rock-solid display
-    // This prevents BPM from jumping around on the display
-    if (currentBPM == 0.0f || currentBPM < 10.0f) {
-      currentBPM = bpm;  // First reading or reset, no smoothing
-    } else if (bpm > 0.0f) {
-      currentBPM = currentBPM * 0.9f + bpm * 0.1f;
-    }
-
-    // DEBUG: Print beat info to help diagnose detection issues
-    Serial.print("BPM Check: beats=");
-    Serial.print(cnt);
-    Serial.print(", intervals=");
-    Serial.print(intervalCount);
-    Serial.print(", rawBPM=");
-    Serial.print(bpm);
-    Serial.print(", smoothed=");
-    Serial.print(currentBPM);
-    Serial.print(", audioDetected=");
-    Serial.println(audioDetected ? "YES" : "NO");
-
-    // ULTRA-STICKY HYSTERESIS DETECTION - very sensitive and stable
-    // Enter music mode: 2+ beats (very low threshold - highly sensitive)
-    // Stay in music mode: 1+ beat OR within 20 second timeout (ultra sticky)
-    // Exit music mode: 0 beats AND timeout expired (strong momentum)
-
-    bool beatsDetected = (cnt >= 2 && currentBPM >= 30.0f && currentBPM <= 300.0f);  // Enter threshold
-    bool sustainBeats = (cnt >= 1 && currentBPM >= 30.0f && currentBPM <= 300.0f);   // Stay threshold
-
-    if (beatsDetected || sustainBeats) {
-      lastMusicDetectedTime = now;  // Update timestamp on any beat activity
-      audioDetected = true;
-    } else {
-      // Only exit music mode if no beats for 20 seconds (ultra-sticky timeout)
-      if (now - lastMusicDetectedTime > 20000) {
-        audioDetected = false;
-        currentBPM = 0.0f;  // Reset BPM when exiting music mode
-      }
-      // Otherwise stay in music mode (strong momentum)
-    }
-
-    lastBpmMillis += BPM_WINDOW;
-    beatCount = 0;
-  }
-}
-
-void updateAudioLevel() {
-  detectAudioFrame();
-  updateBPM();
-  
-  // Always adapt BOTH noiseFloor and peakLevel to track current audio range
-  // This ensures brightness always scales from min to max based on recent audio
-  noiseFloor = noiseFloor * noiseFloorSmooth + audioLevel * (1.0f - noiseFloorSmooth);
-  peakLevel = peakLevel * peakLevelSmooth + audioLevel * (1.0f - peakLevelSmooth);
-
-  // Simple direct mapping: loud voice = bright (25), quiet voice = dark (1)
-  // Fast-adapting noiseFloor and peakLevel keep the range appropriate
-  float range = peakLevel - noiseFloor;
-  if (range < 0.01f) range = 0.01f;  // Prevent division by zero
-
-  float normalizedLevel = (audioLevel - noiseFloor) / range;
-  normalizedLevel = constrain(normalizedLevel, 0.0f, 1.0f);
-
-  // THRESHOLD AND POWER CURVE - pronounced beats boost brightness dramatically
-  // Quieter sounds below threshold stay at base brightness
-  // Above threshold, apply power curve for dramatic response
-  float targetBrightness;
-  if (normalizedLevel < BRIGHTNESS_THRESHOLD) {
-    targetBrightness = (float)BRIGHTNESS_MIN;  // Minimum brightness for quiet sounds
-  } else {
-    // Scale from threshold to 1.0 into 0.0 to 1.0 range
-    float scaledLevel = (normalizedLevel - BRIGHTNESS_THRESHOLD) / (1.0f - BRIGHTNESS_THRESHOLD);
-    // Apply power curve for dramatic response
-    float curved = pow(scaledLevel, BRIGHTNESS_POWER_CURVE);
-    // Map to WIDE brightness range (30-200) for VERY visible pulsing!
-    targetBrightness = (float)BRIGHTNESS_MIN + (curved * (float)(BRIGHTNESS_MAX - BRIGHTNESS_MIN));
-  }
-
-  // SMOOTH DECAY ENVELOPE - requested by Max!
-  // Fast attack (instant response to peaks), exponential decay (0.5s time constant)
-  unsigned long now = millis();
-  float timeDelta = (now - lastBrightnessUpdate) / 1000.0f;  // Convert to seconds
-  lastBrightnessUpdate = now;
-
-  if (targetBrightness > brightnessEnvelope) {
-    // ATTACK: New peak is higher - instantly jump to it
-    brightnessEnvelope = targetBrightness;
-  } else {
-    // GAUSSIAN/EXPONENTIAL DECAY: Natural smooth falloff
-    // Uses time constant tau (BRIGHTNESS_DECAY_SECONDS)
-    // Formula: envelope = target + (envelope - target) * exp(-timeDelta / tau)
-    float tau = BRIGHTNESS_DECAY_SECONDS;
-    float decayFactor = exp(-timeDelta / tau);
-    brightnessEnvelope = targetBrightness + (brightnessEnvelope - targetBrightness) * decayFactor;
-
-    // Don't go below minimum brightness
-    if (brightnessEnvelope < (float)BRIGHTNESS_MIN) {
-      brightnessEnvelope = (float)BRIGHTNESS_MIN;
-    }
-  }
-
-  // Check if no beats detected for a while - restore to idle brightness
-  // Also check if current audio level is low (just background noise, not music)
-  bool noBeatsTimeout = (now - lastBeatDetectedTime) > NO_BEAT_TIMEOUT;
-  bool lowAudioLevel = (normalizedLevel < BRIGHTNESS_THRESHOLD);
-
-  if (noBeatsTimeout || (lowAudioLevel && brightnessEnvelope < (float)BRIGHTNESS_IDLE * 0.7f)) {
-    // No beats for a while OR very low audio - restore to idle brightness for visibility
-    brightnessEnvelope = (float)BRIGHTNESS_IDLE;
-  }
-
-  // SPEED ENVELOPE - dramatic speed boost on beat with smooth decay
-  // Same attack/decay behavior as brightness for consistent feel
-  float targetSpeed = beatDetected ? SPEED_BOOST_MULTIPLIER : SPEED_BASE;
-
-  float speedTimeDelta = (now - lastSpeedUpdate) / 1000.0f;
-  lastSpeedUpdate = now;
-
-  if (targetSpeed > speedEnvelope) {
-    // ATTACK: Instantly boost speed on beat
-    speedEnvelope = targetSpeed;
-  } else {
-    // DECAY: Smooth falloff back to normal speed (same tau as brightness)
-    float tau = BRIGHTNESS_DECAY_SECONDS;
-    float decayFactor = exp(-speedTimeDelta / tau);
-    speedEnvelope = targetSpeed + (speedEnvelope - targetSpeed) * decayFactor;
-
-    // Don't go below base speed
-    if (speedEnvelope < SPEED_BASE) {
-      speedEnvelope = SPEED_BASE;
-    }
-  }
-
-  musicBrightness = (uint8_t)brightnessEnvelope;
-  // NOTE: We don't set FastLED.setBrightness() here anymore!
-  // Instead, patterns apply brightness scaling BEFORE gamma in music mode
-  // This keeps global brightness constant and preserves dark gaps
-}
-
 // Button interrupt handler
 void IRAM_ATTR buttonInterrupt() {
   unsigned long currentTime = millis();
@@ -1217,6 +987,22 @@ void switchToMusicLeaderMode() {
   Serial.println("*** MUSIC LEADER MODE ***");
 }
 
+// Elected (election.h): carry the lost leader's show on where it was. Its
+// parametric state becomes our patterns; pixel streams leave nothing to
+// adopt, so ours go on from where they were.
+void takeOverAsLeader() {
+  if (adoptSyncState(LEADER_TIMEOUT_MS)) {
+    Serial.printf("Continuing the last leader's patterns (pattern %u)\n", (unsigned)gCurrentPatternNumber);
+  }
+  electionSetPinned(false);
+  if (currentMode == MODE_MUSIC) {
+    switchToMusicLeaderMode();
+  } else {
+    switchToNormalLeaderMode();
+  }
+  lastPatternChange = millis();
+}
+
 // Button handling
 void handleButtons() {
   static enum { BTN_IDLE, BTN_PRESSED, BTN_LONG_TRIGGERED, BTN_COOLDOWN } buttonState = BTN_IDLE;
@@ -1266,14 +1052,15 @@ void handleButtons() {
         lastAction = now;
         
       } else if (now - buttonPressTime >= LONG_PRESS_TIME_MS) {
-        // Long press: Toggle leader status of current mode
+        // Long press: pin this node as leader, or unpin it. Elected leaders
+        // (election.h) are pinned in place.
         Serial.print("Long press from mode: ");
         Serial.println(currentMode);
 
-        // LEADER CONFLICT PREVENTION: Check if another leader already exists
+        // LEADER CONFLICT PREVENTION: an elected leader gives way to us, a pinned one doesn't
         if (currentMode == MODE_NORMAL || currentMode == MODE_MUSIC) {
-          if (leaderDataActive || (now - lastLeaderMessage < LEADER_TIMEOUT_MS)) {
-            Serial.println("*** BLOCKED: Another leader is already active! ***");
+          if ((leaderDataActive || (now - lastLeaderMessage < LEADER_TIMEOUT_MS)) && electionLeaderPinned()) {
+            Serial.println("*** BLOCKED: Another leader is pinned! ***");
             Serial.print("leaderDataActive: ");
             Serial.print(leaderDataActive);
             Serial.print(", Time since last leader msg: ");
@@ -1284,17 +1071,24 @@ void handleButtons() {
           }
         }
 
-        if (currentMode == MODE_NORMAL) {
+        if ((currentMode == MODE_NORMAL_LEADER || currentMode == MODE_MUSIC_LEADER) && !electionPinned()) {
+          Serial.println("Pinning elected leader");
+          electionSetPinned(true);
+        } else if (currentMode == MODE_NORMAL) {
+          electionSetPinned(true);
           Serial.println("Switching NORMAL -> NORMAL_LEADER");
           switchToNormalLeaderMode();
         } else if (currentMode == MODE_MUSIC) {
           Serial.println("Switching MUSIC -> MUSIC_LEADER");
+          electionSetPinned(true);
           switchToMusicLeaderMode();
         } else if (currentMode == MODE_NORMAL_LEADER) {
           Serial.println("Switching NORMAL_LEADER -> NORMAL");
+          electionSetPinned(false);
           switchToNormalMode();
         } else if (currentMode == MODE_MUSIC_LEADER) {
           Serial.println("Switching MUSIC_LEADER -> MUSIC");
+          electionSetPinned(false);
           switchToMusicMode();
         }
         buttonState = BTN_LONG_TRIGGERED;
@@ -1404,8 +1198,8 @@ void updateDisplay() {
   switch (currentMode) {
     case MODE_NORMAL: modeStr = "NORMAL"; break;
     case MODE_MUSIC: modeStr = "MUSIC"; break;
-    case MODE_NORMAL_LEADER: modeStr = "NORM LEAD"; break;
-    case MODE_MUSIC_LEADER: modeStr = "MUSIC LEAD"; break;
+    case MODE_NORMAL_LEADER: modeStr = electionPinned() ? "NORM LEAD" : "NORM LEAD*"; break;  // * = elected
+    case MODE_MUSIC_LEADER: modeStr = electionPinned() ? "MUSIC LEAD" : "MUSIC LEAD*"; break;
     case MODE_FLUFFY:
       modeStr = fluffyWiFiConnected ? "FLUFFY (WiFi)" : "FLUFFY (No WiFi)";
       break;
@@ -1414,7 +1208,9 @@ void updateDisplay() {
   
   // Pattern info
   if (leaderDataActive && (currentMode == MODE_NORMAL || currentMode == MODE_MUSIC)) {
-    M5.Display.drawString("Following...", 10, 50);
+    MeshStats mesh = meshStats();
+    String route = mesh.hops == MESH_NO_ROUTE ? "" : " hop " + String(mesh.hops) + (mesh.relaying ? " RELAY" : "");
+    M5.Display.drawString((recoveryLocal() ? "Resyncing..." : "Following...") + route, 10, 50);
   } else if (currentMode == MODE_MUSIC || currentMode == MODE_MUSIC_LEADER) {
     String patternDisplay = String(gCurrentPatternNumber) + ": " + String(patternNames[gCurrentPatternNumber]);
     M5.Display.drawString(patternDisplay, 10, 50);
@@ -1428,62 +1224,30 @@ void updateDisplay() {
   }
 }
 
-void nextPattern() {
-  // Start cross-fade to next pattern
-  fadeFromPattern = gCurrentPatternNumber;
-  fadeToPattern = (gCurrentPatternNumber + 1) % ARRAY_SIZE(gPatterns);
-  isFading = true;
-  fadeAmount = 0.0f;
-  fadeStartTime = millis();
-
-  // Signal new pattern to initialize (BEFORE fade starts so it's ready)
-  g_patternShouldReset = true;
-
-  Serial.print("Fading from pattern ");
-  Serial.print(fadeFromPattern);
-  Serial.print(" to ");
-  Serial.println(fadeToPattern);
-
-  // Track pattern change for state reset
-  gPreviousPatternNumber = gCurrentPatternNumber;
-}
-
-// Enhanced leader timeout with rejoin logic
+// Stuck follower recovery, and standalone once nobody took over from our leader
 void checkLeaderTimeout() {
   unsigned long now = millis();
 
-  // Check for stuck state: receiving packets but not complete frames
-  // Case 1: We've received frames before but haven't gotten one recently
-  // Case 2: We've been receiving packets for a while but NEVER got a complete frame
-  bool stuckState = false;
-
-  if (leaderDataActive && (now - lastLeaderMessage < LEADER_TIMEOUT_MS)) {
-    // We're actively receiving leader packets
-    if (lastCompleteFrame > 0 && (now - lastCompleteFrame > COMPLETE_FRAME_TIMEOUT_MS)) {
-      // Case 1: Had complete frames before, but not recently
-      stuckState = true;
-    } else if (lastCompleteFrame == 0 && leaderDataActive && (now - lastLeaderMessage > COMPLETE_FRAME_TIMEOUT_MS)) {
-      // Case 2: Never received complete frame but been receiving packets for 5+ seconds
-      stuckState = true;
-    }
-  }
-
-  if (stuckState) {
-    // Stuck state detected - restart for clean recovery
-    Serial.println("\n!!! CRITICAL: STUCK STATE DETECTED !!!");
-    Serial.print("  Time since last complete frame: ");
-    if (lastCompleteFrame > 0) {
-      Serial.print(now - lastCompleteFrame);
-      Serial.println("ms");
-    } else {
-      Serial.println("NEVER");
-    }
-    Serial.print("  Time since last leader msg: ");
-    Serial.print(now - lastLeaderMessage);
-    Serial.println("ms");
-    Serial.println("  >>> RESTARTING ESP32 IN 2 SECONDS <<<\n");
-    delay(2000);  // Give time for serial message to be sent
-    ESP.restart();  // Clean restart - most robust recovery
+  // Packets but no complete frames: escalate (recovery.h). FLUSH is done by
+  // the receive callback on the next packet.
+  switch (recoveryUpdate(leaderDataActive, lastCompleteFrame)) {
+    case RECOVERY_RESET:
+      esp_now_del_peer(broadcastAddress);
+      if (!addBroadcastPeer()) Serial.println("[RECOVER] ESP-NOW peer add failed");
+      if (adoptSyncState(RECOVERY_REBOOT_MS)) {
+        Serial.printf("[RECOVER] Rendering the leader's last patterns (pattern %u) meanwhile\n",
+                      (unsigned)gCurrentPatternNumber);
+      }
+      lastPatternChange = now;
+      break;
+    case RECOVERY_REBOOT:
+      Serial.println("[RECOVER] >>> RESTARTING, resuming mode and pattern <<<");
+      recoverySaveForReboot(currentMode, gCurrentPatternNumber);
+      Serial.flush();
+      ESP.restart();
+      break;
+    default:
+      break;
   }
 
   if (leaderDataActive && (now - lastLeaderMessage > LEADER_TIMEOUT_MS)) {
@@ -1491,35 +1255,309 @@ void checkLeaderTimeout() {
     Serial.print("  Time since last leader msg: ");
     Serial.print(now - lastLeaderMessage);
     Serial.println("ms");
-    Serial.println("  >>> ENTERING REJOIN MODE <<<\n");
+    Serial.println("  >>> BACK TO OWN PATTERNS - any leader is taken from here <<<\n");
     leaderDataActive = false;
-    rejoinMode = true;
-    rejoinAttempts = 0;
-    lastRejoinScan = now;
   }
-  
-  // Active rejoin scanning for dropped followers
-  if (rejoinMode && (now - lastRejoinScan > REJOIN_SCAN_INTERVAL_MS)) {
-    if (rejoinAttempts < 5) {  // Try 5 times before giving up
-      Serial.print("Rejoin attempt ");
-      Serial.println(rejoinAttempts + 1);
-      
-      // Reset ESP-NOW to try reconnecting
-      esp_now_deinit();
-      delay(100);
-      setupESPNOW();
-      
-      rejoinAttempts++;
-      lastRejoinScan = now;
-      
-      if (rejoinAttempts >= 5) {
-        rejoinMode = false;
-        Serial.println("Rejoin attempts exhausted - staying standalone");
+}
+
+// FastLED.show() with its wire time recorded in the latency budget
+void showMeasured() {
+  unsigned long showStart = micros();
+  FastLED.show();
+  latencyRecord(LAT_SHOW, micros() - showStart);
+}
+
+#if SYNC_PARAMETRIC
+// Broadcast the state the frame in leds[] was rendered from; one packet
+bool broadcastParamFrame(uint32_t presentAt) {
+  static uint8_t frameSeq = 0;
+  static unsigned long lastBroadcastLog = 0;
+  static uint32_t framesSent = 0, dropCount = 0;
+
+  ParamSyncPacket packet;
+  packet.magic = PARAM_MAGIC;
+  packet.frameSeq = frameSeq++;
+  packet.brightness = FastLED.getBrightness();
+  packet.presentAt = presentAt;
+  packet.state = presentedState;
+  paramPacketSeal(packet);
+  if (!txQueueSend((uint8_t*)&packet, sizeof(packet))) dropCount++;  // An older packet gave way
+  framesSent++;
+
+  unsigned long now = millis();
+  if (now - lastBroadcastLog > 1000) {
+    Serial.print("[LEADER TX] State ");
+    Serial.print(framesSent);
+    Serial.print(" frames x ");
+    Serial.print(sizeof(packet));
+    Serial.print(" bytes in ");
+    Serial.print(now - lastBroadcastLog);
+    Serial.print("ms, ");
+    Serial.print(dropCount);
+    Serial.println(" dropped");
+    framesSent = dropCount = 0;
+    lastBroadcastLog = now;
+  }
+  return true;
+}
+#endif
+
+#if SYNC_ENCODED
+// Broadcast leds[] as encoded chunks: a keyframe every KEYFRAME_INTERVAL
+// frames, otherwise the XOR delta against the previous broadcast.
+// Packets are queued (tx_queue.h); while the channel is still busy with
+// earlier frames this one is skipped whole, before encoding, so the next
+// delta is taken against the last frame that actually went out (false).
+#define ENCODED_FRAME_CHUNKS_MAX ((NUM_LEDS * 3 + ENCODED_MAX_PAYLOAD - 1) / ENCODED_MAX_PAYLOAD + 1)  // Keyframe + RLE tokens
+#define ENCODED_FRAME_PACKETS_MAX (ENCODED_FRAME_CHUNKS_MAX + FEC_PARITY_PACKETS(ENCODED_FRAME_CHUNKS_MAX))
+
+bool broadcastEncodedFrame(uint32_t presentAt) {
+  static CRGB syncReference[NUM_LEDS];
+  static EncodedPacket packets[ENCODED_MAX_PACKETS];
+  static uint8_t frameSeq = 0;
+  static uint8_t framesSinceKey = KEYFRAME_INTERVAL;
+  static unsigned long lastKeyframe = 0;
+  static unsigned long lastBroadcastLog = 0;
+  static uint32_t framesSent = 0, packetsSent = 0, bytesSent = 0, framesSkipped = 0;
+  static uint32_t lastLost = 0;
+
+  // Packets lost in the queue or on the air: followers lost a frame - resync
+  TxStats tx = txQueueStats();
+  if (tx.dropped + tx.failed != lastLost) {
+    lastLost = tx.dropped + tx.failed;
+    framesSinceKey = KEYFRAME_INTERVAL;
+  }
+  if (txQueueFree() < ENCODED_FRAME_PACKETS_MAX) {
+    framesSkipped++;  // Back-pressure
+    return false;
+  }
+
+  unsigned long now = millis();
+  bool keyframe = framesSinceKey >= KEYFRAME_INTERVAL || now - lastKeyframe >= KEYFRAME_MAX_AGE_MS;
+  frameSeq++;
+  int count = encodeFrame(leds, syncReference, NUM_LEDS, keyframe, frameSeq,
+                          FastLED.getBrightness(), presentAt, packets, ENCODED_MAX_PACKETS);
+  if (count == 0) return false;  // Can't happen: NUM_LEDS <= ENCODED_MAX_LEDS is asserted above
+  framesSinceKey = keyframe ? 1 : framesSinceKey + 1;
+  if (keyframe) lastKeyframe = now;
+
+  for (int i = 0; i < count; i++) {
+    txQueueSend(packets[i].data, packets[i].len);
+    bytesSent += packets[i].len;
+  }
+  framesSent++;
+  packetsSent += count;
+
+  if (now - lastBroadcastLog > 1000) {
+    Serial.print("[LEADER TX] Encoded ");
+    Serial.print(framesSent);
+    Serial.print(" frames, ");
+    Serial.print(packetsSent);
+    Serial.print(" packets, ");
+    Serial.print(bytesSent);
+    Serial.print(" bytes in ");
+    Serial.print(now - lastBroadcastLog);
+    Serial.print("ms, ");
+    Serial.print(framesSkipped);
+    Serial.println(" skipped (TX backlog)");
+    framesSent = packetsSent = bytesSent = framesSkipped = 0;
+    lastBroadcastLog = now;
+  }
+  return true;
+}
+#endif
+
+#if !SCHEDULED_PRESENTATION
+// Show the newest follower frame, if one arrived (output task, or loop())
+void showFollowerFrame() {
+  if (!followerInbox.acquire()) return;
+  const ScheduledFrame& frame = followerInbox.front();
+  memcpy(leds, frame.pixels, sizeof(leds));
+  FastLED.setBrightness(frame.brightness);
+  showMeasured();
+}
+#endif
+
+#if SCHEDULED_PRESENTATION
+// ===== SCHEDULED PRESENTATION (output task) =====
+void schedulePlayout(const CRGB* pixels, uint8_t brightness, uint32_t presentAt) {
+  ScheduledFrame& frame = playout.slot();
+  memcpy(frame.pixels, pixels, sizeof(frame.pixels));
+  frame.brightness = brightness;
+  frame.presentAt = presentAt;
+  frame.timed = true;
+  playout.commit();
+}
+
+// Local show time for a leader-stamped frame that is ready now. Untimed
+// frames, or any before the clock has locked, go out at once.
+uint32_t scheduleLeaderTime(uint32_t leaderPresentAt, bool timed) {
+  uint32_t now = micros();
+  if (!timed || !clockSyncLocked()) return now;
+  uint32_t local = clockSyncLeaderToLocal(leaderPresentAt);
+  clockSyncNoteMargin((int32_t)(local - now));  // Feedback for the leader's delay
+  return local;
+}
+
+void acceptFollowerFrame() {
+  if (!followerInbox.acquire()) return;
+  const ScheduledFrame& frame = followerInbox.front();
+  schedulePlayout(frame.pixels, frame.brightness, scheduleLeaderTime(frame.presentAt, frame.timed));
+}
+
+// Sleep until a new frame arrives or the next one is almost due
+TickType_t playoutWaitTicks() {
+  if (playout.empty()) return portMAX_DELAY;
+  int32_t wait = (int32_t)(playout.nextDue() - micros()) - PLAYOUT_SPIN_US;
+  return wait > 0 ? pdMS_TO_TICKS(wait / 1000) : 0;
+}
+
+// Show the newest frame that is due, spinning the last PLAYOUT_SPIN_US
+void presentDueFrame() {
+  if (playout.empty()) return;
+  uint32_t due = playout.nextDue();
+  if ((int32_t)(due - micros()) > PLAYOUT_SPIN_US) return;
+  while ((int32_t)(due - micros()) > 0) {
+  }
+
+  uint32_t now = micros();
+  ScheduledFrame* frame = playout.takeDue(now);
+  if (!frame) return;
+  memcpy(leds, frame->pixels, sizeof(leds));
+  FastLED.setBrightness(frame->brightness);
+  clockSyncRecordPresent((int32_t)(now - frame->presentAt));
+  showMeasured();
+}
+
+void printClockReport() {
+  clockSyncPrintReport();
+  Serial.printf("[CLOCK] jitter buffer %u/%u frames, %lu skipped, %lu overflowed, presentation delay %uus\n",
+                (unsigned)playout.size(), (unsigned)JITTER_BUFFER_FRAMES, (unsigned long)playout.skipped(),
+                (unsigned long)playout.overflowed(), (unsigned)presentDelayMicros());
+}
+#endif
+
+// Show the finished frame in leds[]
+// If leader: broadcast FIRST, then wait for followers to receive/process, then show
+void presentFrame(unsigned long now) {
+  if (currentMode == MODE_NORMAL_LEADER || currentMode == MODE_MUSIC_LEADER) {
+    static unsigned long lastSkipLog = 0;
+    // Content and congestion decide which frames go out (broadcast_rate.h)
+    bool beat = currentMode == MODE_MUSIC_LEADER && now - lastBeatDetectedTime < RATE_BEAT_HOLD_MS;
+    if (broadcastRateShouldSend(leds, NUM_LEDS, beat, now)) {
+      unsigned long sendStart = micros();
+#if SCHEDULED_PRESENTATION
+      // Everyone, us included, shows this frame presentDelay from now
+      uint32_t presentAt = sendStart + presentDelayMicros();
+#else
+      uint32_t presentAt = 0;
+#endif
+#if SYNC_PARAMETRIC
+      bool sent = broadcastParamFrame(presentAt);
+#elif SYNC_ENCODED
+      bool sent = broadcastEncodedFrame(presentAt);
+#else
+      broadcastLEDData();  // v1 packets carry no presentation time
+      bool sent = true;
+      (void)presentAt;
+#endif
+      if (sent) {
+        broadcastRateNoteSent(leds, NUM_LEDS, now);
+        electionNoteSent(now);
+      }
+#if SCHEDULED_PRESENTATION
+      // Frames followers don't get aren't shown here either
+      if (sent) {
+        latencyRecord(LAT_SYNC, presentDelayMicros());
+        schedulePlayout(leds, FastLED.getBrightness(), presentAt);
       }
+#else
+      // Followers see this frame after the send, and a beat waits half a broadcast slot on average
+      latencyRecord(LAT_SYNC, (micros() - sendStart) + broadcastRateIntervalMs() * 500);
+#endif
+      lastBroadcast = now;
+      // NO MORE BLOCKING DELAY! Use non-blocking check below instead
+    } else if (now - lastSkipLog > 5000) {
+      Serial.print("[LEADER] Holding broadcast: ");
+      Serial.print(now - lastBroadcast);
+      Serial.print("ms since last, interval ");
+      Serial.print(broadcastRateIntervalMs());
+      Serial.println("ms");
+      lastSkipLog = now;
+    }
+#if SCHEDULED_PRESENTATION
+    // The output task shows it from the jitter buffer
+#else
+    // Non-blocking wait: only show if enough time has passed since last broadcast
+    if (now - lastBroadcast >= LEADER_DELAY_MS) {
+      showMeasured();
     }
+#endif
+  } else {
+    showMeasured();  // Non-leader: show immediately
   }
 }
 
+#if PIPELINED_OUTPUT
+// Output task: owns FastLED.show() and broadcastLEDData() so the ~6ms strip
+// transmit and ESP-NOW sends never stall rendering on the loop() core. In
+// Fluffy mode it shows only direct frames (E1.31), and each of those drops
+// whatever was still scheduled from before the switch.
+void outputTask(void* param) {
+  for (;;) {
+#if SCHEDULED_PRESENTATION
+    ulTaskNotifyTake(pdTRUE, playoutWaitTicks());
+#else
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#endif
+    bool fluffy = currentMode == MODE_FLUFFY;
+    if (fluffy) {
+      followerInbox.acquire();  // Stale ESP-NOW frame: never shown
+    } else {
+#if SCHEDULED_PRESENTATION
+      acceptFollowerFrame();
+      presentDueFrame();
+#else
+      showFollowerFrame();
+#endif
+    }
+    if (!framePipeline.acquire()) continue;
+    const PipelineFrame& frame = framePipeline.front();
+
+    if (frame.direct) {
+#if SCHEDULED_PRESENTATION
+      playout.clear();
+#endif
+      memcpy(leds, frame.pixels, sizeof(leds));
+      showMeasured();
+      continue;
+    }
+    // Followers show the leader's frames, Fluffy mode only direct ones - drop stale local frames
+    if (fluffy ||
+        (leaderDataActive && (currentMode == MODE_NORMAL || currentMode == MODE_MUSIC) && !frame.fromLeader &&
+         !recoveryLocal())) {
+      continue;
+    }
+
+    latencyRecord(LAT_HANDOFF, micros() - frame.renderedAt);
+#if SCHEDULED_PRESENTATION
+    if (frame.fromLeader) {
+      schedulePlayout(frame.pixels, frame.brightness, scheduleLeaderTime(frame.presentAt, true));
+      presentDueFrame();
+      continue;
+    }
+#endif
+    memcpy(leds, frame.pixels, sizeof(leds));
+    presentedState = frame.state;
+    if (frame.fromLeader) FastLED.setBrightness(frame.brightness);
+    presentFrame(millis());
+#if SCHEDULED_PRESENTATION
+    presentDueFrame();
+#endif
+  }
+}
+#endif
+
 void setup() {
   // Initialize M5StickC Plus 2
   auto cfg = M5.config();
@@ -1529,8 +1567,12 @@ void setup() {
   M5.Display.setTextColor(WHITE);
   M5.Display.setTextSize(1);
   
+  // Back from a recovery reboot (recovery.h): resume the show at once
+  uint8_t resumeMode, resumePattern;
+  bool resumed = recoveryRestore(&resumeMode, &resumePattern);
+
   Serial.begin(115200);
-  delay(1000);
+  if (!resumed) delay(1000);
   
   // Initialize watchdog timer (30 second timeout)
   esp_task_wdt_config_t wdt_config = {
@@ -1549,12 +1591,26 @@ void setup() {
   lastBeatDetectedTime = millis();
 
   // Initialize FastLED
-  FastLED.addLeds<CHIPSET, LED_PIN, COLOR_ORDER>(leds, NUM_LEDS).setCorrection(TypicalLEDStrip);
+  // White balance at show time only: leds[] and everything broadcast from it
+  // stay uncorrected, so every follower applies its own strip's correction once
+  FastLED.addLeds<CHIPSET, LED_PIN, COLOR_ORDER>(leds, NUM_LEDS).setCorrection(COLOR_CORRECTION);
   FastLED.setBrightness(BRIGHTNESS);
   
   randomSeed(micros());
-  fill_solid(leds, NUM_LEDS, CRGB::Black);
-  FastLED.show();
+  if (resumed) {
+    // The strip still holds its last frame: no blanking
+    if (resumeMode == MODE_MUSIC) switchToMusicMode();
+    selectPattern(resumePattern);
+    Serial.printf("[RECOVER] Resumed %s mode, pattern %u\n", resumeMode == MODE_MUSIC ? "music" : "normal",
+                  (unsigned)resumePattern);
+  } else {
+    fill_solid(leds, NUM_LEDS, CRGB::Black);
+    FastLED.show();
+  }
+
+#if PIPELINED_OUTPUT
+  xTaskCreatePinnedToCore(outputTask, "ledOutput", 4096, NULL, 2, &outputTaskHandle, OUTPUT_TASK_CORE);
+#endif
   
   // Initialize pattern timing
   lastPatternChange = millis();
@@ -1566,60 +1622,36 @@ void setup() {
   Serial.println("Long press: Become Leader");
 }
 
-// Handle cross-fade rendering and blending
-void updateCrossFade() {
-  if (!isFading) return;
-
-  // Update fade progress
-  unsigned long elapsed = millis() - fadeStartTime;
-  fadeAmount = (float)elapsed / (float)FADE_DURATION_MS;
-
-  if (fadeAmount >= 1.0f) {
-    // Fade complete - switch to new pattern
-    fadeAmount = 1.0f;
-    isFading = false;
-    gCurrentPatternNumber = fadeToPattern;
-    // DON'T reset pattern - it's already been rendering during fade!
-    // g_patternShouldReset = true;  // REMOVED - causes abrupt jump
-    Serial.print("Fade complete, now on pattern ");
-    Serial.println(gCurrentPatternNumber);
-  }
-}
-
-// Render current pattern (with cross-fade support)
-void renderPattern() {
-  if (isFading) {
-    // CROSS-FADE MODE: Render both patterns and blend
-
-    // Render old pattern to leds[]
-    uint8_t savedPattern = gCurrentPatternNumber;
-    gCurrentPatternNumber = fadeFromPattern;
-    gPatterns[fadeFromPattern]();
-
-    // Save old pattern result
-    CRGB ledsOld[NUM_LEDS];
-    memcpy(ledsOld, leds, sizeof(leds));
-
-    // Render new pattern to leds[]
-    gCurrentPatternNumber = fadeToPattern;
-    gPatterns[fadeToPattern]();
-
-    // Blend: leds = (old * (1-fade)) + (new * fade)
-    for (int i = 0; i < NUM_LEDS; i++) {
-      leds[i].r = ((uint16_t)ledsOld[i].r * (uint16_t)((1.0f - fadeAmount) * 255)) / 255 +
-                  ((uint16_t)leds[i].r * (uint16_t)(fadeAmount * 255)) / 255;
-      leds[i].g = ((uint16_t)ledsOld[i].g * (uint16_t)((1.0f - fadeAmount) * 255)) / 255 +
-                  ((uint16_t)leds[i].g * (uint16_t)(fadeAmount * 255)) / 255;
-      leds[i].b = ((uint16_t)ledsOld[i].b * (uint16_t)((1.0f - fadeAmount) * 255)) / 255 +
-                  ((uint16_t)leds[i].b * (uint16_t)(fadeAmount * 255)) / 255;
-    }
-
-    // Restore pattern number (in case it's used elsewhere)
-    gCurrentPatternNumber = savedPattern;
+// Render one frame and hand it to the output stage: our own patterns, or
+// (leaderPacket) a parametric leader's state
+void renderFrame(unsigned long now, const ParamSyncPacket* leaderPacket) {
+  unsigned long renderStart = micros();
+#if PIPELINED_OUTPUT
+  // Render straight into the pipeline's back buffer; the output task shows it
+  PipelineFrame& frame = framePipeline.back();
+  if (leaderPacket) {
+    renderFromState(leaderPacket->state, frame.pixels);
+    frame.presentAt = leaderPacket->presentAt;
+    frame.brightness = leaderPacket->brightness;
+  } else {
+    renderPattern(frame.pixels, &frame.state);
+  }
+  frame.fromLeader = leaderPacket != nullptr;
+  frame.direct = false;
+  frame.renderedAt = micros();
+  latencyRecord(LAT_RENDER, frame.renderedAt - renderStart);
+  framePipeline.publish();
+  xTaskNotifyGive(outputTaskHandle);
+#else
+  if (leaderPacket) {
+    renderFromState(leaderPacket->state);
+    FastLED.setBrightness(leaderPacket->brightness);
   } else {
-    // NORMAL MODE: Just render current pattern
-    gPatterns[gCurrentPatternNumber]();
+    renderPattern(leds, &presentedState);
   }
+  latencyRecord(LAT_RENDER, micros() - renderStart);
+  presentFrame(now);
+#endif
 }
 
 void loop() {
@@ -1627,10 +1659,36 @@ void loop() {
   static unsigned long lastFrameTime = 0;
   unsigned long currentTime = millis();
 
+#if SCHEDULED_PRESENTATION
+  // Answer clock requests every pass, not every frame: turnaround is
+  // measured (t3 - t2), but a shorter one keeps the estimate tighter
+  PendingClockRequest pending;
+  while (clockRequests.pop(pending)) {
+    ClockSyncPacket reply;
+    if (currentMode == MODE_NORMAL_LEADER || currentMode == MODE_MUSIC_LEADER) {
+      clockSyncMakeReply(pending.packet, pending.receivedAt, reply);
+    } else if (meshIsDownstream(pending.packet.requester)) {
+      clockSyncMakeRelayReply(pending.packet, pending.receivedAt, pending.leaderReceivedAt, reply);
+    } else {
+      continue;  // Someone else's upstream answers it
+    }
+    // Straight to the radio: t3 is stamped for now, not after a queue wait
+    txQueueSendNow((uint8_t*)&reply, sizeof(reply));
+  }
+#endif
+
+  // Callback log records: every pass, as much as the UART takes without blocking
+  eventLogDrain();
+#if !PIPELINED_OUTPUT
+  showFollowerFrame();  // No output task: frames from the receive callback go out here
+#endif
+
   if (currentTime - lastFrameTime < 16) {
     yield();
     return;  // Skip this iteration, come back in next loop
   }
+  // A beat waits half a frame on average for its frame slot
+  if (lastFrameTime != 0) latencyRecord(LAT_CADENCE, (currentTime - lastFrameTime) * 500);
   lastFrameTime = currentTime;
 
   // Reset watchdog timer
@@ -1639,6 +1697,24 @@ void loop() {
   M5.update();
   handleButtons();
 
+  // Serial 'L': measure and print the beat latency budget; 'S': follower sync counters;
+  // 'T': transmit queue depth and send latency; 'M': relay mesh and per-hop latency;
+  // 'R': leader broadcast rate, target vs what the channel sustains; 'E': leader election
+  if (Serial.available()) {
+    switch (toupper(Serial.read())) {
+      case 'L': latencyStartCalibration(); break;
+      case 'S': printSyncStats(); break;
+      case 'T': txQueuePrintReport(); break;
+      case 'M': meshPrintReport(); break;
+      case 'R': broadcastRatePrintReport(); break;
+      case 'E': electionPrintReport(); break;
+#if SCHEDULED_PRESENTATION
+      case 'C': printClockReport(); break;
+#endif
+    }
+  }
+  latencyUpdate();
+
   // Fluffy mode processing - completely separate from ESP-NOW
   if (currentMode == MODE_FLUFFY) {
     checkFluffyWiFi();
@@ -1654,73 +1730,62 @@ void loop() {
 
   // Check for leader timeout
   checkLeaderTimeout();
+  // Beacons and relay election; leaders' own frames are their beacon
+  if (currentMode == MODE_NORMAL || currentMode == MODE_MUSIC) {
+    meshUpdate(leaderDataActive && !electionSeeking(), selfMac, electionLeaderPinned());
+  }
+  // Leader election: leaders heartbeat, followers take over from a quiet one
+  bool leading = currentMode == MODE_NORMAL_LEADER || currentMode == MODE_MUSIC_LEADER;
+  switch (electionUpdate(leading, !leading, leaderDataActive ? followedLeader : nullptr, lastLeaderMessage)) {
+    case ELECTION_TAKE_OVER:
+      takeOverAsLeader();
+      break;
+    case ELECTION_STEP_DOWN:
+      if (currentMode == MODE_MUSIC_LEADER) {
+        switchToMusicMode();
+      } else {
+        switchToNormalMode();
+      }
+      break;
+    default:
+      break;
+  }
 
   // Update cross-fade progress
   updateCrossFade();
 
   // If we're following a leader, don't run our own patterns
   if (leaderDataActive && (currentMode == MODE_NORMAL || currentMode == MODE_MUSIC)) {
-    // Just update display and return - LEDs controlled by leader
+    // Parametric leader: render its newest state with our pattern code.
+    // Otherwise LEDs are driven from the receive callback.
+    if (paramInbox.acquire()) {
+      renderFrame(currentTime, &paramInbox.front());
+    }
+#if SCHEDULED_PRESENTATION
+    static unsigned long lastClockRequest = 0;
+    if (currentTime - lastClockRequest >= CLOCK_SYNC_INTERVAL_MS) {
+      ClockSyncPacket request;
+      clockSyncMakeRequest(request, selfMac);
+      txQueueSendNow((uint8_t*)&request, sizeof(request));
+      lastClockRequest = currentTime;
+    }
+#endif
     if (currentTime - lastDisplayUpdate > 200) {
       updateDisplay();
       lastDisplayUpdate = currentTime;
     }
-    return;
+    if (!recoveryLocal()) return;
+    // Stuck (recovery.h): our own patterns until the leader's frames come back
   }
 
-  // Run patterns based on mode
+  // Music mode - update audio before rendering
   if (currentMode == MODE_MUSIC || currentMode == MODE_MUSIC_LEADER) {
-    // Music mode - update audio and run pattern (with cross-fade support)
     updateAudioLevel();
-    FastLED.setBrightness(BRIGHTNESS);  // Keep global brightness constant - patterns handle beat scaling
-    renderPattern();
-
-    // If leader: broadcast FIRST, then wait for followers to receive/process, then show
-    if (currentMode == MODE_MUSIC_LEADER) {
-      static unsigned long lastSkipLog = 0;
-      if (currentTime - lastBroadcast > BROADCAST_INTERVAL_MS) {
-        broadcastLEDData();
-        lastBroadcast = currentTime;
-        // NO MORE BLOCKING DELAY! Use non-blocking check below instead
-      } else if (currentTime - lastSkipLog > 5000) {
-        Serial.print("[LEADER] Skipping broadcast (too soon): ");
-        Serial.print(currentTime - lastBroadcast);
-        Serial.println("ms since last");
-        lastSkipLog = currentTime;
-      }
-      // Non-blocking wait: only show if enough time has passed since last broadcast
-      if (currentTime - lastBroadcast >= LEADER_DELAY_MS) {
-        FastLED.show();
-      }
-    } else {
-      FastLED.show();  // Non-leader: show immediately
-    }
-  } else {
-    // Normal mode - run pattern (with cross-fade support)
-    FastLED.setBrightness(BRIGHTNESS);
-    renderPattern();
-
-    // If leader: broadcast FIRST, then wait for followers to receive/process, then show
-    if (currentMode == MODE_NORMAL_LEADER) {
-      static unsigned long lastSkipLog = 0;
-      if (currentTime - lastBroadcast > BROADCAST_INTERVAL_MS) {
-        broadcastLEDData();
-        lastBroadcast = currentTime;
-        // NO MORE BLOCKING DELAY! Use non-blocking check below instead
-      } else if (currentTime - lastSkipLog > 5000) {
-        Serial.print("[LEADER] Skipping broadcast (too soon): ");
-        Serial.print(currentTime - lastBroadcast);
-        Serial.println("ms since last");
-        lastSkipLog = currentTime;
-      }
-      // Non-blocking wait: only show if enough time has passed since last broadcast
-      if (currentTime - lastBroadcast >= LEADER_DELAY_MS) {
-        FastLED.show();
-      }
-    } else {
-      FastLED.show();  // Non-leader: show immediately
-    }
   }
+  FastLED.setBrightness(BRIGHTNESS);  // Keep global brightness constant - output stage handles beat scaling
+
+  // Run pattern (with cross-fade support)
+  renderFrame(currentTime, nullptr);
   
   // Update display periodically
   if (currentTime - lastDisplayUpdate > 200) {
@@ -1739,257 +1804,3 @@ void loop() {
 
   yield();
 }
-
-// ===== LARRY PATTERN IMPLEMENTATIONS =====
-// Four beat-reactive patterns from larry_test_m5stack
-// All patterns apply gamma correction for rich colors and dramatic dark gaps
-
-// Pattern 0: Solid Color
-// Music mode: Beat triggers smooth fade to new random color
-// Normal mode: Slowly fades through rainbow colors
-void solidColor() {
-  static CRGB currentColor = CRGB(255, 0, 0);
-  static bool lastBeatState = false;
-  static int currentHue = 0;   // Current hue position
-  static int targetHue = 0;    // Target hue (for smooth transitions)
-
-  // Check if pattern should reset (freshly selected)
-  if (g_patternShouldReset) {
-    currentHue = random(1536);
-    targetHue = currentHue;
-    lastBeatState = false;
-    g_patternShouldReset = false;
-  }
-
-  // Check mode (not audioDetected, which can be true in any mode)
-  if (currentMode == MODE_MUSIC || currentMode == MODE_MUSIC_LEADER) {
-    // MUSIC MODE: Beat triggers new target color, then smoothly fade to it
-    if (beatDetected && !lastBeatState) {
-      targetHue = random(1536);  // Set new target color on beat
-    }
-    lastBeatState = beatDetected;
-
-    // Smoothly interpolate current hue toward target hue
-    if (currentHue != targetHue) {
-      int diff = targetHue - currentHue;
-      // Handle wrapping (shortest path around color wheel)
-      if (diff > 768) diff -= 1536;
-      if (diff < -768) diff += 1536;
-
-      // Move VERY slowly toward target (about 1-2% per frame for smooth fade)
-      // At 60 FPS, this takes about 1 second to complete the transition
-      int step = diff / 60;
-      if (step == 0) step = (diff > 0) ? 1 : -1;  // Minimum step
-
-      currentHue += step;
-      if (currentHue < 0) currentHue += 1536;
-      if (currentHue >= 1536) currentHue -= 1536;
-    }
-  } else {
-    // NORMAL MODE: Slowly fade through rainbow colors
-    currentHue += 2;  // Slow continuous rotation
-    if (currentHue >= 1536) currentHue -= 1536;
-    targetHue = currentHue;  // Keep in sync
-  }
-
-  // Convert current hue to RGB
-  byte r, g, b;
-  hsvToRgb(currentHue, 255, 255, &r, &g, &b);
-
-  // Apply beat brightness scaling in music mode (BEFORE gamma!)
-  float beatScale = getMusicBeatBrightnessScale();
-  r = (byte)(r * beatScale);
-  g = (byte)(g * beatScale);
-  b = (byte)(b * beatScale);
-
-  // Apply gamma correction (MUST be last!)
-  r = gammaTable[r];
-  g = gammaTable[g];
-  b = gammaTable[b];
-  currentColor = CRGB(r, g, b);
-
-  // Fill all LEDs with processed color
-  for (int i = 0; i < NUM_LEDS; i++) {
-    leds[i] = currentColor;
-  }
-}
-
-// Pattern 1: Rainbow Larry
-// Smooth rotating color wheel - dramatic beat-reactive speed boost
-void rainbowLarry() {
-  static int colorOffset = 0;
-  static int totalHueSpan = (1 + random(4 * ((NUM_LEDS + 31) / 32))) * 1536;
-  static int baseIncrement = 4 + random(abs(totalHueSpan) / NUM_LEDS);
-
-  // Check if pattern should reset (freshly selected)
-  if (g_patternShouldReset) {
-    colorOffset = 0;
-    totalHueSpan = (1 + random(4 * ((NUM_LEDS + 31) / 32))) * 1536;
-    // Medium base speed: 4-8 (will be boosted to 10-20 on beats)
-    baseIncrement = 4 + random(5);
-    if (random(2) == 0) totalHueSpan = -totalHueSpan;
-    if (random(2) == 0) baseIncrement = -baseIncrement;
-    g_patternShouldReset = false;
-  }
-
-  // Apply speed envelope for dramatic beat-reactive speed boost (1.0x to 3.5x)
-  int increment = (int)(baseIncrement * getSpeedMultiplier());
-
-  // Get beat brightness scale for music mode
-  float beatScale = getMusicBeatBrightnessScale();
-
-  // Render rainbow across all LEDs
-  for (int i = 0; i < NUM_LEDS; i++) {
-    int hue = colorOffset + totalHueSpan * i / NUM_LEDS;
-    byte r, g, b;
-    hsvToRgb(hue, 255, 255, &r, &g, &b);
-
-    // Apply beat brightness in music mode (BEFORE gamma!)
-    r = (byte)(r * beatScale);
-    g = (byte)(g * beatScale);
-    b = (byte)(b * beatScale);
-
-    // Apply gamma correction (MUST be last!)
-    r = gammaTable[r];
-    g = gammaTable[g];
-    b = gammaTable[b];
-    leds[i] = CRGB(r, g, b);
-  }
-
-  colorOffset += increment;
-}
-
-// Pattern 2: Sine Wave Chase
-// Color waves with dramatic dark gaps - dramatic beat-reactive speed boost
-void sineWaveChase() {
-  static int baseHue = random(1536);
-  static int waveSpan = (1 + random(4 * ((NUM_LEDS + 31) / 32))) * 720;
-  static int baseIncrement = 4 + random(20);
-  static int waveOffset = 0;
-
-  // Check if pattern should reset (freshly selected)
-  if (g_patternShouldReset) {
-    baseHue = random(1536);
-    waveSpan = (1 + random(4 * ((NUM_LEDS + 31) / 32))) * 720;
-    // Medium base speed: 3-6 (will be boosted to 18-36 on beats with 6x multiplier!)
-    baseIncrement = 3 + random(4);
-    if (random(2) == 0) baseIncrement = -baseIncrement;
-    waveOffset = 0;
-    g_patternShouldReset = false;
-  }
-
-  // Apply EXTRA dramatic speed boost for sine wave pattern
-  // Sine wave gets 2x extra multiplier: (1.0x to 3.5x) * 2.0 = (1.0x to 6x)!
-  float speedMult = getSpeedMultiplier();
-  if (speedMult > 1.0f) {
-    speedMult = 1.0f + (speedMult - 1.0f) * 2.0f;  // Amplify the boost by 2x
-  }
-  int increment = (int)(baseIncrement * speedMult);
-
-  // Get beat brightness scale for music mode
-  float beatScale = getMusicBeatBrightnessScale();
-
-  // Render sine wave pattern
-  for (int i = 0; i < NUM_LEDS; i++) {
-    // Calculate sine value using fixed-point math (-127 to +127)
-    signed char sineValue = fixSin(waveOffset + waveSpan * i / NUM_LEDS);
-
-    byte r, g, b;
-    if (sineValue >= 0) {
-      // Positive sine: vary saturation (254 - foo*2), full brightness
-      byte sat = 254 - (sineValue * 2);
-      hsvToRgb(baseHue, sat, 255, &r, &g, &b);
-    } else {
-      // Negative sine: full saturation, vary brightness (254 + foo*2)
-      // THIS IS WHERE THE DARK GAPS COME FROM!
-      byte val = 254 + sineValue * 2;  // sineValue is negative, so this reduces brightness
-      hsvToRgb(baseHue, 255, val, &r, &g, &b);
-    }
-
-    // Apply beat brightness in music mode (BEFORE gamma!)
-    r = (byte)(r * beatScale);
-    g = (byte)(g * beatScale);
-    b = (byte)(b * beatScale);
-
-    // Apply gamma correction (critical for dark gaps!)
-    r = gammaTable[r];
-    g = gammaTable[g];
-    b = gammaTable[b];
-    leds[i] = CRGB(r, g, b);
-  }
-
-  waveOffset += increment;
-}
-
-// Pattern 3: Wavy Flag
-// Animated red/white/blue patriotic pattern - BPM-synced flag waves
-void wavyFlag() {
-  // Flag pattern data
-  static const byte flagTable[] = {
-    160, 0, 0,    255, 255, 255,  160, 0, 0,    255, 255, 255,  // Red, White, Red, White
-    160, 0, 0,    255, 255, 255,  160, 0, 0,                     // Red, White, Red
-    0, 0, 100,    255, 255, 255,  0, 0, 100,    255, 255, 255,  // Blue, White, Blue, White
-    0, 0, 100,    255, 255, 255,  0, 0, 100,                     // Blue, White, Blue
-    255, 255, 255, 160, 0, 0,     255, 255, 255, 160, 0, 0,      // White, Red, White, Red
-    255, 255, 255, 160, 0, 0                                     // White, Red
-  };
-
-  static int waveLength = 720 + random(720);
-  static int baseIncrement = 4 + random(10);
-  static int stripeWidth = 200 + random(200);
-  static int wavePhase = 0;
-
-  // Check if pattern should reset (freshly selected)
-  if (g_patternShouldReset) {
-    waveLength = 720 + random(720);
-    // Slower base speed: 1-3 (will be boosted to 2.5-7.5 on beats)
-    baseIncrement = 1 + random(3);
-    stripeWidth = 200 + random(200);
-    wavePhase = 0;
-    g_patternShouldReset = false;
-  }
-
-  // Apply speed envelope for dramatic beat-reactive speed boost (1.0x to 3.5x)
-  int increment = (int)(baseIncrement * getSpeedMultiplier());
-
-  // Get beat brightness scale for music mode
-  float beatScale = getMusicBeatBrightnessScale();
-
-  // Calculate total arc length with wave deformation
-  long sum = 0;
-  for (int i = 0; i < NUM_LEDS - 1; i++) {
-    sum += stripeWidth + fixCos(wavePhase + waveLength * i / NUM_LEDS);
-  }
-
-  // Render wavy flag pattern
-  long s = 0;
-  for (int i = 0; i < NUM_LEDS; i++) {
-    // Calculate position along flag pattern with wave deformation
-    long x = 256L * ((sizeof(flagTable) / 3) - 1) * s / sum;
-    int idx1 = (x >> 8) * 3;
-    int idx2 = ((x >> 8) + 1) * 3;
-    byte b = (x & 255) + 1;
-    byte a = 257 - b;
-
-    // Interpolate between flag colors
-    byte r = ((flagTable[idx1] * a) + (flagTable[idx2] * b)) >> 8;
-    byte g = ((flagTable[idx1 + 1] * a) + (flagTable[idx2 + 1] * b)) >> 8;
-    byte bl = ((flagTable[idx1 + 2] * a) + (flagTable[idx2 + 2] * b)) >> 8;
-
-    // Apply beat brightness in music mode (BEFORE gamma!)
-    r = (byte)(r * beatScale);
-    g = (byte)(g * beatScale);
-    bl = (byte)(bl * beatScale);
-
-    // Apply gamma correction (MUST be last!)
-    r = gammaTable[r];
-    g = gammaTable[g];
-    bl = gammaTable[bl];
-    leds[i] = CRGB(r, g, bl);
-
-    s += stripeWidth + fixCos(wavePhase + waveLength * i / NUM_LEDS);
-  }
-
-  wavePhase += increment;
-  if (wavePhase >= 720) wavePhase -= 720;
-}
\ No newline at end of file
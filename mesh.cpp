@@ -0,0 +1,397 @@
+#include "mesh.h"
+#include "frame_codec.h"
+#include "clock_sync.h"
+#include "election.h"
+#include "spsc_queue.h"
+#include "tx_queue.h"
+#include <atomic>
+
+bool isMeshBeacon(const uint8_t* data, int len) {
+  return len == (int)sizeof(MeshBeacon) && data[0] == MESH_MAGIC && data[1] == MESH_BEACON;
+}
+
+// ===== RECEIVE SIDE (WiFi task) =====
+// Chunks seen of the last few frames of one stream, by frame ID
+struct SeenFrame {
+  bool used;
+  uint8_t seq;
+  uint32_t at;      // millis() of the first chunk
+  uint64_t chunks;  // Encoded: data chunks in bits 0-31, parity groups 32-63
+};
+
+enum SeenStream { SEEN_STATE, SEEN_ENCODED, SEEN_V1, SEEN_HEARTBEAT, SEEN_STREAMS };
+
+// Per-hop arrival: how long before its presentation time a packet arrived
+struct HopLatency {
+  uint32_t packets;
+  int64_t leadSum;  // us, leader clock
+  int32_t leadMin;
+};
+
+static SeenFrame seen[SEEN_STREAMS][MESH_SEEN_FRAMES];
+static uint8_t routeHops = MESH_NO_ROUTE;
+static uint8_t upstream[6];
+static uint8_t routeLeader[6];
+static uint32_t upstreamAt = 0;  // millis() of the last packet from upstream at routeHops
+static std::atomic<bool> relaying{false};
+
+// Written by the WiFi task, read racily for beacons and printing
+static uint32_t forwarded = 0, duplicates = 0, oversize = 0;
+static HopLatency hopLatency[MESH_MAX_HOPS + 1];
+
+// Beacons: receive callback -> loop(), which owns the neighbor table
+struct BeaconRx {
+  uint8_t mac[6];
+  MeshBeacon beacon;
+};
+static SpscQueue<BeaconRx, 8> beacons;
+
+void meshReset() {
+  memset(seen, 0, sizeof(seen));
+  routeHops = MESH_NO_ROUTE;
+}
+
+bool meshUnwrap(const uint8_t* mac, const uint8_t*& data, int& len, MeshArrival& arrival) {
+  arrival.from = mac;
+  arrival.origin = mac;
+  arrival.hops = 0;
+  arrival.ttl = MESH_MAX_HOPS;
+  if (len < 2 || data[0] != MESH_MAGIC || (data[1] != MESH_RELAYED && data[1] != MESH_RELAYED_PADDED)) return true;
+
+  const MeshRelayHeader* h = (const MeshRelayHeader*)data;
+  int pad = h->type == MESH_RELAYED_PADDED ? 1 : 0;
+  if (len <= (int)sizeof(MeshRelayHeader) + pad || h->hops == 0 || h->hops > MESH_MAX_HOPS) return false;
+  arrival.origin = h->origin;
+  arrival.hops = h->hops;
+  arrival.ttl = h->ttl;
+  data += sizeof(MeshRelayHeader);
+  len -= sizeof(MeshRelayHeader) + pad;
+  return true;
+}
+
+// Stream, frame ID and chunk bit of a sync packet; false if it has none
+static bool chunkKey(const uint8_t* data, SeenStream* stream, uint8_t* seq, uint8_t* bit) {
+  if (data[0] == ENCODED_MAGIC) {
+    const EncodedChunkHeader* h = (const EncodedChunkHeader*)data;
+    if (h->chunkIndex >= 32) return false;
+    *stream = SEEN_ENCODED;
+    *seq = h->frameSeq;
+    *bit = (h->flags & CHUNK_FLAG_PARITY) ? 32 + h->chunkIndex : h->chunkIndex;
+  } else if (data[0] == ELECTION_MAGIC) {
+    *stream = SEEN_HEARTBEAT;
+    *seq = ((const ElectionHeartbeat*)data)->seq;
+    *bit = 0;
+  } else if (data[0] == PARAM_MAGIC) {
+    *stream = SEEN_STATE;
+    *seq = ((const ParamSyncPacket*)data)->frameSeq;
+    *bit = 0;
+  } else {
+    *stream = SEEN_V1;
+    *seq = data[2];  // LEDSync sequenceNum
+    *bit = data[0] / V1_LEDS_PER_PACKET;
+  }
+  return true;
+}
+
+// Marks the chunk seen; false if it already was
+static bool firstSighting(SeenStream stream, uint8_t seq, uint8_t bit) {
+  SeenFrame& f = seen[stream][seq % MESH_SEEN_FRAMES];
+  uint32_t now = millis();
+  if (!f.used || f.seq != seq || now - f.at > MESH_SEEN_MS) {
+    f.used = true;
+    f.seq = seq;
+    f.at = now;
+    f.chunks = 0;
+  }
+  uint64_t mask = 1ULL << bit;
+  if (f.chunks & mask) return false;
+  f.chunks |= mask;
+  return true;
+}
+
+// Keep the upstream we have unless a shorter route shows up or it went quiet
+static void noteRoute(const MeshArrival& arrival) {
+  uint32_t now = millis();
+  if (routeHops == MESH_NO_ROUTE || arrival.hops < routeHops || now - upstreamAt > MESH_ROUTE_TIMEOUT_MS) {
+    routeHops = arrival.hops;
+    memcpy(upstream, arrival.from, 6);
+    upstreamAt = now;
+  } else if (arrival.hops == routeHops && memcmp(arrival.from, upstream, 6) == 0) {
+    upstreamAt = now;
+  }
+}
+
+static void noteHopLatency(const uint8_t* data, const MeshArrival& arrival) {
+  uint32_t presentAt;
+  if (data[0] == ENCODED_MAGIC) presentAt = ((const EncodedChunkHeader*)data)->presentAt;
+  else if (data[0] == PARAM_MAGIC) presentAt = ((const ParamSyncPacket*)data)->presentAt;
+  else return;  // v1 packets carry no time
+
+  uint32_t leaderNow;
+  if (!clockSyncLocalToLeader(arrival.receivedAt, &leaderNow)) return;
+  int32_t lead = (int32_t)(presentAt - leaderNow);
+  HopLatency& h = hopLatency[arrival.hops];
+  if (h.packets == 0 || lead < h.leadMin) h.leadMin = lead;
+  h.leadSum += lead;
+  h.packets++;
+}
+
+int meshWrap(const uint8_t* data, int len, const MeshArrival& arrival, uint8_t* packet) {
+  // Old followers take any packet of exactly V1_PACKET_SIZE for LEDSync
+  // pixels, so a copy that would come out at that size gets a pad byte
+  int relayedLen = len + (int)sizeof(MeshRelayHeader);
+  bool padded = relayedLen == V1_PACKET_SIZE;
+  if (relayedLen + (padded ? 1 : 0) > ESPNOW_MAX_PACKET) return 0;
+  MeshRelayHeader* h = (MeshRelayHeader*)packet;
+  h->magic = MESH_MAGIC;
+  h->type = padded ? MESH_RELAYED_PADDED : MESH_RELAYED;
+  h->hops = arrival.hops + 1;
+  h->ttl = arrival.ttl - 1;
+  memcpy(h->origin, arrival.origin, 6);
+  memcpy(packet + sizeof(MeshRelayHeader), data, len);
+  if (padded) packet[relayedLen++] = 0;
+  return relayedLen;
+}
+
+static void forward(const uint8_t* data, int len, const MeshArrival& arrival) {
+  uint8_t packet[ESPNOW_MAX_PACKET];
+  int relayedLen = meshWrap(data, len, arrival, packet);
+  if (relayedLen == 0) {
+    oversize++;
+    return;
+  }
+  txQueueSend(packet, relayedLen);
+  forwarded++;
+}
+
+bool meshOnSyncPacket(const uint8_t* data, int len, const MeshArrival& arrival) {
+  memcpy(routeLeader, arrival.origin, 6);
+  noteRoute(arrival);
+  noteHopLatency(data, arrival);
+
+  SeenStream stream;
+  uint8_t seq, bit;
+  if (chunkKey(data, &stream, &seq, &bit) && !firstSighting(stream, seq, bit)) {
+    duplicates++;
+    return false;
+  }
+  // Before decoding: the next hop waits on us, not on our strip
+  if (relaying.load(std::memory_order_relaxed) && arrival.ttl > 0) forward(data, len, arrival);
+  return true;
+}
+
+void meshOnBeacon(const uint8_t* mac, const uint8_t* data) {
+  BeaconRx rx;
+  memcpy(rx.mac, mac, 6);
+  memcpy(&rx.beacon, data, sizeof(rx.beacon));
+  beacons.push(rx);  // Full: this one is dropped, the next beacon comes in 500ms
+}
+
+const uint8_t* meshUpstream() {
+  return upstream;
+}
+
+bool meshRelaying() {
+  return relaying.load(std::memory_order_relaxed);
+}
+
+// ===== NEIGHBORS AND ELECTION (loop) =====
+struct Neighbor {
+  bool used;
+  uint8_t mac[6];
+  uint32_t heardAt;  // millis()
+  MeshBeacon beacon;
+};
+
+static Neighbor neighbors[MESH_NEIGHBORS];
+static uint8_t selfMac[6];
+static uint8_t myHops = MESH_NO_ROUTE;
+static uint8_t myDependents = 0, neighborCount = 0;
+static unsigned long lastBeacon = 0, lastElection = 0, electionPeriod = MESH_ELECTION_MS;
+static unsigned long demandSince = 0, stepUpDelay = 0;  // Neighbors further out: since when, and our backoff
+
+static bool alive(const Neighbor& n, uint32_t now) {
+  return n.used && now - n.heardAt <= MESH_NEIGHBOR_TIMEOUT_MS;
+}
+
+// Update the sender's entry, else take a free or expired slot, else the stalest
+static void storeBeacon(const BeaconRx& rx, uint32_t now) {
+  Neighbor* slot = nullptr;
+  for (Neighbor& n : neighbors) {
+    if (n.used && memcmp(n.mac, rx.mac, 6) == 0) {
+      slot = &n;
+      break;
+    }
+  }
+  for (Neighbor& n : neighbors) {
+    if (slot) break;
+    if (!alive(n, now)) slot = &n;
+  }
+  if (!slot) {
+    slot = &neighbors[0];
+    for (Neighbor& n : neighbors) {
+      if ((int32_t)(n.heardAt - slot->heardAt) < 0) slot = &n;
+    }
+  }
+  slot->used = true;
+  memcpy(slot->mac, rx.mac, 6);
+  slot->heardAt = now;
+  slot->beacon = rx.beacon;
+}
+
+static bool namesUs(const Neighbor& n) {
+  return n.beacon.hops != MESH_NO_ROUTE && memcmp(n.beacon.upstream, selfMac, 6) == 0;
+}
+
+static void elect(bool following, uint32_t now) {
+  uint8_t count = 0, dependents = 0, further = 0;
+  for (const Neighbor& n : neighbors) {
+    if (!alive(n, now)) continue;
+    count++;
+    if (namesUs(n)) dependents++;
+    else if (n.beacon.hops > myHops + 1) further++;  // Lost, or reached the long way: we'd bring it closer
+  }
+  neighborCount = count;
+  myDependents = dependents;
+
+  bool was = relaying.load(std::memory_order_relaxed);
+  bool relay;
+  if (!MESH_RELAY || !following || myHops >= MESH_MAX_HOPS) {
+    relay = false;
+  } else if (dependents > 0 || (was && further > 0)) {
+    relay = true;
+  } else if (further == 0) {
+    relay = false;
+    demandSince = 0;
+  } else {
+    if (demandSince == 0) {
+      demandSince = now;
+      stepUpDelay = random(MESH_STEP_UP_MAX_MS);
+    }
+    relay = now - demandSince >= stepUpDelay;
+  }
+  if (relay == was) return;
+
+  relaying.store(relay, std::memory_order_relaxed);
+  demandSince = 0;
+  if (relay) {
+    Serial.printf("[MESH] Relaying for hop %u (%u of %u neighbors further out)\n", (unsigned)(myHops + 1),
+                  (unsigned)further, (unsigned)count);
+  } else {
+    Serial.println("[MESH] Stopped relaying (nobody depends on us)");
+  }
+}
+
+void meshUpdate(bool following, const uint8_t self[6], bool leaderPinned) {
+  memcpy(selfMac, self, 6);
+  uint32_t now = millis();
+  BeaconRx rx;
+  while (beacons.pop(rx)) storeBeacon(rx, now);
+
+  // Racy read of the WiFi task's route: a torn hop count lasts one beacon
+  myHops = following ? routeHops : MESH_NO_ROUTE;
+
+  if (now - lastElection >= electionPeriod) {
+    elect(following, now);
+    lastElection = now;
+    electionPeriod = MESH_ELECTION_MS + random(MESH_ELECTION_MS / 4);  // Neighbors don't decide in lockstep
+  }
+
+  if (now - lastBeacon >= MESH_BEACON_INTERVAL_MS) {
+    MeshBeacon b;
+    b.magic = MESH_MAGIC;
+    b.type = MESH_BEACON;
+    b.hops = myHops;
+    b.flags = leaderPinned ? MESH_BEACON_LEADER_PINNED : 0;
+    memcpy(b.upstream, upstream, 6);
+    memcpy(b.leader, routeLeader, 6);
+    txQueueSend((uint8_t*)&b, sizeof(b));
+    lastBeacon = now;
+  }
+}
+
+bool meshIsDownstream(const uint8_t mac[6]) {
+  uint32_t now = millis();
+  for (const Neighbor& n : neighbors) {
+    if (alive(n, now) && memcmp(n.mac, mac, 6) == 0) return namesUs(n);
+  }
+  return false;
+}
+
+uint8_t meshNeighborsAhead() {
+  uint32_t now = millis();
+  uint8_t ahead = 0;
+  for (const Neighbor& n : neighbors) {
+    if (!alive(n, now)) continue;
+    if (n.beacon.hops < myHops || (n.beacon.hops == myHops && memcmp(n.mac, selfMac, 6) > 0)) ahead++;
+  }
+  return ahead;
+}
+
+bool meshNeighborFollowsOther(const uint8_t* lost) {
+  uint32_t now = millis();
+  for (const Neighbor& n : neighbors) {
+    if (!alive(n, now) || n.beacon.hops == MESH_NO_ROUTE) continue;
+    if (!lost || memcmp(n.beacon.leader, lost, 6) != 0) return true;
+  }
+  return false;
+}
+
+bool meshNeighborFollowsAbove(const uint8_t leader[6], bool pinned, const uint8_t* ignore, uint8_t above[6]) {
+  uint32_t now = millis();
+  for (const Neighbor& n : neighbors) {
+    if (!alive(n, now) || n.beacon.hops == MESH_NO_ROUTE) continue;
+    if (memcmp(n.beacon.leader, leader, 6) == 0 || (ignore && memcmp(n.beacon.leader, ignore, 6) == 0)) continue;
+    if (electionOutranks(n.beacon.leader, n.beacon.flags & MESH_BEACON_LEADER_PINNED, leader, pinned)) {
+      memcpy(above, n.beacon.leader, 6);
+      return true;
+    }
+  }
+  return false;
+}
+
+// ===== REPORT =====
+MeshStats meshStats() {
+  MeshStats s;
+  s.hops = myHops;
+  s.relaying = relaying.load(std::memory_order_relaxed);
+  s.neighbors = neighborCount;
+  s.dependents = myDependents;
+  s.forwarded = forwarded;
+  s.duplicates = duplicates;
+  s.oversize = oversize;
+  return s;
+}
+
+void meshPrintReport() {
+  MeshStats s = meshStats();
+  if (s.hops == MESH_NO_ROUTE) {
+    Serial.printf("[MESH] no route to a leader, %u neighbors\n", (unsigned)s.neighbors);
+  } else {
+    Serial.printf("[MESH] hop %u via %02X:%02X:%02X:%02X:%02X:%02X, %s, %u neighbors, %u depending on us\n",
+                  (unsigned)s.hops, upstream[0], upstream[1], upstream[2], upstream[3], upstream[4], upstream[5],
+                  s.relaying ? "relaying" : "not relaying", (unsigned)s.neighbors, (unsigned)s.dependents);
+  }
+  Serial.printf("[MESH] %lu forwarded, %lu duplicates dropped, %lu too long to relay\n", (unsigned long)s.forwarded,
+                (unsigned long)s.duplicates, (unsigned long)s.oversize);
+
+  // Per hop: how long before presentation copies arrived; the drop from one
+  // hop to the next is that hop's latency
+  int32_t previousAvg = 0;
+  bool havePrevious = false;
+  for (int hop = 0; hop <= MESH_MAX_HOPS; hop++) {
+    HopLatency h = hopLatency[hop];
+    if (h.packets == 0) {
+      havePrevious = false;
+      continue;
+    }
+    int32_t avg = (int32_t)(h.leadSum / h.packets);
+    Serial.printf("[MESH] hop %d: %lu packets arrived %.1fms before due (min %.1fms)", hop, (unsigned long)h.packets,
+                  avg / 1000.0f, h.leadMin / 1000.0f);
+    if (havePrevious) Serial.printf(", %.1fms after hop %d", (previousAvg - avg) / 1000.0f, hop - 1);
+    Serial.println();
+    previousAvg = avg;
+    havePrevious = true;
+  }
+  memset(hopLatency, 0, sizeof(hopLatency));
+}
@@ -0,0 +1,124 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include "config.h"
+
+// ===== MULTI-HOP RELAY MESH =====
+// One leader's broadcast only reaches so far. Followers in range can relay
+// its sync packets (state, encoded chunks, v1 pixels) to nodes further out:
+// the copy goes out behind a MeshRelayHeader with the leader's MAC, a hop
+// count and a TTL, and every node drops copies of a frame chunk it has
+// already seen (frame ID + chunk index), so each node forwards each chunk
+// at most once and copies die out after MESH_MAX_HOPS.
+//
+// Relay election: every follower beacons its distance from the leader in
+// hops (MESH_NO_ROUTE without one) and the neighbor it takes frames and
+// clock from (its upstream), and the leader it follows. A follower that hears a neighbor further out
+// than its own relays could bring it steps up after a random backoff, and
+// stands down once nobody names it upstream and nobody nearby is that far
+// out any more. Neighbors stick with the first relay that reached them, so
+// of several that stepped up together only the ones in use stay on, and a
+// single-hop installation has no relays at all.
+//
+// Clock: relays answer the clock requests of the nodes they serve, with
+// t2/t3 on the leader's clock as their own fit has it, and fold those
+// nodes' presentation margins into their own requests, so the leader's
+// presentation delay covers the furthest hop.
+//
+// Leader election (election.h) reads the neighbor table too: relays carry
+// the leader's heartbeats, a candidate's rank is how many neighbors are
+// better placed to take over, and a beacon naming another leader tells a
+// leader or a lost node that one is reachable.
+
+#define MESH_MAGIC 0xE8
+#define MESH_NO_ROUTE 0xFF
+#define MESH_MAX_HOPS 4                // TTL of a leader packet: relays it passes through
+#define MESH_BEACON_INTERVAL_MS 500
+#define MESH_NEIGHBOR_TIMEOUT_MS 2000  // Neighbors not heard for 4 beacons are gone
+#define MESH_ROUTE_TIMEOUT_MS 1000     // Upstream silent this long: take the next copy from anyone
+#define MESH_ELECTION_MS 1000          // Relay decision period (plus up to 25% jitter)
+#define MESH_STEP_UP_MAX_MS 2000       // Demand must last a random 0-2s: booting neighbors beacon no
+                                       // route for a moment, and candidates shouldn't all step up at once
+#define MESH_NEIGHBORS 16
+#define MESH_BEACON_LEADER_PINNED 0x01 // Beacon flags: our leader leads by long press
+#define MESH_SEEN_FRAMES 16            // Duplicate suppression window, per stream
+#define MESH_SEEN_MS 250               // Older entries are expired: the leader may have restarted
+
+enum MeshPacketType : uint8_t {
+  MESH_RELAYED = 1,         // MeshRelayHeader + a leader sync packet
+  MESH_BEACON = 2,
+  MESH_RELAYED_PADDED = 3   // ... + one pad byte: never V1_PACKET_SIZE, which old followers take for pixels
+};
+
+struct __attribute__((packed)) MeshRelayHeader {
+  uint8_t magic;      // MESH_MAGIC
+  uint8_t type;       // MESH_RELAYED
+  uint8_t hops;       // Relays this copy passed through, 1 = the first
+  uint8_t ttl;        // Relays it may still pass through
+  uint8_t origin[6];  // Leader MAC
+};
+static_assert(!MESH_RELAY || sizeof(MeshRelayHeader) == MESH_RELAY_OVERHEAD, "MESH_RELAY_OVERHEAD is stale");
+
+struct __attribute__((packed)) MeshBeacon {
+  uint8_t magic;        // MESH_MAGIC
+  uint8_t type;         // MESH_BEACON
+  uint8_t hops;         // 0 = hears the leader, MESH_NO_ROUTE = not following
+  uint8_t flags;        // MESH_BEACON_*
+  uint8_t upstream[6];  // Node our frames and clock come from (leader or relay)
+  uint8_t leader[6];    // Leader we follow
+};
+
+// How a sync packet reached us
+struct MeshArrival {
+  const uint8_t* from;    // Transmitter: the leader or a relay
+  const uint8_t* origin;  // Leader
+  uint8_t hops;           // 0 = straight from the leader
+  uint8_t ttl;
+  uint32_t receivedAt;    // micros()
+};
+
+struct MeshStats {
+  uint8_t hops;          // MESH_NO_ROUTE when not following
+  bool relaying;
+  uint8_t neighbors;
+  uint8_t dependents;
+  uint32_t forwarded;    // Packets relayed
+  uint32_t duplicates;   // Copies dropped: chunk already seen
+  uint32_t oversize;     // Too long to relay (leader built without MESH_RELAY)
+};
+
+bool isMeshBeacon(const uint8_t* data, int len);
+
+// ----- Receive callback (WiFi task) -----
+void meshReset();  // New leader: forget routes and frame IDs
+// Strip a relay header: data/len become the leader's packet. Leader packets
+// pass through as hop 0. false if malformed.
+bool meshUnwrap(const uint8_t* mac, const uint8_t*& data, int& len, MeshArrival& arrival);
+// The copy a relay sends on: header + data into packet (ESPNOW_MAX_PACKET
+// bytes), padded off V1_PACKET_SIZE. Returns its length, 0 if too big.
+int meshWrap(const uint8_t* data, int len, const MeshArrival& arrival, uint8_t* packet);
+// A sync packet of the followed leader that passed its own checks: notes
+// the route and hop latency, relays it if elected. false = duplicate, drop it.
+bool meshOnSyncPacket(const uint8_t* data, int len, const MeshArrival& arrival);
+void meshOnBeacon(const uint8_t* mac, const uint8_t* data);
+const uint8_t* meshUpstream();  // Clock source: accept replies from this node only
+bool meshRelaying();            // Elected: forwarding, and answering clock requests
+
+// ----- loop() -----
+// Beacons and relay election. following: we show a leader's frames.
+void meshUpdate(bool following, const uint8_t self[6], bool leaderPinned);
+bool meshIsDownstream(const uint8_t mac[6]);  // Names us upstream: answer its clock requests
+// Leader election: neighbors better placed to take over than us - closer to
+// the leader, or as close with a higher MAC
+uint8_t meshNeighborsAhead();
+// A neighbor follows a leader other than lost (nullptr: any leader), so one
+// is reachable through relays
+bool meshNeighborFollowsOther(const uint8_t* lost);
+// A neighbor follows a leader that outranks ours (election.h), other than
+// ignore (nullptr: none): *above is it
+bool meshNeighborFollowsAbove(const uint8_t leader[6], bool pinned, const uint8_t* ignore, uint8_t above[6]);
+
+MeshStats meshStats();
+void meshPrintReport();
+
+#endif
@@ -0,0 +1,700 @@
+#include "patterns.h"
+#include "audio.h"
+
+#include <algorithm>
+#include <new>
+
+CRGB leds[NUM_LEDS];
+CRGB ledsNext[NUM_LEDS];  // Second buffer for cross-fading
+
+// ===== GAMMA CORRECTION SYSTEM =====
+// 8-bit gamma correction table for WS2812B LEDs (from original Larry code)
+// Extends black range (0-41 -> pure black) for dramatic dark gaps
+// Creates rich, saturated colors by applying exponential brightness curve
+const byte gammaTable[256] = {
+    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  1,  1,  2,  2,
+    3,  3,  4,  4,  4,  4,  5,  5,  5,  5,  6,  6,  6,  7,  7,  7,
+    8,  8,  8,  9,  9,  9, 10, 10, 11, 11, 11, 12, 12, 13, 13, 14,
+   14, 15, 15, 16, 16, 17, 17, 18, 18, 19, 19, 20, 20, 21, 22, 22,
+   23, 23, 24, 25, 25, 26, 26, 27, 28, 28, 29, 30, 30, 31, 32, 33,
+   33, 34, 35, 35, 36, 37, 38, 38, 39, 40, 41, 42, 42, 43, 44, 45,
+   46, 47, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 56, 57, 58, 59,
+   60, 61, 62, 63, 64, 65, 66, 67, 68, 70, 71, 72, 73, 74, 75, 76,
+   77, 78, 79, 81, 82, 83, 84, 85, 86, 88, 89, 90, 91, 92, 94, 95,
+   96, 97, 99,100,101,102,104,105,106,108,109,110,112,113,114,116,
+  117,119,120,121,123,124,126,127,129,130,132,133,135,136,138,139,
+  141,142,144,145,147,149,150,152,153,155,157,158,160,162,163,165,
+  167,168,170,172,174,175,177,179,181,182,184,186,188,190,192,193,
+  195,197,199,201,203,205,207,209,211,213,215,217,219,221,223,225
+};
+
+// Apply gamma correction to a single RGB value
+CRGB applyGamma(CRGB color) {
+  return CRGB(
+    gammaTable[color.r],
+    gammaTable[color.g],
+    gammaTable[color.b]
+  );
+}
+
+// ===== OUTPUT STAGE =====
+// Beat brightness scale -> gamma, folded into one 256-entry LUT applied in a
+// single pass over the finished frame. The scale is applied BEFORE gamma to
+// preserve dark gaps. The LUT is keyed on the 8.8 fixed-point beat scale and
+// only rebuilt when that changes. White balance is not part of it: frames
+// go on the wire as v1 LEDSync always carried them, and each node's FastLED
+// applies its own COLOR_CORRECTION at show time.
+static byte outputLut[256];
+static uint16_t outputLutScale = 0;  // 0 = not built yet (real scales are >= 5)
+
+static void rebuildOutputLut(uint16_t scale) {
+  for (int v = 0; v < 256; v++) outputLut[v] = gammaTable[(v * scale) >> 8];
+  outputLutScale = scale;
+}
+
+void applyOutputStage(CRGB* frame, int count, float beatScale) {
+  uint16_t scale = (uint16_t)(beatScale * 256.0f + 0.5f);
+  if (scale != outputLutScale) rebuildOutputLut(scale);
+
+  for (int i = 0; i < count; i++) {
+    frame[i].r = outputLut[frame[i].r];
+    frame[i].g = outputLut[frame[i].g];
+    frame[i].b = outputLut[frame[i].b];
+  }
+}
+
+// ===== CROSS-FADE BLEND =====
+// In-place blend: dst = (dst * (256 - amount) + src * amount) >> 8
+// amount is 8.8 fixed point (0 = all dst, 256 = all src). Packs four channel
+// bytes into a 32-bit word and blends the even and odd bytes as two pairs of
+// 16-bit lanes (255 * 256 fits a lane, so nothing carries across), then
+// finishes the tail byte by byte.
+void blendFrames(CRGB* dst, const CRGB* src, uint16_t amount, int count) {
+  if (amount == 0) return;
+  if (amount >= 256) {
+    memcpy(dst, src, count * sizeof(CRGB));
+    return;
+  }
+
+  uint8_t* d = (uint8_t*)dst;
+  const uint8_t* s = (const uint8_t*)src;
+  size_t bytes = count * sizeof(CRGB);
+  uint32_t inv = 256 - amount;
+
+  size_t i = 0;
+  for (; i + 4 <= bytes; i += 4) {
+    uint32_t a, b;
+    memcpy(&a, d + i, 4);
+    memcpy(&b, s + i, 4);
+    uint32_t evens = ((a & 0x00FF00FF) * inv + (b & 0x00FF00FF) * amount) >> 8;
+    uint32_t odds = ((a >> 8) & 0x00FF00FF) * inv + ((b >> 8) & 0x00FF00FF) * amount;
+    a = (evens & 0x00FF00FF) | (odds & 0xFF00FF00);
+    memcpy(d + i, &a, 4);
+  }
+  for (; i < bytes; i++) {
+    d[i] = (d[i] * inv + s[i] * amount) >> 8;
+  }
+}
+
+// ===== FIXED-POINT MATH UTILITIES =====
+// Sine lookup table for fixed-point math (0-180 degrees)
+// CRITICAL: Must use signed char on ESP32 for proper dark gaps!
+// ESP32 treats 'char' as unsigned by default, which breaks sine wave troughs
+const signed char sineTable[181] = {
+  0,1,2,3,5,6,7,8,9,10,11,12,13,15,16,17,
+  18,19,20,21,22,23,24,25,27,28,29,30,31,32,33,34,
+  35,36,37,38,39,40,42,43,44,45,46,47,48,49,50,51,
+  52,53,54,55,56,57,58,59,60,61,62,63,64,65,66,67,
+  67,68,69,70,71,72,73,74,75,76,77,77,78,79,80,81,
+  82,83,83,84,85,86,87,88,88,89,90,91,92,92,93,94,
+  95,95,96,97,97,98,99,100,100,101,102,102,103,104,104,105,
+  105,106,107,107,108,108,109,110,110,111,111,112,112,113,113,114,
+  114,115,115,116,116,117,117,117,118,118,119,119,120,120,120,121,
+  121,121,122,122,122,123,123,123,123,124,124,124,124,125,125,125,
+  125,125,126,126,126,126,126,126,126,127,127,127,127,127,127,127,
+  127,127,127,127,127
+};
+
+// Fixed-point sine function (angle in 720 units per cycle, 0-719)
+// Returns signed value -127 to +127
+// Uses 720-unit cycle (2× resolution of 360 degrees) for smoother animations
+signed char fixSin(int angle) {
+  angle %= 720;
+  if (angle < 0) angle += 720;
+  return (angle <= 360) ?
+     sineTable[(angle <= 180) ?
+       angle          :
+      (360 - angle)] :
+    -sineTable[(angle <= 540) ?
+      (angle - 360)   :
+      (720 - angle)];
+}
+
+// Fixed-point cosine function (angle in 720 units per cycle, 0-719)
+// Returns signed value -127 to +127
+signed char fixCos(int angle) {
+  angle %= 720;
+  if (angle < 0) angle += 720;
+  return (angle <= 360) ?
+    ((angle <= 180) ?  sineTable[180 - angle]  :
+                      -sineTable[angle - 180]) :
+    ((angle <= 540) ? -sineTable[540 - angle]  :
+                       sineTable[angle - 540]);
+}
+
+// HSV to RGB conversion with custom hue range (0-1535)
+// The Larry patterns use 1536 hue units instead of FastLED's 256
+void hsvToRgb(int h, byte s, byte v, byte *r, byte *g, byte *b) {
+  h %= 1536;
+  if (h < 0) h += 1536;
+
+  byte sextant = h >> 8;
+  byte frac = h & 255;
+  byte vs = (v * s) >> 8;
+  byte p = v - vs;
+  byte q = v - ((vs * frac) >> 8);
+  byte t = v - ((vs * (255 - frac)) >> 8);
+
+  switch (sextant) {
+    case 0: *r = v; *g = t; *b = p; break;
+    case 1: *r = q; *g = v; *b = p; break;
+    case 2: *r = p; *g = v; *b = t; break;
+    case 3: *r = p; *g = q; *b = v; break;
+    case 4: *r = t; *g = p; *b = v; break;
+    default: *r = v; *g = p; *b = q; break;
+  }
+}
+
+// Cross-fade variables
+bool isFading = false;
+float fadeAmount = 0.0f;  // 0.0 = current pattern, 1.0 = next pattern
+uint8_t fadeFromPattern = 0;
+uint8_t fadeToPattern = 0;
+unsigned long fadeStartTime = 0;
+
+// Pattern globals
+uint8_t gCurrentPatternNumber = 0;
+uint8_t gHue = 0;
+
+const char* patternNames[] = {
+  "Solid",
+  "Rainbow",
+  "SineChase",
+  "WavyFlag"
+};
+
+const uint8_t gPatternCount = ARRAY_SIZE(patternNames);
+
+// Live instances: the current pattern, plus the incoming one during a fade
+static Pattern* activePattern = nullptr;
+static Pattern* fadingPattern = nullptr;
+
+// ===== PATTERN BASE =====
+long Pattern::random(long howbig) {
+  if (howbig <= 0) return 0;
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return (long)(rngState % (uint32_t)howbig);
+}
+
+void Pattern::save(PatternSnapshot& snap) const {
+  snap.index = patternIndex;
+  snap.seed = seedValue;
+  snap.rng = rngState;
+  int32_t phase[2] = {0, 0};
+  savePhase(phase);
+  memcpy(snap.phase, phase, sizeof(phase));
+}
+
+void Pattern::restore(const PatternSnapshot& snap) {
+  rngState = snap.rng;
+  int32_t phase[2];
+  memcpy(phase, snap.phase, sizeof(phase));
+  loadPhase(phase);
+}
+
+// ===== LARRY PATTERN IMPLEMENTATIONS =====
+// Four beat-reactive patterns from larry_test_m5stack
+// Patterns write raw colors; renderPattern() then runs the shared output stage
+// (beat brightness, gamma) once over the finished frame.
+// All animation state lives in the instance; reset() re-seeds it.
+
+// Pattern 0: Solid Color
+// Music mode: Beat triggers smooth fade to new random color
+// Normal mode: Slowly fades through rainbow colors
+class SolidColorPattern : public Pattern {
+ public:
+  using Pattern::Pattern;
+
+  void render(CRGB* out, size_t n, const FrameContext& ctx) override {
+    // Check mode (not audioDetected, which can be true in any mode)
+    if (ctx.musicMode) {
+      // MUSIC MODE: Beat triggers new target color, then smoothly fade to it
+      if (ctx.beatDetected && !lastBeatState) {
+        targetHue = random(1536);  // Set new target color on beat
+      }
+      lastBeatState = ctx.beatDetected;
+
+      // Smoothly interpolate current hue toward target hue
+      if (currentHue != targetHue) {
+        int diff = targetHue - currentHue;
+        // Handle wrapping (shortest path around color wheel)
+        if (diff > 768) diff -= 1536;
+        if (diff < -768) diff += 1536;
+
+        // Move VERY slowly toward target (about 1-2% per frame for smooth fade)
+        // At 60 FPS, this takes about 1 second to complete the transition
+        int step = diff / 60;
+        if (step == 0) step = (diff > 0) ? 1 : -1;  // Minimum step
+
+        currentHue += step;
+        if (currentHue < 0) currentHue += 1536;
+        if (currentHue >= 1536) currentHue -= 1536;
+      }
+    } else {
+      // NORMAL MODE: Slowly fade through rainbow colors
+      currentHue += 2;  // Slow continuous rotation
+      if (currentHue >= 1536) currentHue -= 1536;
+      targetHue = currentHue;  // Keep in sync
+    }
+
+    // Convert current hue to RGB
+    byte r, g, b;
+    hsvToRgb(currentHue, 255, 255, &r, &g, &b);
+
+    // Fill all LEDs (output stage applies beat brightness and gamma)
+    fill_solid(out, n, CRGB(r, g, b));
+  }
+
+ protected:
+  void init() override {
+    currentHue = random(1536);
+    targetHue = currentHue;
+    lastBeatState = false;
+  }
+  void savePhase(int32_t phase[2]) const override {
+    phase[0] = currentHue;
+    phase[1] = targetHue | (lastBeatState ? 0x10000 : 0);
+  }
+  void loadPhase(const int32_t phase[2]) override {
+    currentHue = phase[0];
+    targetHue = phase[1] & 0xFFFF;
+    lastBeatState = phase[1] & 0x10000;
+  }
+
+ private:
+  bool lastBeatState = false;
+  int currentHue = 0;   // Current hue position
+  int targetHue = 0;    // Target hue (for smooth transitions)
+};
+
+// Pattern 1: Rainbow Larry
+// Smooth rotating color wheel - dramatic beat-reactive speed boost
+class RainbowLarryPattern : public Pattern {
+ public:
+  using Pattern::Pattern;
+
+  void render(CRGB* out, size_t n, const FrameContext& ctx) override {
+    // Apply speed envelope for dramatic beat-reactive speed boost (1.0x to 3.5x)
+    int increment = (int)(baseIncrement * ctx.speedMultiplier);
+
+    // Render rainbow across all LEDs
+    for (int i = 0; i < (int)n; i++) {
+      int hue = colorOffset + totalHueSpan * i / (int)n;
+      byte r, g, b;
+      hsvToRgb(hue, 255, 255, &r, &g, &b);
+      out[i] = CRGB(r, g, b);
+    }
+
+    colorOffset += increment;
+  }
+
+ protected:
+  void init() override {
+    colorOffset = 0;
+    totalHueSpan = (1 + random(4 * ((length + 31) / 32))) * 1536;
+    // Medium base speed: 4-8 (will be boosted to 10-20 on beats)
+    baseIncrement = 4 + random(5);
+    if (random(2) == 0) totalHueSpan = -totalHueSpan;
+    if (random(2) == 0) baseIncrement = -baseIncrement;
+  }
+  void savePhase(int32_t phase[2]) const override { phase[0] = colorOffset; }
+  void loadPhase(const int32_t phase[2]) override { colorOffset = phase[0]; }
+
+ private:
+  int colorOffset = 0;
+  int totalHueSpan = 1536;
+  int baseIncrement = 4;
+};
+
+// Pattern 2: Sine Wave Chase
+// Color waves with dramatic dark gaps - dramatic beat-reactive speed boost
+class SineWaveChasePattern : public Pattern {
+ public:
+  using Pattern::Pattern;
+
+  void render(CRGB* out, size_t n, const FrameContext& ctx) override {
+    // Apply EXTRA dramatic speed boost for sine wave pattern
+    // Sine wave gets 2x extra multiplier: (1.0x to 3.5x) * 2.0 = (1.0x to 6x)!
+    float speedMult = ctx.speedMultiplier;
+    if (speedMult > 1.0f) {
+      speedMult = 1.0f + (speedMult - 1.0f) * 2.0f;  // Amplify the boost by 2x
+    }
+    int increment = (int)(baseIncrement * speedMult);
+
+    // Render sine wave pattern
+    for (int i = 0; i < (int)n; i++) {
+      // Calculate sine value using fixed-point math (-127 to +127)
+      signed char sineValue = fixSin(waveOffset + waveSpan * i / (int)n);
+
+      byte r, g, b;
+      if (sineValue >= 0) {
+        // Positive sine: vary saturation (254 - foo*2), full brightness
+        byte sat = 254 - (sineValue * 2);
+        hsvToRgb(baseHue, sat, 255, &r, &g, &b);
+      } else {
+        // Negative sine: full saturation, vary brightness (254 + foo*2)
+        // THIS IS WHERE THE DARK GAPS COME FROM!
+        byte val = 254 + sineValue * 2;  // sineValue is negative, so this reduces brightness
+        hsvToRgb(baseHue, 255, val, &r, &g, &b);
+      }
+      out[i] = CRGB(r, g, b);
+    }
+
+    waveOffset += increment;
+  }
+
+ protected:
+  void init() override {
+    baseHue = random(1536);
+    waveSpan = (1 + random(4 * ((length + 31) / 32))) * 720;
+    // Medium base speed: 3-6 (will be boosted to 18-36 on beats with 6x multiplier!)
+    baseIncrement = 3 + random(4);
+    if (random(2) == 0) baseIncrement = -baseIncrement;
+    waveOffset = 0;
+  }
+  void savePhase(int32_t phase[2]) const override { phase[0] = waveOffset; }
+  void loadPhase(const int32_t phase[2]) override { waveOffset = phase[0]; }
+
+ private:
+  int baseHue = 0;
+  int waveSpan = 720;
+  int baseIncrement = 3;
+  int waveOffset = 0;
+};
+
+// Pattern 3: Wavy Flag
+// Animated red/white/blue patriotic pattern - BPM-synced flag waves
+class WavyFlagPattern : public Pattern {
+ public:
+  using Pattern::Pattern;
+
+  void render(CRGB* out, size_t n, const FrameContext& ctx) override {
+    // Flag pattern data
+    static const byte flagTable[] = {
+      160, 0, 0,    255, 255, 255,  160, 0, 0,    255, 255, 255,  // Red, White, Red, White
+      160, 0, 0,    255, 255, 255,  160, 0, 0,                     // Red, White, Red
+      0, 0, 100,    255, 255, 255,  0, 0, 100,    255, 255, 255,  // Blue, White, Blue, White
+      0, 0, 100,    255, 255, 255,  0, 0, 100,                     // Blue, White, Blue
+      255, 255, 255, 160, 0, 0,     255, 255, 255, 160, 0, 0,      // White, Red, White, Red
+      255, 255, 255, 160, 0, 0                                     // White, Red
+    };
+
+    // Apply speed envelope for dramatic beat-reactive speed boost (1.0x to 3.5x)
+    int increment = (int)(baseIncrement * ctx.speedMultiplier);
+
+    // Calculate total arc length with wave deformation
+    long sum = 0;
+    for (int i = 0; i < (int)n - 1; i++) {
+      sum += stripeWidth + fixCos(wavePhase + waveLength * i / (int)n);
+    }
+    if (sum <= 0) sum = 1;  // Single-pixel zone
+
+    // Render wavy flag pattern
+    long s = 0;
+    for (int i = 0; i < (int)n; i++) {
+      // Calculate position along flag pattern with wave deformation
+      long x = 256L * ((sizeof(flagTable) / 3) - 1) * s / sum;
+      int idx1 = (x >> 8) * 3;
+      int idx2 = ((x >> 8) + 1) * 3;
+      byte b = (x & 255) + 1;
+      byte a = 257 - b;
+
+      // Interpolate between flag colors
+      byte r = ((flagTable[idx1] * a) + (flagTable[idx2] * b)) >> 8;
+      byte g = ((flagTable[idx1 + 1] * a) + (flagTable[idx2 + 1] * b)) >> 8;
+      byte bl = ((flagTable[idx1 + 2] * a) + (flagTable[idx2 + 2] * b)) >> 8;
+      out[i] = CRGB(r, g, bl);
+
+      s += stripeWidth + fixCos(wavePhase + waveLength * i / (int)n);
+    }
+
+    wavePhase += increment;
+    if (wavePhase >= 720) wavePhase -= 720;
+  }
+
+ protected:
+  void init() override {
+    waveLength = 720 + random(720);
+    // Slower base speed: 1-3 (will be boosted to 2.5-7.5 on beats)
+    baseIncrement = 1 + random(3);
+    stripeWidth = 200 + random(200);
+    wavePhase = 0;
+  }
+  void savePhase(int32_t phase[2]) const override { phase[0] = wavePhase; }
+  void loadPhase(const int32_t phase[2]) override { wavePhase = phase[0]; }
+
+ private:
+  int waveLength = 720;
+  int baseIncrement = 1;
+  int stripeWidth = 200;
+  int wavePhase = 0;
+};
+
+// ===== PATTERN POOL =====
+// Fixed pool of instance slots (no heap), each big enough for any pattern
+static constexpr size_t PATTERN_SLOT_SIZE = std::max({
+  sizeof(SolidColorPattern), sizeof(RainbowLarryPattern),
+  sizeof(SineWaveChasePattern), sizeof(WavyFlagPattern)
+});
+static constexpr size_t PATTERN_SLOT_ALIGN = std::max({
+  alignof(SolidColorPattern), alignof(RainbowLarryPattern),
+  alignof(SineWaveChasePattern), alignof(WavyFlagPattern)
+});
+alignas(PATTERN_SLOT_ALIGN) static uint8_t patternSlots[PATTERN_POOL_SLOTS][PATTERN_SLOT_SIZE];
+static bool patternSlotUsed[PATTERN_POOL_SLOTS];
+
+Pattern* acquirePattern(uint8_t index, size_t length, uint32_t seed) {
+  for (int slot = 0; slot < PATTERN_POOL_SLOTS; slot++) {
+    if (patternSlotUsed[slot]) continue;
+
+    void* mem = patternSlots[slot];
+    Pattern* pattern;
+    switch (index % gPatternCount) {
+      case 0: pattern = new (mem) SolidColorPattern(length); break;
+      case 1: pattern = new (mem) RainbowLarryPattern(length); break;
+      case 2: pattern = new (mem) SineWaveChasePattern(length); break;
+      default: pattern = new (mem) WavyFlagPattern(length); break;
+    }
+    patternSlotUsed[slot] = true;
+    pattern->patternIndex = index % gPatternCount;
+    pattern->reset(seed);
+    return pattern;
+  }
+
+  Serial.println("Pattern pool exhausted!");
+  return nullptr;
+}
+
+void releasePattern(Pattern* pattern) {
+  if (!pattern) return;
+  for (int slot = 0; slot < PATTERN_POOL_SLOTS; slot++) {
+    if ((void*)pattern == (void*)patternSlots[slot]) {
+      pattern->~Pattern();
+      patternSlotUsed[slot] = false;
+      return;
+    }
+  }
+}
+
+// Draw a fresh seed from the global RNG for each new instance
+static Pattern* acquireStripPattern(uint8_t index) {
+  return acquirePattern(index, NUM_LEDS, (uint32_t)random(0x7FFFFFFF));
+}
+
+// Switch immediately (no cross-fade), discarding any fade in progress
+void selectPattern(uint8_t index) {
+  releasePattern(fadingPattern);
+  releasePattern(activePattern);
+  fadingPattern = nullptr;
+  isFading = false;
+  gCurrentPatternNumber = index % gPatternCount;
+  activePattern = acquireStripPattern(gCurrentPatternNumber);
+}
+
+FrameContext captureFrameContext() {
+  FrameContext ctx;
+  ctx.musicMode = (currentMode == MODE_MUSIC || currentMode == MODE_MUSIC_LEADER);
+  ctx.beatDetected = beatDetected;
+  ctx.speedMultiplier = getSpeedMultiplier();
+  ctx.brightnessScale = getMusicBeatBrightnessScale();
+  return ctx;
+}
+
+void nextPattern() {
+  // Start cross-fade to next pattern
+  fadeFromPattern = gCurrentPatternNumber;
+  fadeToPattern = (gCurrentPatternNumber + 1) % gPatternCount;
+  isFading = true;
+  fadeAmount = 0.0f;
+  fadeStartTime = millis();
+
+  // New instance starts from fresh state; the outgoing one keeps animating
+  releasePattern(fadingPattern);
+  fadingPattern = acquireStripPattern(fadeToPattern);
+
+  Serial.print("Fading from pattern ");
+  Serial.print(fadeFromPattern);
+  Serial.print(" to ");
+  Serial.println(fadeToPattern);
+}
+
+// Handle cross-fade rendering and blending
+void updateCrossFade() {
+  if (!isFading) return;
+
+  // Update fade progress
+  unsigned long elapsed = millis() - fadeStartTime;
+  fadeAmount = (float)elapsed / (float)FADE_DURATION_MS;
+
+  if (fadeAmount >= 1.0f) {
+    // Fade complete - switch to new pattern
+    fadeAmount = 1.0f;
+    isFading = false;
+    gCurrentPatternNumber = fadeToPattern;
+    // DON'T reset pattern - it's already been rendering during fade!
+    releasePattern(activePattern);
+    activePattern = fadingPattern;
+    fadingPattern = nullptr;
+    Serial.print("Fade complete, now on pattern ");
+    Serial.println(gCurrentPatternNumber);
+  }
+}
+
+// Shared by the local and parametric-sync paths. A cross-fade renders the
+// incoming pattern into scratch (n pixels, like target) and blends it in.
+static void renderInstances(Pattern* active, Pattern* fading, uint16_t blend, const FrameContext& ctx,
+                            CRGB* target, CRGB* scratch, size_t n) {
+  if (fading) {
+    // CROSS-FADE MODE: Render old pattern to target, new pattern to
+    // scratch, then blend in place - no stack copy of the frame
+    active->render(target, n, ctx);
+    fading->render(scratch, n, ctx);
+
+    // Blend: target = (old * (1-fade)) + (new * fade), 8.8 fixed point
+    blendFrames(target, scratch, blend, n);
+  } else {
+    // NORMAL MODE: Just render current pattern
+    active->render(target, n, ctx);
+  }
+
+  applyOutputStage(target, n, ctx.brightnessScale);
+}
+
+static void snapshotInstance(const Pattern* pattern, PatternSnapshot& snap) {
+  if (pattern) {
+    pattern->save(snap);
+  } else {
+    memset(&snap, 0, sizeof(snap));
+    snap.index = PATTERN_NONE;
+  }
+}
+
+// Render current pattern (with cross-fade support)
+void renderPattern(CRGB* target, RenderState* state) {
+  if (!activePattern) activePattern = acquireStripPattern(gCurrentPatternNumber);
+  if (!activePattern) {
+    // Pool exhausted: a black frame, and followers get no pattern to render
+    fill_solid(target, NUM_LEDS, CRGB::Black);
+    if (state) {
+      memset(state, 0, sizeof(*state));
+      snapshotInstance(nullptr, state->active);
+      snapshotInstance(nullptr, state->fading);
+    }
+    return;
+  }
+
+  FrameContext ctx = captureFrameContext();
+  Pattern* fading = (isFading && fadingPattern) ? fadingPattern : nullptr;
+  uint16_t blend = (uint16_t)(fadeAmount * 256.0f);
+
+  if (state) {
+    // Inputs before render() advances the instances
+    state->flags = (ctx.musicMode ? RENDER_FLAG_MUSIC : 0) |
+                   (ctx.beatDetected ? RENDER_FLAG_BEAT : 0);
+    state->blend = blend;
+    state->speedMultiplier = ctx.speedMultiplier;
+    state->brightnessScale = ctx.brightnessScale;
+    snapshotInstance(activePattern, state->active);
+    snapshotInstance(fading, state->fading);
+  }
+
+  renderInstances(activePattern, fading, blend, ctx, target, ledsNext, NUM_LEDS);
+}
+
+// ===== PARAMETRIC SYNC (FOLLOWER) =====
+static Pattern* syncActive = nullptr;
+static Pattern* syncFading = nullptr;
+static uint16_t syncBlend = 0;
+static unsigned long syncRenderedAt = 0;
+
+// Point instance at the snapshot's pattern, re-creating it from the seed if
+// the leader switched patterns (or we just started following)
+static Pattern* syncInstance(Pattern* instance, const PatternSnapshot& snap) {
+  if (snap.index == PATTERN_NONE) {
+    releasePattern(instance);
+    return nullptr;
+  }
+  if (!instance || instance->index() != snap.index || instance->seed() != snap.seed) {
+    releasePattern(instance);
+    instance = acquirePattern(snap.index, NUM_LEDS, snap.seed);
+    if (!instance) return nullptr;
+  }
+  instance->restore(snap);
+  return instance;
+}
+
+// Into [lo, hi]; NaN and infinities become 1.0 (no scaling), itself in range
+static float clampFinite(float v, float lo, float hi) {
+  if (!isfinite(v)) v = 1.0f;
+  return constrain(v, lo, hi);
+}
+
+void renderFromState(const RenderState& state, CRGB* target) {
+  // A finished fade hands the incoming instance over as the active one
+  if (syncFading && syncFading->index() == state.active.index && syncFading->seed() == state.active.seed) {
+    releasePattern(syncActive);
+    syncActive = syncFading;
+    syncFading = nullptr;
+  }
+  syncActive = syncInstance(syncActive, state.active);
+  syncFading = syncInstance(syncFading, state.fading);  // PATTERN_NONE when not fading
+  if (!syncActive) {
+    fill_solid(target, NUM_LEDS, CRGB::Black);  // Leader sent no pattern, or our pool is exhausted
+    return;
+  }
+
+  FrameContext ctx;
+  ctx.musicMode = state.flags & RENDER_FLAG_MUSIC;
+  ctx.beatDetected = state.flags & RENDER_FLAG_BEAT;
+  // From the network: a scale above 1.0 would index past gammaTable
+  ctx.speedMultiplier = clampFinite(state.speedMultiplier, SPEED_MULTIPLIER_MIN, SPEED_MULTIPLIER_MAX);
+  ctx.brightnessScale = clampFinite(state.brightnessScale, BEAT_BRIGHTNESS_SCALE_MIN, BEAT_BRIGHTNESS_SCALE_MAX);
+  renderInstances(syncActive, syncFading, state.blend, ctx, target, ledsNext, NUM_LEDS);
+  syncBlend = state.blend;
+  syncRenderedAt = millis();
+}
+
+bool adoptSyncState(unsigned long maxAgeMs) {
+  if (!syncActive || millis() - syncRenderedAt > maxAgeMs) return false;
+
+  releasePattern(fadingPattern);
+  releasePattern(activePattern);
+  activePattern = syncActive;
+  fadingPattern = syncFading;
+  syncActive = nullptr;
+  syncFading = nullptr;
+  gCurrentPatternNumber = activePattern->index();
+  isFading = fadingPattern != nullptr;
+  if (isFading) {
+    // Pick the fade up where the leader was: updateCrossFade() runs on millis()
+    fadeFromPattern = gCurrentPatternNumber;
+    fadeToPattern = fadingPattern->index();
+    fadeAmount = syncBlend / 256.0f;
+    fadeStartTime = millis() - (unsigned long)(fadeAmount * FADE_DURATION_MS);
+  }
+  return true;
+}
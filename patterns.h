@@ -0,0 +1,128 @@
+#ifndef PATTERNS_H
+#define PATTERNS_H
+
+#include "config.h"
+
+#define FADE_DURATION_MS 3000  // 3 second fade
+
+// ===== GAMMA CORRECTION / FIXED-POINT MATH =====
+extern const byte gammaTable[256];
+CRGB applyGamma(CRGB color);
+signed char fixSin(int angle);
+signed char fixCos(int angle);
+void hsvToRgb(int h, byte s, byte v, byte *r, byte *g, byte *b);
+
+// ===== OUTPUT STAGE =====
+void applyOutputStage(CRGB* frame, int count, float beatScale);  // beat brightness + gamma
+
+// ===== CROSS-FADE BLEND =====
+void blendFrames(CRGB* dst, const CRGB* src, uint16_t amount, int count);
+
+// ===== PATTERN INTERFACE =====
+// Per-frame inputs captured once by renderPattern(), so patterns never read
+// globals directly and can be rendered from any task or core
+struct FrameContext {
+  bool musicMode;          // MODE_MUSIC or MODE_MUSIC_LEADER
+  bool beatDetected;       // Beat detector state this frame
+  float speedMultiplier;   // Beat-reactive speed envelope (1.0x = normal)
+  float brightnessScale;   // Beat brightness scale for the output stage
+};
+
+// Everything a pattern instance needs to reproduce its next frame: the
+// seed re-derives its parameters, rng and phase carry the evolving state
+struct __attribute__((packed)) PatternSnapshot {
+  uint8_t index;       // Pattern number, PATTERN_NONE if no instance
+  uint32_t seed;       // reset() seed
+  uint32_t rng;        // Private RNG state
+  int32_t phase[2];    // Pattern-specific counters (offsets, hues)
+};
+#define PATTERN_NONE 0xFF
+
+// A pattern instance owns all of its animation state. reset() re-seeds the
+// instance's private RNG and reinitializes it; render() writes n raw pixels.
+class Pattern {
+ public:
+  explicit Pattern(size_t length) : length(length) {}
+  virtual ~Pattern() {}
+
+  void reset(uint32_t seed) {
+    seedValue = seed;
+    rngState = seed ? seed : 0x9E3779B9;
+    init();
+  }
+  virtual void render(CRGB* out, size_t n, const FrameContext& ctx) = 0;
+
+  void save(PatternSnapshot& snap) const;
+  void restore(const PatternSnapshot& snap);  // Instance must match snap.index/seed
+  uint8_t index() const { return patternIndex; }
+  uint32_t seed() const { return seedValue; }
+
+ protected:
+  virtual void init() = 0;
+  virtual void savePhase(int32_t phase[2]) const = 0;
+  virtual void loadPhase(const int32_t phase[2]) = 0;
+  long random(long howbig);  // Per-instance xorshift32, shadows Arduino random()
+
+  size_t length;  // Strip/zone length this instance was created for
+
+ private:
+  uint32_t rngState = 0x9E3779B9;
+  uint32_t seedValue = 0;
+  uint8_t patternIndex = 0;
+  friend Pattern* acquirePattern(uint8_t index, size_t length, uint32_t seed);
+};
+
+// Fixed pool of pattern instances (no heap): our own active and fading
+// instances, plus the ones a follower renders a leader's state with
+// (renderFromState) - kept apart so ours resume when the leader goes away.
+#define PATTERN_POOL_LOCAL 2  // Active + fading
+#define PATTERN_POOL_SYNC 2   // A leader's active + fading
+#define PATTERN_POOL_SLOTS (PATTERN_POOL_LOCAL + PATTERN_POOL_SYNC)
+Pattern* acquirePattern(uint8_t index, size_t length, uint32_t seed);  // nullptr if pool is full
+void releasePattern(Pattern* pattern);
+
+// Pattern names (Solid, Rainbow, SineChase, WavyFlag)
+extern const char* patternNames[];
+extern const uint8_t gPatternCount;
+
+// Pattern globals
+extern uint8_t gCurrentPatternNumber;
+extern uint8_t gHue;
+
+// Cross-fade state
+extern bool isFading;
+extern float fadeAmount;
+extern uint8_t fadeFromPattern;
+extern uint8_t fadeToPattern;
+extern unsigned long fadeStartTime;
+
+// ===== PARAMETRIC SYNC =====
+// The complete input of one renderPattern() call. A follower holding the
+// same pattern code renders the identical frame from it, at any strip length.
+#define RENDER_FLAG_MUSIC 0x01
+#define RENDER_FLAG_BEAT 0x02
+
+struct __attribute__((packed)) RenderState {
+  uint8_t flags;             // RENDER_FLAG_*
+  uint16_t blend;            // Cross-fade amount, 8.8 (256 = all incoming)
+  float speedMultiplier;
+  float brightnessScale;
+  PatternSnapshot active;
+  PatternSnapshot fading;    // index PATTERN_NONE when not fading
+};
+
+FrameContext captureFrameContext();
+void selectPattern(uint8_t index);  // Immediate switch, no cross-fade
+void nextPattern();
+void updateCrossFade();
+// Renders + output stage into target; state (if given) receives its inputs
+void renderPattern(CRGB* target = leds, RenderState* state = nullptr);
+// Follower: render a leader's RenderState with separate pool instances, so
+// our own patterns resume where they were when the leader goes away
+void renderFromState(const RenderState& state, CRGB* target = leds);
+// Elected leader (election.h): take the last leader's instances over as our
+// own, so the show carries on where it was. false if we haven't rendered
+// its state within maxAgeMs (it sent pixels) - our own patterns go on.
+bool adoptSyncState(unsigned long maxAgeMs);
+
+#endif
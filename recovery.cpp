@@ -0,0 +1,152 @@
+#include "recovery.h"
+#include "frame_codec.h"
+#include <atomic>
+#include <stddef.h>
+
+// ===== RTC MEMORY =====
+// Survives ESP.restart(), not a power cycle: garbage then, hence the CRC
+#define RECOVERY_RTC_MAGIC 0x52435652  // "RCVR"
+
+struct __attribute__((packed)) RecoveryRtc {
+  uint32_t magic;
+  uint8_t mode;
+  uint8_t pattern;
+  uint32_t frozenMs;  // Strip frozen this long before the reboot
+  uint32_t reboots;
+  uint16_t crc;
+};
+static RTC_NOINIT_ATTR RecoveryRtc rtc;
+
+static uint16_t rtcCrc() {
+  return crc16((const uint8_t*)&rtc, offsetof(RecoveryRtc, crc));
+}
+
+// ===== STATE (loop) =====
+static std::atomic<uint8_t> tier{RECOVERY_NONE};  // Read by the output task
+static std::atomic<uint8_t> pendingFlush{RECOVERY_NONE};
+static bool wasFollowing = false;
+static uint32_t followingSince = 0;
+static uint32_t frozenSince = 0;  // Last progress before the current stall
+static bool rebootPending = false;  // Restored: first frame ends the stall
+static uint32_t rebootFrozenMs = 0;
+
+// Read racily for printing
+static uint32_t stalls = 0, lost = 0, reboots = 0, lastMs = 0, maxMs = 0;
+static uint32_t recovered[4] = {0, 0, 0, 0};
+
+static const char* const tierNames[] = {"none", "flush", "reset", "reboot"};
+
+bool recoveryRestore(uint8_t* mode, uint8_t* pattern) {
+  bool valid = rtc.magic == RECOVERY_RTC_MAGIC && rtc.crc == rtcCrc();
+  rtc.magic = 0;  // Once: a later crash boots normally
+  if (!valid) return false;
+
+  *mode = rtc.mode;
+  *pattern = rtc.pattern;
+  reboots = rtc.reboots;
+  rebootPending = true;
+  rebootFrozenMs = rtc.frozenMs;
+  return true;
+}
+
+static void recordRecovered(RecoveryTier by, uint32_t ms) {
+  recovered[by]++;
+  lastMs = ms;
+  if (ms > maxMs) maxMs = ms;
+  Serial.printf("[RECOVER] Frames back after %lums (%s)\n", (unsigned long)ms, tierNames[by]);
+}
+
+static RecoveryTier enter(RecoveryTier next, uint32_t frozenMs) {
+  tier.store(next, std::memory_order_relaxed);
+  if (next != RECOVERY_REBOOT) pendingFlush.store(next, std::memory_order_relaxed);
+  Serial.printf("[RECOVER] No complete frame for %lums while the leader is on the air: %s\n",
+                (unsigned long)frozenMs, tierNames[next]);
+  return next;
+}
+
+RecoveryTier recoveryUpdate(bool following, uint32_t lastFrameMs) {
+  uint32_t now = millis();
+  if (rebootPending) {
+    if (following && lastFrameMs) {
+      rebootPending = false;
+      recordRecovered(RECOVERY_REBOOT, rebootFrozenMs + lastFrameMs);  // lastFrameMs counts from boot
+    } else if (now > RECOVERY_REBOOT_MS) {
+      rebootPending = false;
+      lost++;
+    }
+  }
+
+  if (!following) {
+    if (tier.load(std::memory_order_relaxed) != RECOVERY_NONE) lost++;
+    tier.store(RECOVERY_NONE, std::memory_order_relaxed);
+    wasFollowing = false;
+    return RECOVERY_NONE;
+  }
+  if (!wasFollowing) {
+    wasFollowing = true;
+    followingSince = now;
+  }
+
+  // Progress: the newer of our last frame and when we started following
+  uint32_t progress = now - lastFrameMs < now - followingSince ? lastFrameMs : followingSince;
+  RecoveryTier current = (RecoveryTier)tier.load(std::memory_order_relaxed);
+  if (current != RECOVERY_NONE && progress != frozenSince) {
+    recordRecovered(current, progress - frozenSince);
+    tier.store(RECOVERY_NONE, std::memory_order_relaxed);
+    current = RECOVERY_NONE;
+  }
+
+  uint32_t frozen = now - progress;
+  if (current == RECOVERY_NONE && frozen >= RECOVERY_FLUSH_MS) {
+    stalls++;
+    frozenSince = progress;
+    return enter(RECOVERY_FLUSH, frozen);
+  }
+  if (current == RECOVERY_FLUSH && frozen >= RECOVERY_RESET_MS) return enter(RECOVERY_RESET, frozen);
+  if (current == RECOVERY_RESET && frozen >= RECOVERY_REBOOT_MS) return enter(RECOVERY_REBOOT, frozen);
+  return RECOVERY_NONE;
+}
+
+void recoverySaveForReboot(uint8_t mode, uint8_t pattern) {
+  rtc.magic = RECOVERY_RTC_MAGIC;
+  rtc.mode = mode;
+  rtc.pattern = pattern;
+  rtc.frozenMs = millis() - frozenSince;
+  rtc.reboots = reboots + 1;
+  rtc.crc = rtcCrc();
+}
+
+RecoveryTier recoveryTakeFlush() {
+  if (pendingFlush.load(std::memory_order_relaxed) == RECOVERY_NONE) return RECOVERY_NONE;
+  return (RecoveryTier)pendingFlush.exchange(RECOVERY_NONE, std::memory_order_relaxed);
+}
+
+bool recoveryLocal() {
+  return tier.load(std::memory_order_relaxed) >= RECOVERY_RESET;
+}
+
+// ===== REPORT =====
+RecoveryStats recoveryStats() {
+  RecoveryStats s;
+  s.tier = (RecoveryTier)tier.load(std::memory_order_relaxed);
+  s.stalls = stalls;
+  memcpy(s.recovered, recovered, sizeof(s.recovered));
+  s.lost = lost;
+  s.reboots = reboots;
+  s.lastMs = lastMs;
+  s.maxMs = maxMs;
+  return s;
+}
+
+void recoveryPrintReport() {
+  RecoveryStats s = recoveryStats();
+  Serial.printf("[RECOVER] %lu stalls%s; recovered by flush %lu, reset %lu, reboot %lu; %lu leader lost; "
+                "%lu reboots\n",
+                (unsigned long)s.stalls, s.tier != RECOVERY_NONE ? " (stuck now)" : "",
+                (unsigned long)s.recovered[RECOVERY_FLUSH], (unsigned long)s.recovered[RECOVERY_RESET],
+                (unsigned long)s.recovered[RECOVERY_REBOOT], (unsigned long)s.lost, (unsigned long)s.reboots);
+  if (s.recovered[RECOVERY_FLUSH] + s.recovered[RECOVERY_RESET] + s.recovered[RECOVERY_REBOOT] > 0) {
+    Serial.printf("[RECOVER] time to recover last %lums, max %lums (last frame before the stall to the first after)\n",
+                  (unsigned long)s.lastMs, (unsigned long)s.maxMs);
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef RECOVERY_H
+#define RECOVERY_H
+
+#include "config.h"
+
+// ===== STUCK FOLLOWER RECOVERY =====
+// A follower that still hears its leader but completes no frame is stuck.
+// Recovery escalates with how long the strip has been frozen:
+//   RECOVERY_FLUSH_MS   forget partial frames and the decoder's reference
+//                       (in the receive callback, which owns them)
+//   RECOVERY_RESET_MS   also the clock fit and mesh route, re-add the
+//                       ESP-NOW peer, and render our own patterns from the
+//                       leader's last state until frames come back
+//   RECOVERY_REBOOT_MS  ESP.restart(), last resort. Mode and pattern are
+//                       kept in RTC memory, so setup() resumes them at once.
+// Time to recover runs from the last complete frame before the stall to the
+// first one after it, across a reboot too (not counting the boot itself).
+
+#define RECOVERY_FLUSH_MS 1000   // Keyframes come every 0.5s, keepalives every 250ms
+#define RECOVERY_RESET_MS 3000
+#define RECOVERY_REBOOT_MS 10000
+
+enum RecoveryTier : uint8_t {
+  RECOVERY_NONE = 0,  // Frames flowing (or not following)
+  RECOVERY_FLUSH,
+  RECOVERY_RESET,
+  RECOVERY_REBOOT
+};
+
+struct RecoveryStats {
+  RecoveryTier tier;        // Current stall's, RECOVERY_NONE when frames flow
+  uint32_t stalls;          // Detected (this boot)
+  uint32_t recovered[4];    // By the last tier applied before frames came back
+  uint32_t lost;            // Leader gone before they did
+  uint32_t reboots;         // Recovery reboots, kept across them
+  uint32_t lastMs, maxMs;   // Time to recover
+};
+
+// setup(): after a recovery reboot, the mode and pattern to resume
+bool recoveryRestore(uint8_t* mode, uint8_t* pattern);
+
+// ----- loop() -----
+// following: leaderDataActive. lastFrameMs: our last complete frame.
+// Returns the tier to apply now; RECOVERY_NONE for nothing new.
+RecoveryTier recoveryUpdate(bool following, uint32_t lastFrameMs);
+void recoverySaveForReboot(uint8_t mode, uint8_t pattern);  // Right before ESP.restart()
+
+// ----- Receive callback (WiFi task) -----
+RecoveryTier recoveryTakeFlush();  // Flush loop() asked for (FLUSH or RESET), once
+
+// ----- Any task -----
+bool recoveryLocal();  // RESET applied and still stuck: render our own patterns
+
+RecoveryStats recoveryStats();
+void recoveryPrintReport();
+
+#endif
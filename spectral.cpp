@@ -0,0 +1,172 @@
+#include "spectral.h"
+
+#include <string.h>
+
+// Onset tuning (flux is Q8 log2 units summed over bins)
+#define ONSET_MEAN_SHIFT 4         // Flux mean/deviation EMAs: 1/16 per block (~90ms)
+#define ONSET_DEV_MULT 2           // Onset needs flux > mean + 2 * deviation...
+#define ONSET_MIN_FLUX (30 * 256)  // ...and > this floor (noise alone stays under ~20)
+#define ONSET_REFRACTORY_BLOCKS 14 // No second onset within ~80ms
+#define MAG_FLOOR_LOG (4 * 256)    // log2 band energy floor: quieter bands count as silence
+
+static const int N = SPECTRAL_FFT_SIZE;
+static const int HALF = N / 2;
+
+// sin(2*pi*i/512) in Q15 for a quarter period; other sizes step through it
+static const int16_t quarterSine[129] = {
+  0,402,804,1206,1608,2009,2410,2811,3212,3612,4011,4410,4808,5205,5602,5998,
+  6393,6786,7179,7571,7962,8351,8739,9126,9512,9896,10278,10659,11039,11417,11793,12167,
+  12539,12910,13279,13645,14010,14372,14732,15090,15446,15800,16151,16499,16846,17189,17530,17869,
+  18204,18537,18868,19195,19519,19841,20159,20475,20787,21096,21403,21705,22005,22301,22594,22884,
+  23170,23452,23731,24007,24279,24547,24811,25072,25329,25582,25832,26077,26319,26556,26790,27019,
+  27245,27466,27683,27896,28105,28310,28510,28706,28898,29085,29268,29447,29621,29791,29956,30117,
+  30273,30424,30571,30714,30852,30985,31113,31237,31356,31470,31580,31685,31785,31880,31971,32057,
+  32137,32213,32285,32351,32412,32469,32521,32567,32609,32646,32678,32705,32728,32745,32757,32765,
+  32767
+};
+static const int SINE_STRIDE = 512 / N;
+
+// Flux weight per band - low bands dominate so kicks beat vocals
+static const uint8_t bandWeight[SPECTRAL_BANDS] = {4, 3, 2, 1, 1, 1};
+static const uint16_t bandEdgeHz[SPECTRAL_BANDS] = {0, 150, 400, 1000, 2500, 6000};
+
+static int16_t window[N];
+static uint16_t bitReverse[N];
+static int16_t twiddleCos[HALF], twiddleSin[HALF];  // exp(-2*pi*i*k/N) = cos - i*sin
+static uint16_t bandStart[SPECTRAL_BANDS + 1];
+static int32_t re[N], im[N];
+static int16_t prevBandLevel[SPECTRAL_BANDS];
+
+static uint32_t fluxMean = 0, fluxDev = 0;
+static bool prevAbove = false;
+static uint16_t blocksSinceOnset = ONSET_REFRACTORY_BLOCKS;
+
+// sin/cos(2*pi*k/N) in Q15 for 0 <= k <= N/2
+static int32_t sinQ15(int k) {
+  return k <= N / 4 ? quarterSine[k * SINE_STRIDE] : quarterSine[(HALF - k) * SINE_STRIDE];
+}
+
+static int32_t cosQ15(int k) {
+  return k <= N / 4 ? quarterSine[(N / 4 - k) * SINE_STRIDE] : -quarterSine[(k - N / 4) * SINE_STRIDE];
+}
+
+// log2(x) in Q8: integer part from the top bit, 8 fraction bits linearly
+static int32_t log2Q8(uint32_t x) {
+  if (x == 0) return 0;
+  int msb = 31 - __builtin_clz(x);
+  uint32_t frac = msb >= 8 ? (x >> (msb - 8)) & 0xFF : (x << (8 - msb)) & 0xFF;
+  return msb * 256 + frac;
+}
+
+void spectralInit(uint32_t sampleRate) {
+  // Hann window: (1 - cos) / 2
+  for (int n = 0; n < N; n++) {
+    int k = n <= HALF ? n : N - n;
+    window[n] = (int16_t)((32767 - cosQ15(k)) >> 1);
+  }
+  for (int k = 0; k < HALF; k++) {
+    twiddleCos[k] = (int16_t)cosQ15(k);
+    twiddleSin[k] = (int16_t)sinQ15(k);
+  }
+  for (int i = 0; i < N; i++) {
+    uint16_t r = 0;
+    for (int b = 0; b < SPECTRAL_FFT_LOG2; b++) r |= ((i >> b) & 1) << (SPECTRAL_FFT_LOG2 - 1 - b);
+    bitReverse[i] = r;
+  }
+  // Band edges in bins, skipping DC; every band gets at least one bin
+  for (int b = 0; b < SPECTRAL_BANDS; b++) {
+    uint32_t bin = (uint32_t)bandEdgeHz[b] * N / sampleRate;
+    uint16_t minBin = b == 0 ? 1 : bandStart[b - 1] + 1;
+    bandStart[b] = bin < minBin ? minBin : bin;
+  }
+  bandStart[SPECTRAL_BANDS] = HALF;
+  for (int b = 0; b < SPECTRAL_BANDS; b++) prevBandLevel[b] = MAG_FLOOR_LOG;
+  fluxMean = fluxDev = 0;
+  prevAbove = false;
+  blocksSinceOnset = ONSET_REFRACTORY_BLOCKS;
+}
+
+// In-place radix-2 DIT. Input is normalised to 14 bits and every stage
+// halves, so no intermediate exceeds 2^30 in 32-bit math.
+static void fft() {
+  for (int len = 2, step = HALF; len <= N; len <<= 1, step >>= 1) {
+    int half = len >> 1;
+    for (int i = 0; i < N; i += len) {
+      for (int j = 0; j < half; j++) {
+        int32_t wr = twiddleCos[j * step];
+        int32_t ws = twiddleSin[j * step];
+        int a = i + j, b = a + half;
+        int32_t tr = (re[b] * wr + im[b] * ws) >> 15;
+        int32_t ti = (im[b] * wr - re[b] * ws) >> 15;
+        re[b] = (re[a] - tr) >> 1;
+        im[b] = (im[a] - ti) >> 1;
+        re[a] = (re[a] + tr) >> 1;
+        im[a] = (im[a] + ti) >> 1;
+      }
+    }
+  }
+}
+
+SpectralFrame spectralAnalyse(const int16_t* samples) {
+  SpectralFrame frame;
+
+  // Window, then block-normalise so the peak uses 14 bits; the shift is
+  // undone in the log domain so levels stay comparable between blocks
+  int32_t peak = 1;  // Never 0, or normalisation below wouldn't terminate
+  for (int n = 0; n < N; n++) {
+    int32_t v = ((int32_t)samples[n] * window[n]) >> 15;
+    re[bitReverse[n]] = v;
+    int32_t a = v < 0 ? -v : v;
+    if (a > peak) peak = a;
+  }
+  int shift = 0;
+  while (peak >= (1 << 14)) { peak >>= 1; shift--; }
+  while (peak < (1 << 13)) { peak <<= 1; shift++; }
+  for (int n = 0; n < N; n++) {
+    re[n] = shift >= 0 ? re[n] << shift : re[n] >> -shift;
+    im[n] = 0;
+  }
+
+  fft();
+
+  uint32_t bandSum[SPECTRAL_BANDS] = {};
+  int band = 0;
+  for (int k = 1; k < HALF; k++) {
+    while (k >= bandStart[band + 1]) band++;
+    // Alpha-max-beta-min magnitude: max + 3/8 min, no sqrt
+    uint32_t ar = re[k] < 0 ? -re[k] : re[k];
+    uint32_t ai = im[k] < 0 ? -im[k] : im[k];
+    bandSum[band] += ar > ai ? ar + ((ai * 3) >> 3) : ai + ((ar * 3) >> 3);
+  }
+
+  // Flux on log band energy rather than per bin: summing a band first
+  // averages out the bin-to-bin jitter of noise, while a kick still lifts
+  // the whole low band at once
+  uint32_t flux = 0;
+  for (int b = 0; b < SPECTRAL_BANDS; b++) {
+    // +SPECTRAL_FFT_LOG2 undoes the per-stage halving, -shift the normalisation
+    int32_t level = log2Q8(bandSum[b]) + (SPECTRAL_FFT_LOG2 - shift) * 256;
+    if (level < MAG_FLOOR_LOG) level = MAG_FLOOR_LOG;
+    int32_t rise = level - prevBandLevel[b];
+    if (rise > 0) flux += (uint32_t)rise * bandWeight[b];
+    prevBandLevel[b] = (int16_t)level;
+    frame.bandLevel[b] = (int16_t)level;
+  }
+
+  // Adaptive threshold: mean + k * mean absolute deviation, both as EMAs
+  uint32_t threshold = fluxMean + ONSET_DEV_MULT * fluxDev;
+  if (threshold < ONSET_MIN_FLUX) threshold = ONSET_MIN_FLUX;
+  bool above = flux > threshold;
+  frame.onset = above && !prevAbove && blocksSinceOnset >= ONSET_REFRACTORY_BLOCKS;
+  prevAbove = above;
+  if (frame.onset) blocksSinceOnset = 0;
+  else if (blocksSinceOnset < ONSET_REFRACTORY_BLOCKS) blocksSinceOnset++;
+
+  uint32_t dev = flux > fluxMean ? flux - fluxMean : fluxMean - flux;
+  fluxMean = fluxMean - (fluxMean >> ONSET_MEAN_SHIFT) + (flux >> ONSET_MEAN_SHIFT);
+  fluxDev = fluxDev - (fluxDev >> ONSET_MEAN_SHIFT) + (dev >> ONSET_MEAN_SHIFT);
+
+  frame.flux = (uint16_t)(flux > 0xFFFF00 ? 0xFFFF : flux >> 8);
+  frame.threshold = (uint16_t)(threshold > 0xFFFF00 ? 0xFFFF : threshold >> 8);
+  return frame;
+}
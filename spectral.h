@@ -0,0 +1,30 @@
+#ifndef SPECTRAL_H
+#define SPECTRAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== SPECTRAL ONSET ENGINE =====
+// Fixed-point radix-2 FFT over the newest SPECTRAL_FFT_SIZE mic samples,
+// per-band log energy and kick-weighted spectral flux with an adaptive
+// threshold. Integer arithmetic only (no float, no libm), so the host build
+// produces bit-identical results to the ESP32 for tuning.
+
+#ifndef SPECTRAL_FFT_LOG2
+#define SPECTRAL_FFT_LOG2 9        // 9 = 512 points (86Hz bins), 8 = 256 points
+#endif
+#define SPECTRAL_FFT_SIZE (1 << SPECTRAL_FFT_LOG2)
+#define SPECTRAL_BANDS 6           // <150, 150-400, 400-1k, 1k-2.5k, 2.5k-6k, 6k+ Hz
+
+struct SpectralFrame {
+  int16_t bandLevel[SPECTRAL_BANDS];  // log2 band energy, Q8 (256 = 2x)
+  uint16_t flux;                      // Kick-weighted spectral flux, Q8
+  uint16_t threshold;                 // Adaptive onset threshold at this block, Q8
+  bool onset;
+};
+
+void spectralInit(uint32_t sampleRate);
+// samples: the newest SPECTRAL_FFT_SIZE samples, oldest first
+SpectralFrame spectralAnalyse(const int16_t* samples);
+
+#endif
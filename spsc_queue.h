@@ -0,0 +1,50 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== LOCK-FREE SPSC QUEUE =====
+// Bounded single producer / single consumer FIFO between tasks on different
+// cores. N must be a power of two; one slot is kept free so head == tail
+// means empty. push() never blocks - when the queue is full the item is
+// dropped and counted (dropped()), so a stalled consumer can't stall the
+// producer.
+template <typename T, size_t N>
+class SpscQueue {
+  static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+ public:
+  // ----- Producer side -----
+  bool push(const T& item) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t next = (h + 1) & (N - 1);
+    if (next == tail.load(std::memory_order_acquire)) {
+      droppedCount++;
+      return false;
+    }
+    items[h] = item;
+    head.store(next, std::memory_order_release);
+    return true;
+  }
+
+  uint32_t dropped() const { return droppedCount; }
+
+  // ----- Consumer side -----
+  bool pop(T& item) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return false;
+    item = items[t];
+    tail.store((t + 1) & (N - 1), std::memory_order_release);
+    return true;
+  }
+
+ private:
+  T items[N];
+  std::atomic<uint32_t> head{0};  // Next slot the producer writes
+  std::atomic<uint32_t> tail{0};  // Next slot the consumer reads
+  uint32_t droppedCount = 0;
+};
+
+#endif
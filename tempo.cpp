@@ -0,0 +1,244 @@
+#include "tempo.h"
+
+#include <math.h>
+#include <string.h>
+
+// History must cover the slowest tempo's lag (60 BPM at ~172 blocks/s = 173)
+#define TEMPO_MAX_LAGS 256
+#define TEMPO_PRIOR_BPM 120.0f         // Centre of the tempo prior (resolves half/double)
+#define TEMPO_PRIOR_OCTAVES 1.0f       // Prior width, in octaves
+#define TEMPO_RECENT_ONSETS 8          // Onsets kept to tell a beat from an off-beat
+#define TEMPO_OFFBEAT_SWITCH 0.85f     // Off-beat onsets this strong (x on-beat) are beats too
+#define TEMPO_OFFBEAT_KEEP 0.6f        // ... or this strong, once we count them as beats
+#define PHASE_GAIN 0.3f                // Fraction of an onset's timing error applied to the grid
+#define PHASE_CAPTURE_WINDOW 0.25f     // Onsets further than this (x period) from the grid are ignored
+#define PHASE_RESET_CHANGE 0.04f       // Re-anchor the grid when the tempo moves this much
+
+static float blocksPerSec = 0.0f;
+static int minLag = 0, maxLag = 0;
+static float decay = 0.0f;
+
+static float history[TEMPO_MAX_LAGS];  // Mean-removed onset strength, ring
+static int historyHead = 0;
+static int blocksSeen = 0;             // Until the history covers every lag, short lags look stronger
+static float envelopeMean = 0.0f;
+static float acf[TEMPO_MAX_LAGS];      // Leaky autocorrelation per lag
+static float energy = 0.0f;            // Leaky autocorrelation at lag 0
+static float prior[TEMPO_MAX_LAGS];
+
+static float bpm = 0.0f;
+static float confidence = 0.0f;
+
+struct RecentOnset {
+  uint32_t ms;
+  float strength;
+};
+static RecentOnset recentOnsets[TEMPO_RECENT_ONSETS];  // Ring, strength 0 = empty
+static int recentOnsetHead = 0;
+
+static bool phaseValid = false;
+static uint32_t phaseAnchorMs = 0;     // A predicted beat; kept within a period of "now"
+static float phaseAnchorFrac = 0.0f;   // Sub-millisecond part of the anchor
+static float phaseBPM = 0.0f;          // Tempo when the anchor was set
+
+void tempoInit(float blocksPerSecond) {
+  blocksPerSec = blocksPerSecond;
+  minLag = (int)(blocksPerSec * 60.0f / TEMPO_MAX_BPM);
+  maxLag = (int)(blocksPerSec * 60.0f / TEMPO_MIN_BPM) + 1;
+  if (maxLag > TEMPO_MAX_LAGS - 2) maxLag = TEMPO_MAX_LAGS - 2;
+  decay = expf(-1.0f / (TEMPO_MEMORY_SECONDS * blocksPerSec));
+
+  // Log-Gaussian prior around 120 BPM so a 2x/0.5x peak of similar height loses
+  for (int lag = 0; lag < TEMPO_MAX_LAGS; lag++) {
+    if (lag < minLag || lag > maxLag) {
+      prior[lag] = 0.0f;
+      continue;
+    }
+    float octaves = log2f(60.0f * blocksPerSec / lag / TEMPO_PRIOR_BPM) / TEMPO_PRIOR_OCTAVES;
+    prior[lag] = expf(-0.5f * octaves * octaves);
+  }
+
+  memset(history, 0, sizeof(history));
+  memset(acf, 0, sizeof(acf));
+  energy = 0.0f;
+  historyHead = 0;
+  blocksSeen = 0;
+  envelopeMean = 0.0f;
+  bpm = 0.0f;
+  confidence = 0.0f;
+  memset(recentOnsets, 0, sizeof(recentOnsets));
+  recentOnsetHead = 0;
+  phaseValid = false;
+}
+
+// Recent onset strength in step with the latest onset at the given period,
+// against half a period out of step, weaker over stronger: ~1 when the
+// period spans two equal beats, lower when the half-way hits are off-beat
+// hats. 1 with too few onsets to go by, so the correlation alone decides.
+static float offBeatRatio(int lag) {
+  const RecentOnset& latest = recentOnsets[(recentOnsetHead + TEMPO_RECENT_ONSETS - 1) % TEMPO_RECENT_ONSETS];
+  float period = 1000.0f * lag / blocksPerSec;
+  float inStep = 0.0f, outOfStep = 0.0f;
+  int count = 0;
+  for (int i = 0; i < TEMPO_RECENT_ONSETS; i++) {
+    if (recentOnsets[i].strength <= 0.0f) continue;
+    count++;
+    float phase = (float)(int32_t)(latest.ms - recentOnsets[i].ms) / period;
+    phase -= floorf(phase);
+    if (phase < 0.15f || phase > 0.85f) inStep += recentOnsets[i].strength;
+    else if (phase > 0.35f && phase < 0.65f) outOfStep += recentOnsets[i].strength;
+  }
+  if (count < TEMPO_RECENT_ONSETS) return 1.0f;
+  return inStep < outOfStep ? inStep / outOfStep : outOfStep / inStep;
+}
+
+void tempoAddOnsetStrength(float strength) {
+  if (blocksPerSec <= 0.0f) return;
+
+  // Remove the slow mean so steady loudness doesn't correlate at every lag
+  envelopeMean += (strength - envelopeMean) * 0.01f;
+  float x = strength - envelopeMean;
+  if (x < 0.0f) x = 0.0f;  // Only rises carry rhythm
+
+  history[historyHead] = x;
+  energy = energy * decay + x * x;
+  for (int lag = minLag - 1; lag <= maxLag + 1; lag++) {
+    float past = history[(historyHead - lag + TEMPO_MAX_LAGS) % TEMPO_MAX_LAGS];
+    acf[lag] = acf[lag] * decay + x * past;
+  }
+  historyHead = (historyHead + 1) % TEMPO_MAX_LAGS;
+  if (blocksSeen <= maxLag) {
+    blocksSeen++;
+    return;
+  }
+
+  // Best prior-weighted lag
+  int best = minLag;
+  float bestScore = 0.0f, sum = 0.0f;
+  for (int lag = minLag; lag <= maxLag; lag++) {
+    float score = acf[lag] * prior[lag];
+    sum += acf[lag];
+    if (score > bestScore) {
+      bestScore = score;
+      best = lag;
+    }
+  }
+  if (bestScore <= 0.0f) {
+    confidence = 0.0f;
+    return;
+  }
+
+  // A pulse train correlates as well at 2x its period as at the period
+  // itself, but so do off-beat hats half way between the kicks. If half the
+  // winning lag is nearly as strong, it's the beat only when the onsets half
+  // way through the winning period hit about as hard as the ones on it
+  int half = (best + 1) / 2;
+  if (half >= minLag) {
+    int h = half;
+    if (acf[half - 1] > acf[h]) h = half - 1;
+    if (acf[half + 1] > acf[h]) h = half + 1;
+    // Hysteresis: equal beats measure 0.8-1.0, hats up to ~0.8
+    float halfBPM = 60.0f * blocksPerSec / h;
+    bool wasHalf = fabsf(bpm - halfBPM) < 0.1f * halfBPM;
+    float needed = wasHalf ? TEMPO_OFFBEAT_KEEP : TEMPO_OFFBEAT_SWITCH;
+    if (acf[h] >= 0.6f * acf[best] && offBeatRatio(best) >= needed) best = h;
+  }
+
+  // Parabolic interpolation between neighbouring lags for sub-block precision
+  float a = acf[best - 1], b = acf[best], c = acf[best + 1];
+  int lags = maxLag - minLag + 1;
+  float denom = a - 2.0f * b + c;
+  float offset = (denom < 0.0f) ? 0.5f * (a - c) / denom : 0.0f;
+  bpm = 60.0f * blocksPerSec / ((float)best + offset);
+
+  // How far the peak stands above the average lag, relative to how far the
+  // signal's own energy does: a clean beat repeats itself almost exactly
+  // (~1), noise correlates about equally at every lag (~0) - and a beat
+  // under steady noise still scores by the beat, not by the noise floor
+  float mean = sum / (float)lags;
+  confidence = energy > mean ? (b - mean) / (energy - mean) : 0.0f;
+  if (confidence < 0.0f) confidence = 0.0f;
+  if (confidence > 1.0f) confidence = 1.0f;
+}
+
+float tempoBPM() {
+  return bpm;
+}
+
+float tempoConfidence() {
+  return confidence;
+}
+
+bool tempoLocked() {
+  return confidence >= TEMPO_LOCK_CONFIDENCE;
+}
+
+// ===== BEAT PHASE =====
+static float beatPeriodMs() {
+  return bpm > 0.0f ? 60000.0f / bpm : 0.0f;
+}
+
+// Time of t relative to the anchor beat, in ms (negative if t is before it)
+static float sinceAnchor(uint32_t t) {
+  return (float)(int32_t)(t - phaseAnchorMs) - phaseAnchorFrac;
+}
+
+// Move the anchor by whole periods so it stays just behind t - keeps the
+// float offsets small however long the song runs
+static void advanceAnchor(uint32_t t) {
+  float period = beatPeriodMs();
+  float steps = floorf(sinceAnchor(t) / period);
+  if (steps <= 0.0f) return;
+  float advance = steps * period + phaseAnchorFrac;
+  phaseAnchorMs += (uint32_t)advance;
+  phaseAnchorFrac = advance - floorf(advance);
+}
+
+void tempoAddOnset(uint32_t timestampMs, float strength) {
+  recentOnsets[recentOnsetHead].ms = timestampMs;
+  recentOnsets[recentOnsetHead].strength = strength;
+  recentOnsetHead = (recentOnsetHead + 1) % TEMPO_RECENT_ONSETS;
+
+  if (!tempoLocked()) {
+    phaseValid = false;
+    return;
+  }
+  // A new tempo (a song change, or a half/double correction) makes the old
+  // grid meaningless - and kicks now off it would never pull it back
+  if (phaseValid && fabsf(bpm - phaseBPM) > PHASE_RESET_CHANGE * phaseBPM) phaseValid = false;
+  if (!phaseValid) {
+    phaseAnchorMs = timestampMs;
+    phaseAnchorFrac = 0.0f;
+    phaseBPM = bpm;
+    phaseValid = true;
+    return;
+  }
+
+  // Timing error against the nearest grid beat, -period/2..period/2
+  float period = beatPeriodMs();
+  float diff = sinceAnchor(timestampMs);
+  float error = diff - period * floorf(diff / period + 0.5f);
+  if (fabsf(error) > period * PHASE_CAPTURE_WINDOW) return;  // Off-beat hit (snare, fill)
+
+  float shifted = phaseAnchorFrac + error * PHASE_GAIN;
+  float whole = floorf(shifted);
+  phaseAnchorMs += (int32_t)whole;
+  phaseAnchorFrac = shifted - whole;
+  advanceAnchor(timestampMs);
+}
+
+uint32_t tempoNextBeatMs(uint32_t afterMs) {
+  if (!phaseValid || !tempoLocked()) return 0;
+  advanceAnchor(afterMs);
+  float period = beatPeriodMs();
+  float diff = sinceAnchor(afterMs);
+  float beat = (floorf(diff / period) + 1.0f) * period + phaseAnchorFrac;
+  return phaseAnchorMs + (int32_t)ceilf(beat);
+}
+
+float tempoBeatPhase(uint32_t nowMs) {
+  if (!phaseValid || !tempoLocked()) return 0.0f;
+  float period = beatPeriodMs();
+  float diff = sinceAnchor(nowMs);
+  return (diff - period * floorf(diff / period)) / period;
+}
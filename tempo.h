@@ -0,0 +1,30 @@
+#ifndef TEMPO_H
+#define TEMPO_H
+
+#include <stdint.h>
+
+// ===== STREAMING TEMPO TRACKER =====
+// Leaky autocorrelation of the onset-strength envelope (one value per audio
+// block). Every block updates the correlation at every candidate lag, so the
+// tempo estimate follows a song change within a few beats instead of waiting
+// for a fixed BPM window.
+
+#define TEMPO_MIN_BPM 60.0f
+#define TEMPO_MAX_BPM 200.0f
+#define TEMPO_MEMORY_SECONDS 1.5f      // Time constant of the leaky correlation
+#define TEMPO_LOCK_CONFIDENCE 0.25f    // Below this the estimate isn't trusted (noise stays ~0.1)
+
+void tempoInit(float blocksPerSecond);
+void tempoAddOnsetStrength(float strength);  // Call once per audio block
+float tempoBPM();                            // Latest estimate, 0 before any peak
+float tempoConfidence();                     // 0.0-1.0, peak prominence
+bool tempoLocked();                          // Confidence >= TEMPO_LOCK_CONFIDENCE
+
+// ----- Beat phase -----
+// Onsets near a predicted beat nudge the phase (a simple PLL), so the beat
+// grid can be extrapolated ahead of the audio.
+void tempoAddOnset(uint32_t timestampMs, float strength);  // When the transient actually happened
+uint32_t tempoNextBeatMs(uint32_t afterMs);  // First predicted beat > afterMs, 0 if unlocked
+float tempoBeatPhase(uint32_t nowMs);        // 0.0 on the beat .. 1.0 just before the next
+
+#endif
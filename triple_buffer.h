@@ -0,0 +1,50 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <stdint.h>
+
+// ===== LOCK-FREE TRIPLE BUFFER =====
+// Single producer / single consumer frame handoff between cores.
+// The producer owns a private back slot, the consumer a private front slot,
+// and the third slot sits in the middle holding the newest published frame.
+// publish() and acquire() are one atomic exchange each, so neither side ever
+// blocks or sees a half-written frame. If the producer runs ahead, unread
+// frames are overwritten (counted in overwritten()).
+template <typename T>
+class TripleBuffer {
+ public:
+  // ----- Producer side -----
+  T& back() { return slots[backIdx]; }
+
+  void publish() {
+    uint32_t prev = middle.exchange(backIdx | FRESH, std::memory_order_acq_rel);
+    if (prev & FRESH) overwrittenCount++;
+    backIdx = prev & INDEX_MASK;
+  }
+
+  uint32_t overwritten() const { return overwrittenCount; }
+
+  // ----- Consumer side -----
+  // Swap in the newest published frame; false if nothing new since last time
+  bool acquire() {
+    if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+    uint32_t prev = middle.exchange(frontIdx, std::memory_order_acq_rel);
+    frontIdx = prev & INDEX_MASK;
+    return true;
+  }
+
+  const T& front() const { return slots[frontIdx]; }
+
+ private:
+  static constexpr uint32_t FRESH = 0x80;
+  static constexpr uint32_t INDEX_MASK = 0x03;
+
+  T slots[3];
+  uint32_t backIdx = 0;
+  uint32_t frontIdx = 1;
+  uint32_t overwrittenCount = 0;
+  std::atomic<uint32_t> middle{2};  // Word-sized so it stays lock-free on Xtensa
+};
+
+#endif
@@ -0,0 +1,212 @@
+#include "tx_queue.h"
+#include "config.h"
+
+#ifdef ARDUINO
+// Producers run on three tasks at once: the loop task (beacons, heartbeats,
+// clock packets), the output task (leader broadcasts) and the WiFi task
+// (mesh relays, from the receive callback), which also runs the completion
+// callback. A spinlock, not a mutex: the WiFi task must not block.
+static portMUX_TYPE txLock = portMUX_INITIALIZER_UNLOCKED;
+#define TX_LOCK() taskENTER_CRITICAL(&txLock)
+#define TX_UNLOCK() taskEXIT_CRITICAL(&txLock)
+#else
+#include <mutex>
+static std::mutex txLock;
+#define TX_LOCK() txLock.lock()
+#define TX_UNLOCK() txLock.unlock()
+#endif
+
+struct TxPacket {
+  uint8_t data[TX_PACKET_MAX];
+  uint16_t len;
+  uint32_t enqueuedAt;  // micros()
+};
+
+struct TxCredit {
+  bool busy;
+  uint32_t since;       // Handed to ESP-NOW (micros)
+  uint32_t enqueuedAt;  // For the send latency
+};
+
+// Everything below is guarded by txLock; send() is always called outside it
+static TxSendFn sendFn = nullptr;
+static TxPacket ring[TX_QUEUE_SLOTS];
+static uint8_t ringHead = 0, ringCount = 0;
+static TxCredit credits[TX_CREDITS];
+static TxStats stats;
+static uint64_t depthSum = 0, latencySum = 0;
+static uint32_t depthSamples = 0, latencySamples = 0;
+
+void txQueueBegin(TxSendFn send) {
+  TX_LOCK();
+  sendFn = send;
+  ringHead = ringCount = 0;
+  memset(credits, 0, sizeof(credits));
+  TX_UNLOCK();
+}
+
+// Credits whose callback never came (ESP-NOW was restarted, or the callback
+// was lost) would stall the queue for good; give them back. Locked.
+static void reclaimStaleCredits(uint32_t now) {
+  for (int i = 0; i < TX_CREDITS; i++) {
+    if (credits[i].busy && now - credits[i].since > TX_CREDIT_TIMEOUT_US) {
+      credits[i].busy = false;
+      stats.timeouts++;
+    }
+  }
+}
+
+// Free credit index, or -1. Locked.
+static int claimCredit(uint32_t now, uint32_t enqueuedAt) {
+  for (int i = 0; i < TX_CREDITS; i++) {
+    if (!credits[i].busy) {
+      credits[i].busy = true;
+      credits[i].since = now;
+      credits[i].enqueuedAt = enqueuedAt;
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Submit queued packets while credits last. Every producer pumps after
+// enqueueing and the completion callback pumps too, so up to TX_CREDITS
+// pumps can be sending at once from different tasks. Each packet is claimed
+// under the lock, so the worst a race does is swap two chunks - the decoders
+// take any order.
+static void pump() {
+  static TxPacket sending[TX_CREDITS];  // Copied out under the lock, one per credit: pumps never share one
+  for (;;) {
+    uint32_t now = micros();
+    TX_LOCK();
+    reclaimStaleCredits(now);
+    int credit = ringCount > 0 ? claimCredit(now, ring[ringHead].enqueuedAt) : -1;
+    if (credit < 0) {
+      TX_UNLOCK();
+      return;
+    }
+    TxPacket& p = sending[credit];
+    p = ring[ringHead];
+    ringHead = (ringHead + 1) % TX_QUEUE_SLOTS;
+    ringCount--;
+    stats.depth = ringCount;
+    TX_UNLOCK();
+
+    if (!sendFn(p.data, p.len)) {
+      // ESP-NOW's own queue is full: no callback will come for this one.
+      // Leave the rest queued for the next enqueue or completion.
+      TX_LOCK();
+      credits[credit].busy = false;
+      stats.failed++;
+      TX_UNLOCK();
+      return;
+    }
+  }
+}
+
+bool txQueueSend(const uint8_t* data, uint16_t len) {
+  if (!sendFn || len > TX_PACKET_MAX) return false;
+  bool kept = true;
+
+  TX_LOCK();
+  if (ringCount == TX_QUEUE_SLOTS) {
+    ringHead = (ringHead + 1) % TX_QUEUE_SLOTS;  // Drop the oldest
+    ringCount--;
+    stats.dropped++;
+    kept = false;
+  }
+  TxPacket& p = ring[(ringHead + ringCount) % TX_QUEUE_SLOTS];
+  memcpy(p.data, data, len);
+  p.len = len;
+  p.enqueuedAt = micros();
+  ringCount++;
+  stats.queued++;
+  stats.depth = ringCount;
+  if (ringCount > stats.depthMax) stats.depthMax = ringCount;
+  depthSum += ringCount;
+  depthSamples++;
+  TX_UNLOCK();
+
+  pump();
+  return kept;
+}
+
+bool txQueueSendNow(const uint8_t* data, uint16_t len) {
+  if (!sendFn) return false;
+  uint32_t now = micros();
+  TX_LOCK();
+  reclaimStaleCredits(now);
+  int credit = claimCredit(now, now);
+  TX_UNLOCK();
+  if (credit < 0) return false;
+
+  if (!sendFn(data, len)) {
+    TX_LOCK();
+    credits[credit].busy = false;
+    stats.failed++;
+    TX_UNLOCK();
+    return false;
+  }
+  return true;
+}
+
+void txQueueOnSent(bool success) {
+  uint32_t now = micros();
+  TX_LOCK();
+  // Completions arrive in submission order: the oldest busy credit is this one
+  int oldest = -1;
+  for (int i = 0; i < TX_CREDITS; i++) {
+    if (credits[i].busy && (oldest < 0 || (int32_t)(credits[i].since - credits[oldest].since) < 0)) oldest = i;
+  }
+  if (oldest >= 0) {
+    credits[oldest].busy = false;
+    uint32_t latency = now - credits[oldest].enqueuedAt;
+    latencySum += latency;
+    latencySamples++;
+    stats.latencyAvgUs = (uint32_t)(latencySum / latencySamples);
+    if (latency > stats.latencyMaxUs) stats.latencyMaxUs = latency;
+  }
+  if (success) stats.sent++;
+  else stats.failed++;
+  TX_UNLOCK();
+
+  pump();
+}
+
+uint8_t txQueueFree() {
+  TX_LOCK();
+  uint8_t free = TX_QUEUE_SLOTS - ringCount;
+  TX_UNLOCK();
+  return free;
+}
+
+TxStats txQueueStats() {
+  TX_LOCK();
+  TxStats s = stats;
+  TX_UNLOCK();
+  return s;
+}
+
+void txQueueResetStats() {
+  TX_LOCK();
+  uint8_t depth = stats.depth;
+  memset(&stats, 0, sizeof(stats));
+  stats.depth = stats.depthMax = depth;
+  depthSum = latencySum = 0;
+  depthSamples = latencySamples = 0;
+  TX_UNLOCK();
+}
+
+void txQueuePrintReport() {
+  TX_LOCK();
+  TxStats s = stats;
+  float depthAvg = depthSamples ? (float)depthSum / depthSamples : 0;
+  TX_UNLOCK();
+
+  Serial.printf("[TX] %u queued, %u sent, %u failed, %u dropped (queue full), %u credit timeouts\n",
+                (unsigned)s.queued, (unsigned)s.sent, (unsigned)s.failed, (unsigned)s.dropped, (unsigned)s.timeouts);
+  Serial.printf("[TX] depth now/avg/max %u/%.1f/%u of %d, send latency avg/max %u/%uus\n",
+                (unsigned)s.depth, depthAvg, (unsigned)s.depthMax, TX_QUEUE_SLOTS,
+                (unsigned)s.latencyAvgUs, (unsigned)s.latencyMaxUs);
+  txQueueResetStats();
+}
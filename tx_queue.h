@@ -0,0 +1,43 @@
+#ifndef TX_QUEUE_H
+#define TX_QUEUE_H
+
+#include "config.h"
+
+// ===== ESP-NOW TRANSMIT QUEUE =====
+// Outgoing packets wait here instead of being pushed at the radio with a
+// busy-wait between them. At most TX_CREDITS sends are in flight; each
+// send-complete callback returns a credit and submits the next packet, so
+// the queue drains as fast as the channel allows and no task ever waits
+// on it. When the queue is full the oldest packet is dropped (counted), so
+// a congested channel costs stale packets, never render time.
+
+#define TX_PACKET_MAX ESPNOW_MAX_PACKET
+#define TX_QUEUE_SLOTS (TX_PACKET_MAX > 250 ? 8 : 32)  // Two 1000-LED keyframes either way
+#define TX_CREDITS 2                  // Sends handed to ESP-NOW at once
+#define TX_CREDIT_TIMEOUT_US 20000    // Reclaim a credit whose callback never came
+
+typedef bool (*TxSendFn)(const uint8_t* data, uint16_t len);  // true if the send was accepted
+
+struct TxStats {
+  uint32_t queued;        // Packets accepted by txQueueSend()
+  uint32_t sent;          // Send-complete callbacks reporting success
+  uint32_t failed;        // Rejected by esp_now_send() or failed in the callback
+  uint32_t dropped;       // Oldest packets overwritten by a full queue
+  uint32_t timeouts;      // Credits reclaimed without a callback
+  uint8_t depth;          // Packets waiting now
+  uint8_t depthMax;       // Since the last txQueueResetStats()
+  uint32_t latencyAvgUs;  // Enqueue -> send complete, running average
+  uint32_t latencyMaxUs;  // Since the last txQueueResetStats()
+};
+
+void txQueueBegin(TxSendFn send);
+bool txQueueSend(const uint8_t* data, uint16_t len);     // false if the oldest packet had to be dropped
+bool txQueueSendNow(const uint8_t* data, uint16_t len);  // Bypass the queue; false if no credit is free
+void txQueueOnSent(bool success);                       // Call from the ESP-NOW send callback
+uint8_t txQueueFree();                                  // Slots left - for frame-level back-pressure
+
+TxStats txQueueStats();
+void txQueueResetStats();
+void txQueuePrintReport();
+
+#endif